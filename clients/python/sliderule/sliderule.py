@@ -82,6 +82,10 @@ recdef_table = {}
 
 arrow_file_table = {}
 
+arrow_stream_table = {} # record batches decoded from arrow ipc streams, by output path
+
+IPC_CONTINUATION = b'\xff\xff\xff\xff'
+
 profiles = {}
 
 gps_epoch = datetime(1980, 1, 6)
@@ -443,23 +447,84 @@ def __exceptrec(rec):
         else:
             eventlogger[rec["level"]]("%s", rec["text"])
 
+#
+#  __ipcbodylength - reads bodyLength (fourth field) from an arrow ipc message's flatbuffer metadata
+#
+def __ipcbodylength(metadata):
+    table = int.from_bytes(metadata[0:4], 'little')
+    vtable = table - int.from_bytes(metadata[table:table+4], 'little', signed=True)
+    vtable_size = int.from_bytes(metadata[vtable:vtable+2], 'little')
+    field = 4 + (2 * 3)
+    if field + 2 > vtable_size:
+        return 0
+    offset = int.from_bytes(metadata[vtable+field:vtable+field+2], 'little')
+    if offset == 0:
+        return 0
+    return int.from_bytes(metadata[table+offset:table+offset+8], 'little', signed=True)
+
+#
+#  __decodeipc - decodes each complete message of an arrow ipc stream as it arrives
+#
+def __decodeipc(stream, data):
+    import pyarrow
+    import pyarrow.ipc
+    pending = stream["pending"]
+    pending += data
+    while not stream["complete"] and len(pending) >= 8:
+        if pending[:4] != IPC_CONTINUATION:
+            raise FatalError("invalid arrow ipc stream")
+        metadata_size = int.from_bytes(pending[4:8], 'little')
+        if metadata_size == 0:
+            # end of stream marker
+            del pending[:8]
+            stream["complete"] = True
+            break
+        if len(pending) < 8 + metadata_size:
+            break
+        message_size = 8 + metadata_size + __ipcbodylength(pending[8:8+metadata_size])
+        if len(pending) < message_size:
+            break
+        message = pyarrow.ipc.read_message(pyarrow.py_buffer(bytes(pending[:message_size])))
+        del pending[:message_size]
+        if message.type == 'schema':
+            stream["schema"] = pyarrow.ipc.read_schema(message)
+        elif message.type == 'record batch':
+            stream["batches"].append(pyarrow.ipc.read_record_batch(message, stream["schema"]))
+
 #
 #  _arrowrec
 #
+#  Arrow IPC streams are decoded as their data records arrive, so record
+#  batches are available in arrow_stream_table while the request is still
+#  running; the bytes are also written to the output path
+#
 def __arrowrec(rec):
-    global arrow_file_table
+    global arrow_file_table, arrow_stream_table
     try :
         filename = rec["filename"]
         if rec["__rectype"] == 'arrowrec.meta':
             if filename in arrow_file_table:
                 raise FatalError("file transfer already in progress")
-            arrow_file_table[filename] = { "fp": open(filename, "wb"), "size": rec["size"], "progress": 0 }
+            arrow_file_table[filename] = { "fp": open(filename, "wb"), "size": rec["size"], "progress": 0, "stream": None }
+            arrow_stream_table.pop(filename, None)
+        elif rec["__rectype"] == 'arrowrec.eof':
+            # file was streamed with an unknown (negative) size in the meta record
+            file = arrow_file_table[filename]
+            file["fp"].close()
+            del arrow_file_table[filename]
+            if file["progress"] != rec["size"]:
+                raise FatalError("expected {} bytes but received {}".format(rec["size"], file["progress"]))
         else: # rec["__rectype"] == 'arrowrec.data'
-            data = rec['data']
+            data = bytearray(rec['data'])
             file = arrow_file_table[filename]
-            file["fp"].write(bytearray(data))
+            if file["progress"] == 0 and data[:4] == IPC_CONTINUATION:
+                file["stream"] = { "pending": bytearray(), "schema": None, "batches": [], "complete": False }
+                arrow_stream_table[filename] = file["stream"]
+            if file["stream"] != None:
+                __decodeipc(file["stream"], data)
+            file["fp"].write(data)
             file["progress"] += len(data)
-            if file["progress"] >= file["size"]:
+            if file["size"] >= 0 and file["progress"] >= file["size"]:
                 file["fp"].close()
                 del arrow_file_table[filename]
     except Exception as e:
@@ -468,7 +533,7 @@ def __arrowrec(rec):
 #
 #  Globals
 #
-__callbacks = {'eventrec': __logeventrec, 'exceptrec': __exceptrec, 'arrowrec.meta': __arrowrec, 'arrowrec.data': __arrowrec }
+__callbacks = {'eventrec': __logeventrec, 'exceptrec': __exceptrec, 'arrowrec.meta': __arrowrec, 'arrowrec.data': __arrowrec, 'arrowrec.eof': __arrowrec }
 
 
 ###############################################################################
@@ -517,6 +582,20 @@ def emptyframe(**kwargs):
 #
 def procoutputfile(parm):
     if "open_on_complete" in parm["output"] and parm["output"]["open_on_complete"]:
+        if parm["output"].get("format") == "arrow_ipc":
+            # Return Record Batches Decoded from Arrow IPC Stream as (Geo)DataFrame
+            import pyarrow
+            import pyarrow.ipc
+            stream = arrow_stream_table.pop(parm["output"]["path"], None)
+            if stream != None and stream["schema"] != None:
+                df = pyarrow.Table.from_batches(stream["batches"], schema=stream["schema"]).to_pandas()
+            else:
+                with pyarrow.ipc.open_stream(parm["output"]["path"]) as reader:
+                    df = reader.read_pandas()
+            if "geometry" in df:
+                df["geometry"] = geopandas.GeoSeries.from_wkb(df["geometry"])
+                df = geopandas.GeoDataFrame(df, geometry="geometry", crs=EPSG_MERCATOR)
+            return df
         # Return GeoParquet File as GeoDataFrame
         return geopandas.read_parquet(parm["output"]["path"])
     else:
@@ -48,6 +48,10 @@ const char* ArrowParms::OPEN_ON_COMPLETE    = "open_on_complete";
 const char* ArrowParms::ASSET               = "asset";
 const char* ArrowParms::REGION              = "region";
 const char* ArrowParms::CREDENTIALS         = "credentials";
+const char* ArrowParms::ROWS_PER_GROUP      = "rows_per_group";
+const char* ArrowParms::SPATIAL_SORT        = "spatial_sort";
+const char* ArrowParms::PARTITION_BY        = "partition_by";
+const char* ArrowParms::MEMORY_BUDGET       = "memory_budget";
 
 const char* ArrowParms::OBJECT_TYPE = "ArrowParms";
 const char* ArrowParms::LuaMetaName = "ArrowParms";
@@ -56,6 +60,7 @@ const struct luaL_Reg ArrowParms::LuaMetaTable[] = {
     {"isfeather",   luaIsFeather},
     {"isparquet",   luaIsParquet},
     {"iscsv",       luaIsCSV},
+    {"isarrowipc",  luaIsArrowIpc},
     {"path",        luaPath},
     {NULL,          NULL}
 };
@@ -96,7 +101,11 @@ ArrowParms::ArrowParms (lua_State* L, int index):
     format              (NATIVE),
     open_on_complete    (false),
     asset_name          (NULL),
-    region              (NULL)
+    region              (NULL),
+    rows_per_group      (0),
+    spatial_sort        (false),
+    partition_by        (NULL),
+    memory_budget       (0)
 {
     /* Populate Object from Lua */
     try
@@ -124,6 +133,32 @@ ArrowParms::ArrowParms (lua_State* L, int index):
             if(field_provided) mlog(DEBUG, "Setting %s to %d", OPEN_ON_COMPLETE, (int)open_on_complete);
             lua_pop(L, 1);
 
+            /* Rows per Row Group */
+            lua_getfield(L, index, ROWS_PER_GROUP);
+            rows_per_group = LuaObject::getLuaInteger(L, -1, true, rows_per_group, &field_provided);
+            if(rows_per_group < 0) throw RunTimeException(CRITICAL, RTE_ERROR, "Invalid %s: %ld", ROWS_PER_GROUP, rows_per_group);
+            if(field_provided) mlog(DEBUG, "Setting %s to %ld", ROWS_PER_GROUP, rows_per_group);
+            lua_pop(L, 1);
+
+            /* Spatial Sort */
+            lua_getfield(L, index, SPATIAL_SORT);
+            spatial_sort = LuaObject::getLuaBoolean(L, -1, true, spatial_sort, &field_provided);
+            if(field_provided) mlog(DEBUG, "Setting %s to %d", SPATIAL_SORT, (int)spatial_sort);
+            lua_pop(L, 1);
+
+            /* Partition By */
+            lua_getfield(L, index, PARTITION_BY);
+            partition_by = StringLib::duplicate(LuaObject::getLuaString(L, -1, true, NULL, &field_provided));
+            if(field_provided) mlog(DEBUG, "Setting %s to %s", PARTITION_BY, partition_by);
+            lua_pop(L, 1);
+
+            /* Memory Budget */
+            lua_getfield(L, index, MEMORY_BUDGET);
+            memory_budget = LuaObject::getLuaInteger(L, -1, true, memory_budget, &field_provided);
+            if(memory_budget < 0) throw RunTimeException(CRITICAL, RTE_ERROR, "Invalid %s: %ld", MEMORY_BUDGET, memory_budget);
+            if(field_provided) mlog(DEBUG, "Setting %s to %ld", MEMORY_BUDGET, memory_budget);
+            lua_pop(L, 1);
+
             /* Asset */
             lua_getfield(L, index, ASSET);
             asset_name = StringLib::duplicate(LuaObject::getLuaString(L, -1, true, NULL, &field_provided));
@@ -202,6 +237,12 @@ void ArrowParms::cleanup (void)
         delete [] region;
         region = NULL;
     }
+
+    if(partition_by)
+    {
+        delete [] partition_by;
+        partition_by = NULL;
+    }
 }
 
 /*----------------------------------------------------------------------------
@@ -214,6 +255,7 @@ ArrowParms::format_t ArrowParms::str2outputformat (const char* fmt_str)
     else if(StringLib::match(fmt_str, "feather"))   return FEATHER;
     else if(StringLib::match(fmt_str, "parquet"))   return PARQUET;
     else if(StringLib::match(fmt_str, "csv"))       return CSV;
+    else if(StringLib::match(fmt_str, "arrow_ipc")) return IPC_STREAM;
     else                                            return UNSUPPORTED;
 }
 
@@ -281,6 +323,22 @@ int ArrowParms::luaIsCSV (lua_State* L)
     }
 }
 
+/*----------------------------------------------------------------------------
+ * luaIsArrowIpc
+ *----------------------------------------------------------------------------*/
+int ArrowParms::luaIsArrowIpc (lua_State* L)
+{
+    try
+    {
+        ArrowParms* lua_obj = (ArrowParms*)getLuaSelf(L, 1);
+        return returnLuaStatus(L, lua_obj->format == IPC_STREAM);
+    }
+    catch(const RunTimeException& e)
+    {
+        return luaL_error(L, "method invoked from invalid object: %s", __FUNCTION__);
+    }
+}
+
 /*----------------------------------------------------------------------------
  * luaPath
  *----------------------------------------------------------------------------*/
@@ -68,7 +68,8 @@ class ArrowParms: public LuaObject
             FEATHER = 1,
             PARQUET = 2,
             CSV = 3,
-            UNSUPPORTED = 4
+            IPC_STREAM = 4,
+            UNSUPPORTED = 5
         } format_t;
 
         /*--------------------------------------------------------------------
@@ -82,6 +83,10 @@ class ArrowParms: public LuaObject
         static const char* ASSET;
         static const char* REGION;
         static const char* CREDENTIALS;
+        static const char* ROWS_PER_GROUP;
+        static const char* SPATIAL_SORT;
+        static const char* PARTITION_BY;
+        static const char* MEMORY_BUDGET;
 
         static const char* OBJECT_TYPE;
         static const char* LuaMetaName;
@@ -96,6 +101,10 @@ class ArrowParms: public LuaObject
         bool            open_on_complete;               // flag to client to open file on completion
         const char*     asset_name;
         const char*     region;
+        long            rows_per_group;                 // rows written per parquet row group, 0 sizes groups by bytes
+        bool            spatial_sort;                   // hilbert sort rows in each row group and add bbox covering column
+        const char*     partition_by;                   // field used to split output into a hive style dataset
+        long            memory_budget;                  // bytes of arrow memory a request may hold, row groups shrink to fit, 0 is unlimited
 
         #ifdef __aws__
         CredentialStore::Credential credentials;
@@ -121,6 +130,7 @@ class ArrowParms: public LuaObject
         static int  luaIsFeather        (lua_State* L);
         static int  luaIsParquet        (lua_State* L);
         static int  luaIsCSV            (lua_State* L);
+        static int  luaIsArrowIpc       (lua_State* L);
         static int  luaPath             (lua_State* L);
 };
 
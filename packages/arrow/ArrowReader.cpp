@@ -0,0 +1,896 @@
+/*
+ * Copyright (c) 2021, University of Washington
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the University of Washington nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY OF WASHINGTON AND CONTRIBUTORS
+ * “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE UNIVERSITY OF WASHINGTON OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/******************************************************************************
+ * INCLUDES
+ ******************************************************************************/
+
+#include <type_traits>
+#include <limits>
+#include <arrow/array.h>
+#include <arrow/buffer.h>
+#include <arrow/record_batch.h>
+#include <arrow/table.h>
+#include <arrow/io/file.h>
+#include <arrow/ipc/reader.h>
+#include <parquet/arrow/reader.h>
+#include <parquet/file_reader.h>
+#include <parquet/metadata.h>
+#include <parquet/statistics.h>
+
+#include "core.h"
+#include "ArrowReader.h"
+#include "ArrowParms.h"
+
+#ifdef __aws__
+#include "aws.h"
+#endif
+
+using std::shared_ptr;
+using std::unique_ptr;
+using std::vector;
+
+#ifdef __aws__
+/******************************************************************************
+ * S3 RANDOM ACCESS FILE
+ ******************************************************************************/
+
+/*
+ * Reads byte ranges of an S3 object on demand, so that only the footer and
+ * the projected column chunks of the row groups that pass the filters are
+ * fetched
+ */
+class S3RandomAccessFile: public arrow::io::RandomAccessFile
+{
+    public:
+
+        S3RandomAccessFile (const char* _bucket, const char* _key, const char* _region, const CredentialStore::Credential* _credentials):
+            bucket(_bucket),
+            key(_key),
+            region(_region),
+            credentials(_credentials),
+            position(0),
+            isClosed(false)
+        {
+            objectSize = S3CurlIODriver::size(bucket, key, region, credentials);
+        }
+
+        arrow::Status Close (void) override
+        {
+            isClosed = true;
+            return arrow::Status::OK();
+        }
+
+        bool closed (void) const override
+        {
+            return isClosed;
+        }
+
+        arrow::Result<int64_t> Tell (void) const override
+        {
+            return position;
+        }
+
+        arrow::Status Seek (int64_t _position) override
+        {
+            if(_position < 0) return arrow::Status::Invalid("negative seek position");
+            position = _position;
+            return arrow::Status::OK();
+        }
+
+        arrow::Result<int64_t> GetSize (void) override
+        {
+            return objectSize;
+        }
+
+        arrow::Result<int64_t> Read (int64_t nbytes, void* out) override
+        {
+            arrow::Result<int64_t> result = ReadAt(position, nbytes, out);
+            if(result.ok()) position += result.ValueOrDie();
+            return result;
+        }
+
+        arrow::Result<shared_ptr<arrow::Buffer>> Read (int64_t nbytes) override
+        {
+            arrow::Result<shared_ptr<arrow::Buffer>> result = ReadAt(position, nbytes);
+            if(result.ok()) position += result.ValueOrDie()->size();
+            return result;
+        }
+
+        arrow::Result<int64_t> ReadAt (int64_t _position, int64_t nbytes, void* out) override
+        {
+            if(isClosed) return arrow::Status::Invalid("read from closed file");
+            int64_t bytes_to_read = MIN(nbytes, objectSize - _position);
+            if(bytes_to_read <= 0) return 0;
+            try
+            {
+                return S3CurlIODriver::get((uint8_t*)out, bytes_to_read, _position, bucket, key, region, credentials);
+            }
+            catch(const RunTimeException& e)
+            {
+                return arrow::Status::IOError(e.what());
+            }
+        }
+
+        arrow::Result<shared_ptr<arrow::Buffer>> ReadAt (int64_t _position, int64_t nbytes) override
+        {
+            int64_t bytes_to_read = MAX(MIN(nbytes, objectSize - _position), 0);
+            arrow::Result<unique_ptr<arrow::ResizableBuffer>> allocation = arrow::AllocateResizableBuffer(bytes_to_read);
+            if(!allocation.ok()) return allocation.status();
+            shared_ptr<arrow::ResizableBuffer> buffer = std::move(allocation).ValueOrDie();
+
+            arrow::Result<int64_t> result = ReadAt(_position, bytes_to_read, buffer->mutable_data());
+            if(!result.ok()) return result.status();
+            arrow::Status status = buffer->Resize(result.ValueOrDie());
+            if(!status.ok()) return status;
+            return shared_ptr<arrow::Buffer>(buffer);
+        }
+
+    private:
+
+        const char*                         bucket;
+        const char*                         key;
+        const char*                         region;
+        const CredentialStore::Credential*  credentials;
+        int64_t                             objectSize;
+        int64_t                             position;
+        bool                                isClosed;
+};
+#endif
+
+/******************************************************************************
+ * PRIVATE IMPLEMENTATION
+ ******************************************************************************/
+
+struct ArrowReader::impl
+{
+    static bool readInput (ArrowReader* reader, const shared_ptr<arrow::io::RandomAccessFile>& file, const char* name);
+    static bool readParquet (ArrowReader* reader, const shared_ptr<arrow::io::RandomAccessFile>& file);
+    static bool readFeather (ArrowReader* reader, const shared_ptr<arrow::io::RandomAccessFile>& file);
+    static bool isProjected (ArrowReader* reader, const std::string& name);
+    static bool rowGroupInRange (ArrowReader* reader, const parquet::RowGroupMetaData& row_group);
+    static bool statisticsRange (const parquet::Statistics& statistics, double* min, double* max);
+    static bool postBatch (ArrowReader* reader, const arrow::RecordBatch& batch);
+    static void scatterColumn (const arrow::Array& array, int64_t start, int rows, RecordObject* record, const RecordObject::field_t& field, int row_size_bytes);
+    static void scatterGeometry (const arrow::Array& array, int64_t start, int rows, RecordObject* record, const RecordObject::field_t& lon_field, const RecordObject::field_t& lat_field, int row_size_bytes);
+    template<typename T> static void scatterValues (const arrow::Array& array, int64_t start, int rows, RecordObject* record, RecordObject::field_t field, int row_size_bytes);
+};
+
+/*----------------------------------------------------------------------------
+ * readInput
+ *----------------------------------------------------------------------------*/
+bool ArrowReader::impl::readInput (ArrowReader* reader, const shared_ptr<arrow::io::RandomAccessFile>& file, const char* name)
+{
+    bool status;
+    if(reader->parms->format == ArrowParms::FEATHER)    status = readFeather(reader, file);
+    else                                                status = readParquet(reader, file);
+    if(!status)
+    {
+        LuaEndpoint::generateExceptionStatus(RTE_ERROR, CRITICAL, reader->outQ, &reader->active, "Failed to read %s", name);
+    }
+
+    return status;
+}
+
+/*----------------------------------------------------------------------------
+ * readParquet
+ *----------------------------------------------------------------------------*/
+bool ArrowReader::impl::readParquet (ArrowReader* reader, const shared_ptr<arrow::io::RandomAccessFile>& file)
+{
+    /* Open Parquet Reader */
+    unique_ptr<parquet::arrow::FileReader> parquet_reader;
+    #ifdef APACHE_ARROW_10_COMPAT
+        arrow::Status status = parquet::arrow::OpenFile(file, arrow::default_memory_pool(), &parquet_reader);
+        if(!status.ok())
+        {
+            mlog(CRITICAL, "Failed to open parquet file: %s", status.ToString().c_str());
+            return false;
+        }
+    #else
+        arrow::Result<unique_ptr<parquet::arrow::FileReader>> result = parquet::arrow::OpenFile(file, arrow::default_memory_pool());
+        if(!result.ok())
+        {
+            mlog(CRITICAL, "Failed to open parquet file: %s", result.status().ToString().c_str());
+            return false;
+        }
+        parquet_reader = std::move(result).ValueOrDie();
+    #endif
+
+    /* Project Leaf Columns */
+    shared_ptr<parquet::FileMetaData> metadata = parquet_reader->parquet_reader()->metadata();
+    const parquet::SchemaDescriptor* schema = metadata->schema();
+    vector<int> column_indices;
+    for(int c = 0; c < schema->num_columns(); c++)
+    {
+        std::string root_name = schema->Column(c)->path()->ToDotVector()[0];
+        if(isProjected(reader, root_name)) column_indices.push_back(c);
+    }
+
+    /* Read Row Groups */
+    for(int rg = 0; reader->active && rg < metadata->num_row_groups(); rg++)
+    {
+        /* Skip Row Groups Outside of Filters */
+        unique_ptr<parquet::RowGroupMetaData> row_group = metadata->RowGroup(rg);
+        if(!rowGroupInRange(reader, *row_group))
+        {
+            reader->stats.row_groups_skipped++;
+            continue;
+        }
+
+        /* Read Projected Columns of Row Group */
+        shared_ptr<arrow::Table> table;
+        #ifdef APACHE_ARROW_10_COMPAT
+            arrow::Status rg_status = parquet_reader->ReadRowGroup(rg, column_indices, &table);
+            if(!rg_status.ok())
+            {
+                mlog(CRITICAL, "Failed to read row group %d: %s", rg, rg_status.ToString().c_str());
+                return false;
+            }
+        #else
+            arrow::Result<shared_ptr<arrow::Table>> rg_result = parquet_reader->ReadRowGroup(rg, column_indices);
+            if(!rg_result.ok())
+            {
+                mlog(CRITICAL, "Failed to read row group %d: %s", rg, rg_result.status().ToString().c_str());
+                return false;
+            }
+            table = rg_result.ValueOrDie();
+        #endif
+        reader->stats.row_groups_read++;
+
+        /* Post Rows in Record Sized Batches */
+        arrow::TableBatchReader batch_reader(*table);
+        batch_reader.set_chunksize(reader->rowsPerRecord);
+        shared_ptr<arrow::RecordBatch> batch;
+        while(reader->active && batch_reader.ReadNext(&batch).ok() && batch)
+        {
+            if(!postBatch(reader, *batch)) return false;
+        }
+    }
+
+    return true;
+}
+
+/*----------------------------------------------------------------------------
+ * readFeather - feather files have no statistics, so filters do not apply
+ *----------------------------------------------------------------------------*/
+bool ArrowReader::impl::readFeather (ArrowReader* reader, const shared_ptr<arrow::io::RandomAccessFile>& file)
+{
+    /* Read Schema */
+    arrow::Result<shared_ptr<arrow::ipc::RecordBatchFileReader>> result = arrow::ipc::RecordBatchFileReader::Open(file);
+    if(!result.ok())
+    {
+        mlog(CRITICAL, "Failed to open feather file: %s", result.status().ToString().c_str());
+        return false;
+    }
+    shared_ptr<arrow::Schema> schema = result.ValueOrDie()->schema();
+
+    /* Reopen with Projected Fields */
+    arrow::ipc::IpcReadOptions options = arrow::ipc::IpcReadOptions::Defaults();
+    for(int f = 0; f < schema->num_fields(); f++)
+    {
+        if(isProjected(reader, schema->field(f)->name())) options.included_fields.push_back(f);
+    }
+    result = arrow::ipc::RecordBatchFileReader::Open(file, options);
+    if(!result.ok())
+    {
+        mlog(CRITICAL, "Failed to open feather file: %s", result.status().ToString().c_str());
+        return false;
+    }
+    shared_ptr<arrow::ipc::RecordBatchFileReader> feather_reader = result.ValueOrDie();
+
+    /* Read Record Batches */
+    for(int b = 0; reader->active && b < feather_reader->num_record_batches(); b++)
+    {
+        arrow::Result<shared_ptr<arrow::RecordBatch>> batch = feather_reader->ReadRecordBatch(b);
+        if(!batch.ok())
+        {
+            mlog(CRITICAL, "Failed to read record batch %d: %s", b, batch.status().ToString().c_str());
+            return false;
+        }
+        reader->stats.row_groups_read++;
+
+        /* Post Rows in Record Sized Slices */
+        shared_ptr<arrow::RecordBatch> full_batch = batch.ValueOrDie();
+        for(int64_t start = 0; reader->active && start < full_batch->num_rows(); start += reader->rowsPerRecord)
+        {
+            if(!postBatch(reader, *full_batch->Slice(start, reader->rowsPerRecord))) return false;
+        }
+    }
+
+    return true;
+}
+
+/*----------------------------------------------------------------------------
+ * isProjected - column is read only when it populates a field of the record
+ *----------------------------------------------------------------------------*/
+bool ArrowReader::impl::isProjected (ArrowReader* reader, const std::string& name)
+{
+    for(int i = 0; i < reader->columnFields.length(); i++)
+    {
+        if(name == reader->columnFields[i].name) return true;
+    }
+    return (reader->lonKey != NULL) && (name == "geometry");
+}
+
+/*----------------------------------------------------------------------------
+ * rowGroupInRange
+ *----------------------------------------------------------------------------*/
+bool ArrowReader::impl::rowGroupInRange (ArrowReader* reader, const parquet::RowGroupMetaData& row_group)
+{
+    for(int i = 0; i < reader->rangeFilters.length(); i++)
+    {
+        const range_filter_t& filter = reader->rangeFilters[i];
+        for(int c = 0; c < row_group.num_columns(); c++)
+        {
+            unique_ptr<parquet::ColumnChunkMetaData> column = row_group.ColumnChunk(c);
+            if(column->path_in_schema()->ToDotString() != filter.column) continue;
+
+            /* Skip Row Group when its Values Cannot Overlap Filter */
+            double min, max;
+            shared_ptr<parquet::Statistics> statistics = column->statistics();
+            if(statistics && statisticsRange(*statistics, &min, &max))
+            {
+                if(max < filter.min || min > filter.max) return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+/*----------------------------------------------------------------------------
+ * statisticsRange
+ *----------------------------------------------------------------------------*/
+bool ArrowReader::impl::statisticsRange (const parquet::Statistics& statistics, double* min, double* max)
+{
+    if(!statistics.HasMinMax()) return false;
+
+    switch(statistics.physical_type())
+    {
+        case parquet::Type::INT32:
+        {
+            const parquet::Int32Statistics& typed = static_cast<const parquet::Int32Statistics&>(statistics);
+            *min = typed.min();
+            *max = typed.max();
+            return true;
+        }
+        case parquet::Type::INT64:
+        {
+            const parquet::Int64Statistics& typed = static_cast<const parquet::Int64Statistics&>(statistics);
+            *min = (double)typed.min();
+            *max = (double)typed.max();
+            return true;
+        }
+        case parquet::Type::FLOAT:
+        {
+            const parquet::FloatStatistics& typed = static_cast<const parquet::FloatStatistics&>(statistics);
+            *min = typed.min();
+            *max = typed.max();
+            return true;
+        }
+        case parquet::Type::DOUBLE:
+        {
+            const parquet::DoubleStatistics& typed = static_cast<const parquet::DoubleStatistics&>(statistics);
+            *min = typed.min();
+            *max = typed.max();
+            return true;
+        }
+        default:
+        {
+            return false;
+        }
+    }
+}
+
+/*----------------------------------------------------------------------------
+ * postBatch - builds and posts one record from a batch of rows
+ *----------------------------------------------------------------------------*/
+bool ArrowReader::impl::postBatch (ArrowReader* reader, const arrow::RecordBatch& batch)
+{
+    int rows = (int)batch.num_rows();
+    if(rows <= 0) return true;
+
+    /* Create Record of Rows */
+    int data_size = MAX(rows * reader->rowSizeBytes, RecordObject::getRecordDataSize(reader->recType));
+    RecordObject record(reader->recType, data_size, true);
+
+    /* Populate Fields from Columns */
+    for(int i = 0; i < reader->columnFields.length(); i++)
+    {
+        const column_field_t& column_field = reader->columnFields[i];
+        shared_ptr<arrow::Array> column = batch.GetColumnByName(column_field.name);
+        if(column) scatterColumn(*column, 0, rows, &record, column_field.field, reader->rowSizeBytes);
+    }
+
+    /* Populate Coordinates from Geometry */
+    if(reader->lonKey && !batch.GetColumnByName(reader->lonKey))
+    {
+        shared_ptr<arrow::Array> geometry = batch.GetColumnByName("geometry");
+        if(geometry) scatterGeometry(*geometry, 0, rows, &record, reader->lonField, reader->latField, reader->rowSizeBytes);
+    }
+
+    /* Post Record */
+    return reader->postRows(&record, rows);
+}
+
+/*----------------------------------------------------------------------------
+ * scatterColumn
+ *----------------------------------------------------------------------------*/
+void ArrowReader::impl::scatterColumn (const arrow::Array& array, int64_t start, int rows, RecordObject* record, const RecordObject::field_t& field, int row_size_bytes)
+{
+    switch(array.type_id())
+    {
+        case arrow::Type::DOUBLE:       scatterValues<double>(array, start, rows, record, field, row_size_bytes);     break;
+        case arrow::Type::FLOAT:        scatterValues<float>(array, start, rows, record, field, row_size_bytes);      break;
+        case arrow::Type::INT8:         scatterValues<int8_t>(array, start, rows, record, field, row_size_bytes);     break;
+        case arrow::Type::INT16:        scatterValues<int16_t>(array, start, rows, record, field, row_size_bytes);    break;
+        case arrow::Type::INT32:        scatterValues<int32_t>(array, start, rows, record, field, row_size_bytes);    break;
+        case arrow::Type::INT64:        scatterValues<int64_t>(array, start, rows, record, field, row_size_bytes);    break;
+        case arrow::Type::UINT8:        scatterValues<uint8_t>(array, start, rows, record, field, row_size_bytes);    break;
+        case arrow::Type::UINT16:       scatterValues<uint16_t>(array, start, rows, record, field, row_size_bytes);   break;
+        case arrow::Type::UINT32:       scatterValues<uint32_t>(array, start, rows, record, field, row_size_bytes);   break;
+        case arrow::Type::UINT64:       scatterValues<uint64_t>(array, start, rows, record, field, row_size_bytes);   break;
+        case arrow::Type::TIMESTAMP:    scatterValues<int64_t>(array, start, rows, record, field, row_size_bytes);    break;
+        case arrow::Type::STRING:
+        {
+            const arrow::StringArray& strings = static_cast<const arrow::StringArray&>(array);
+            RecordObject::field_t row_field = field;
+            for(int row = 0; row < rows; row++)
+            {
+                if(strings.IsNull(start + row))
+                {
+                    record->setValueText(row_field, "");
+                }
+                else
+                {
+                    std::string str = strings.GetString(start + row);
+                    record->setValueText(row_field, str.c_str());
+                }
+                row_field.offset += row_size_bytes * 8;
+            }
+            break;
+        }
+        default:
+        {
+            mlog(WARNING, "Unsupported column type for field at offset %d: %s", field.offset, array.type()->ToString().c_str());
+            break;
+        }
+    }
+}
+
+/*----------------------------------------------------------------------------
+ * scatterGeometry - decodes WKB points written by the ParquetBuilder
+ *----------------------------------------------------------------------------*/
+void ArrowReader::impl::scatterGeometry (const arrow::Array& array, int64_t start, int rows, RecordObject* record, const RecordObject::field_t& lon_field, const RecordObject::field_t& lat_field, int row_size_bytes)
+{
+    if(array.type_id() != arrow::Type::BINARY) return;
+
+    #ifdef __be__
+    const uint8_t native_order = 0;
+    #else
+    const uint8_t native_order = 1;
+    #endif
+
+    const arrow::BinaryArray& wkbs = static_cast<const arrow::BinaryArray&>(array);
+    RecordObject::field_t row_lon_field = lon_field;
+    RecordObject::field_t row_lat_field = lat_field;
+    for(int row = 0; row < rows; row++)
+    {
+        int32_t wkb_size = 0;
+        const uint8_t* wkb = wkbs.IsNull(start + row) ? NULL : wkbs.GetValue(start + row, &wkb_size);
+        if(wkb_size >= 21) // byte order, type, x, y
+        {
+            double x, y;
+            memcpy(&x, &wkb[5], sizeof(double));
+            memcpy(&y, &wkb[13], sizeof(double));
+            if(wkb[0] != native_order)
+            {
+                x = OsApi::swaplf(x);
+                y = OsApi::swaplf(y);
+            }
+            record->setValueReal(row_lon_field, x);
+            record->setValueReal(row_lat_field, y);
+        }
+        row_lon_field.offset += row_size_bytes * 8;
+        row_lat_field.offset += row_size_bytes * 8;
+    }
+}
+
+/*----------------------------------------------------------------------------
+ * scatterValues
+ *
+ *  writes a column into the strided field of each row; values are copied
+ *  directly when the column and field share a native representation and
+ *  converted through the record otherwise; null cells are written as NaN to
+ *  real fields and as zero to integer fields
+ *----------------------------------------------------------------------------*/
+template<typename T>
+void ArrowReader::impl::scatterValues (const arrow::Array& array, int64_t start, int rows, RecordObject* record, RecordObject::field_t field, int row_size_bytes)
+{
+    const T* values = array.data()->GetValues<T>(1) + start;
+    bool has_nulls = array.null_count() > 0;
+    bool field_is_real = (field.type == RecordObject::FLOAT) || (field.type == RecordObject::DOUBLE);
+    bool exact = !(field.flags & RecordObject::POINTER) &&
+                 (NATIVE_FLAGS == (field.flags & RecordObject::BIGENDIAN)) &&
+                 (RecordObject::FIELD_TYPE_BYTES[field.type] == (int)sizeof(T)) &&
+                 (std::is_floating_point<T>::value == field_is_real);
+
+    if(exact)
+    {
+        const T null_value = std::numeric_limits<T>::has_quiet_NaN ? std::numeric_limits<T>::quiet_NaN() : 0;
+        uint8_t* dst = record->getRecordData() + TOBYTES(field.offset);
+        for(int row = 0; row < rows; row++)
+        {
+            const T* value = (has_nulls && array.IsNull(start + row)) ? &null_value : &values[row];
+            memcpy(dst, value, sizeof(T)); // records are packed, so fields may be unaligned
+            dst += row_size_bytes;
+        }
+    }
+    else
+    {
+        for(int row = 0; row < rows; row++)
+        {
+            if(has_nulls && array.IsNull(start + row))
+            {
+                if(field_is_real)                   record->setValueReal(field, std::numeric_limits<double>::quiet_NaN());
+                else                                record->setValueInteger(field, 0);
+            }
+            else if(std::is_floating_point<T>::value)   record->setValueReal(field, (double)values[row]);
+            else                                        record->setValueInteger(field, (long)values[row]);
+            field.offset += row_size_bytes * 8;
+        }
+    }
+}
+
+/******************************************************************************
+ * STATIC DATA
+ ******************************************************************************/
+
+const char* ArrowReader::OBJECT_TYPE = "ArrowReader";
+const char* ArrowReader::LuaMetaName = "ArrowReader";
+const struct luaL_Reg ArrowReader::LuaMetaTable[] = {
+    {"stats",       luaStats},
+    {NULL,          NULL}
+};
+
+/******************************************************************************
+ * PUBLIC METHODS
+ ******************************************************************************/
+
+/*----------------------------------------------------------------------------
+ * luaCreate - :reader(<parms>, <outq_name>, <rec_type>, [<lon_key>, <lat_key>], [<filters>], [<send terminator>])
+ *
+ *  <filters> is a table of {<column> = {<min>, <max>}}; row groups whose
+ *  statistics for a column fall entirely outside its range are skipped
+ *----------------------------------------------------------------------------*/
+int ArrowReader::luaCreate (lua_State* L)
+{
+    ArrowParms* _parms = NULL;
+
+    try
+    {
+        /* Get Parameters */
+        _parms                  = (ArrowParms*)getLuaObject(L, 1, ArrowParms::OBJECT_TYPE);
+        const char* outq_name   = getLuaString(L, 2);
+        const char* rec_type    = getLuaString(L, 3);
+        const char* lon_key     = getLuaString(L, 4, true, NULL);
+        const char* lat_key     = getLuaString(L, 5, true, NULL);
+        int filter_index        = lua_istable(L, 6) ? 6 : 0;
+        bool send_terminator    = getLuaBoolean(L, 7, true, true);
+
+        /* Check Parameters */
+        if(_parms->format != ArrowParms::PARQUET && _parms->format != ArrowParms::FEATHER)
+        {
+            throw RunTimeException(CRITICAL, RTE_ERROR, "Arrow reader only supports parquet and feather files");
+        }
+        else if(!_parms->path)
+        {
+            throw RunTimeException(CRITICAL, RTE_ERROR, "Arrow reader requires a path");
+        }
+        else if(RecordObject::getRecordDataSize(rec_type) <= 0)
+        {
+            throw RunTimeException(CRITICAL, RTE_ERROR, "Invalid record type: %s", rec_type);
+        }
+
+        /* Create Reader */
+        return createLuaObject(L, new ArrowReader(L, _parms, outq_name, rec_type, lon_key, lat_key, filter_index, send_terminator));
+    }
+    catch(const RunTimeException& e)
+    {
+        if(_parms) _parms->releaseLuaObject();
+        mlog(e.level(), "Error creating %s: %s", LuaMetaName, e.what());
+        return returnLuaStatus(L, false);
+    }
+}
+
+/******************************************************************************
+ * PRIVATE METHODS
+ *******************************************************************************/
+
+/*----------------------------------------------------------------------------
+ * Constructor
+ *----------------------------------------------------------------------------*/
+ArrowReader::ArrowReader (lua_State* L, ArrowParms* _parms, const char* outq_name,
+                          const char* rec_type, const char* lon_key, const char* lat_key,
+                          int filter_index, bool _send_terminator):
+    LuaObject(L, OBJECT_TYPE, LuaMetaName, LuaMetaTable)
+{
+    assert(_parms);
+    assert(outq_name);
+    assert(rec_type);
+
+    /* Initialize Attributes */
+    parms = _parms;
+    outQ = new Publisher(outq_name);
+    recType = StringLib::duplicate(rec_type);
+    rowSizeBytes = RecordObject::getRecordDataSize(rec_type);
+    rowsPerRecord = MAX(RECORD_DATA_SIZE / rowSizeBytes, 1);
+    sendTerminator = _send_terminator;
+    memset(&stats, 0, sizeof(stats));
+
+    /* Map Record Fields to Columns */
+    addColumnFields(rec_type, 0);
+
+    /* Geometry Fields */
+    lonKey = NULL;
+    latKey = NULL;
+    if(lon_key && lat_key)
+    {
+        lonField = RecordObject::getDefinedField(rec_type, lon_key);
+        latField = RecordObject::getDefinedField(rec_type, lat_key);
+        if(lonField.type != RecordObject::INVALID_FIELD && latField.type != RecordObject::INVALID_FIELD)
+        {
+            lonKey = StringLib::duplicate(lon_key);
+            latKey = StringLib::duplicate(lat_key);
+        }
+        else
+        {
+            mlog(WARNING, "Geometry fields %s, %s not found in %s, geometry column will not be read", lon_key, lat_key, rec_type);
+        }
+    }
+
+    /* Row Group Filters */
+    if(filter_index > 0) addRangeFilters(L, filter_index);
+
+    /* Start Reader Thread */
+    active = true;
+    readerPid = new Thread(readerThread, this);
+}
+
+/*----------------------------------------------------------------------------
+ * Destructor
+ *----------------------------------------------------------------------------*/
+ArrowReader::~ArrowReader (void)
+{
+    active = false;
+    delete readerPid;
+    parms->releaseLuaObject();
+    delete outQ;
+    delete [] recType;
+    delete [] lonKey;
+    delete [] latKey;
+    for(int i = 0; i < columnFields.length(); i++) delete [] columnFields[i].name;
+    for(int i = 0; i < rangeFilters.length(); i++) delete [] rangeFilters[i].column;
+}
+
+/*----------------------------------------------------------------------------
+ * addColumnFields - flattens nested record types like the ParquetBuilder schema
+ *----------------------------------------------------------------------------*/
+void ArrowReader::addColumnFields (const char* rec_type, int offset)
+{
+    char** field_names = NULL;
+    RecordObject::field_t** fields = NULL;
+    int num_fields = RecordObject::getRecordFields(rec_type, &field_names, &fields);
+    for(int i = 0; i < num_fields; i++)
+    {
+        if(fields[i]->type == RecordObject::USER)
+        {
+            addColumnFields(fields[i]->exttype, fields[i]->offset + offset);
+        }
+        else if(fields[i]->type != RecordObject::INVALID_FIELD)
+        {
+            column_field_t column_field = {
+                .name = StringLib::duplicate(field_names[i]),
+                .field = *fields[i]
+            };
+            column_field.field.offset += offset;
+            columnFields.add(column_field);
+        }
+        delete [] field_names[i];
+        delete fields[i];
+    }
+    if(fields) delete [] fields;
+    if(field_names) delete [] field_names;
+}
+
+/*----------------------------------------------------------------------------
+ * addRangeFilters
+ *----------------------------------------------------------------------------*/
+void ArrowReader::addRangeFilters (lua_State* L, int index)
+{
+    lua_pushnil(L);
+    while(lua_next(L, index) != 0)
+    {
+        /* Bounds are checked here, not thrown on, so the key stays balanced on the stack */
+        bool valid = false;
+        if(lua_type(L, -2) == LUA_TSTRING && lua_istable(L, -1) && lua_rawlen(L, -1) == 2)
+        {
+            lua_rawgeti(L, -1, 1);
+            lua_rawgeti(L, -2, 2);
+            if(lua_isnumber(L, -2) && lua_isnumber(L, -1))
+            {
+                range_filter_t filter;
+                filter.min = lua_tonumber(L, -2);
+                filter.max = lua_tonumber(L, -1);
+                filter.column = StringLib::duplicate(lua_tostring(L, -4));
+                rangeFilters.add(filter);
+                mlog(DEBUG, "Filtering row groups on %s to [%lf, %lf]", filter.column, filter.min, filter.max);
+                valid = true;
+            }
+            lua_pop(L, 2);
+        }
+
+        if(!valid)
+        {
+            mlog(WARNING, "Ignoring invalid row group filter, must be <column> = {<min>, <max>}");
+        }
+        lua_pop(L, 1);
+    }
+}
+
+/*----------------------------------------------------------------------------
+ * readerThread
+ *----------------------------------------------------------------------------*/
+void* ArrowReader::readerThread (void* parm)
+{
+    ArrowReader* reader = (ArrowReader*)parm;
+    const char* path = reader->parms->path;
+    uint32_t trace_id = start_trace(INFO, reader->traceId, "arrow_reader", "{\"path\":\"%s\"}", path);
+    EventLib::stashId(trace_id);
+
+    if(StringLib::size(path) > 5 && path[0] == 's' && path[1] == '3' && path[2] == ':' && path[3] == '/' && path[4] == '/')
+    {
+        #ifdef __aws__
+        /* Get Bucket and Key */
+        char* bucket = StringLib::duplicate(&path[5]);
+        char* key = bucket;
+        while(*key != '\0' && *key != '/') key++;
+        if(*key == '/') *key++ = '\0';
+
+        /* Read Ranges of Object */
+        try
+        {
+            shared_ptr<arrow::io::RandomAccessFile> file = std::make_shared<S3RandomAccessFile>(bucket, key, reader->parms->region, &reader->parms->credentials);
+            impl::readInput(reader, file, path);
+        }
+        catch(const RunTimeException& e)
+        {
+            LuaEndpoint::generateExceptionStatus(RTE_ERROR, e.level(), reader->outQ, &reader->active, "Failed to open %s: %s", path, e.what());
+        }
+        delete [] bucket;
+        #else
+        LuaEndpoint::generateExceptionStatus(RTE_ERROR, CRITICAL, reader->outQ, &reader->active, "Input path specifies S3, but server compiled without AWS support");
+        #endif
+    }
+    else
+    {
+        /* Read Local File */
+        reader->readFile(path);
+    }
+
+    /* Indicate End of Data */
+    mlog(INFO, "Completed reading %s: %u row groups read, %u skipped, %u rows sent", path, reader->stats.row_groups_read, reader->stats.row_groups_skipped, reader->stats.rows_sent);
+    if(reader->sendTerminator) reader->outQ->postCopy("", 0);
+    reader->signalComplete();
+
+    stop_trace(INFO, trace_id);
+    return NULL;
+}
+
+/*----------------------------------------------------------------------------
+ * readFile
+ *----------------------------------------------------------------------------*/
+bool ArrowReader::readFile (const char* filename)
+{
+    arrow::Result<shared_ptr<arrow::io::ReadableFile>> result = arrow::io::ReadableFile::Open(filename);
+    if(!result.ok())
+    {
+        LuaEndpoint::generateExceptionStatus(RTE_ERROR, CRITICAL, outQ, &active, "Failed to open %s: %s", filename, result.status().ToString().c_str());
+        return false;
+    }
+
+    return impl::readInput(this, result.ValueOrDie(), filename);
+}
+
+/*----------------------------------------------------------------------------
+ * postRows
+ *----------------------------------------------------------------------------*/
+bool ArrowReader::postRows (RecordObject* record, int rows)
+{
+    unsigned char* rec_buf;
+    int rec_size = record->serialize(&rec_buf, RecordObject::REFERENCE);
+    int post_status = MsgQ::STATE_TIMEOUT;
+    while(active && ((post_status = outQ->postCopy(rec_buf, rec_size, SYS_TIMEOUT)) == MsgQ::STATE_TIMEOUT));
+    if(post_status <= 0)
+    {
+        mlog(CRITICAL, "Failed (%d) to post %s record", post_status, recType);
+        return false;
+    }
+
+    stats.rows_sent += rows;
+    return true;
+}
+
+/*----------------------------------------------------------------------------
+ * luaStats - :stats(<with_clear>) --> {<key>=<value>, ...} containing statistics
+ *----------------------------------------------------------------------------*/
+int ArrowReader::luaStats (lua_State* L)
+{
+    bool status = false;
+    int num_obj_to_return = 1;
+    ArrowReader* lua_obj = NULL;
+
+    try
+    {
+        /* Get Self */
+        lua_obj = (ArrowReader*)getLuaSelf(L, 1);
+    }
+    catch(const RunTimeException& e)
+    {
+        return luaL_error(L, "method invoked from invalid object: %s", __FUNCTION__);
+    }
+
+    try
+    {
+        /* Get Clear Parameter */
+        bool with_clear = getLuaBoolean(L, 2, true, false);
+
+        /* Create Statistics Table */
+        lua_newtable(L);
+        LuaEngine::setAttrInt(L, "read",        lua_obj->stats.row_groups_read);
+        LuaEngine::setAttrInt(L, "skipped",     lua_obj->stats.row_groups_skipped);
+        LuaEngine::setAttrInt(L, "sent",        lua_obj->stats.rows_sent);
+
+        /* Clear if Requested */
+        if(with_clear) memset(&lua_obj->stats, 0, sizeof(lua_obj->stats));
+
+        /* Set Success */
+        status = true;
+        num_obj_to_return = 2;
+    }
+    catch(const RunTimeException& e)
+    {
+        mlog(e.level(), "Error returning stats %s: %s", lua_obj->getName(), e.what());
+    }
+
+    /* Return Status */
+    return returnLuaStatus(L, status, num_obj_to_return);
+}
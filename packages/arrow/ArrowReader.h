@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2021, University of Washington
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the University of Washington nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY OF WASHINGTON AND CONTRIBUTORS
+ * “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE UNIVERSITY OF WASHINGTON OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __arrow_reader__
+#define __arrow_reader__
+
+/*
+ * ArrowReader streams the rows of a Parquet or Feather file back out as
+ * records.  Each posted record is of type `rec_type` and holds a batch of rows,
+ * the same layout the ParquetBuilder consumes; columns are matched to fields by
+ * name, so only the columns of the record type are read from the file.
+ */
+
+/******************************************************************************
+ * INCLUDES
+ ******************************************************************************/
+
+#include "MsgQ.h"
+#include "LuaObject.h"
+#include "List.h"
+#include "RecordObject.h"
+#include "ArrowParms.h"
+#include "OsApi.h"
+
+/******************************************************************************
+ * ARROW READER CLASS
+ ******************************************************************************/
+
+class ArrowReader: public LuaObject
+{
+    public:
+
+        /*--------------------------------------------------------------------
+         * Constants
+         *--------------------------------------------------------------------*/
+
+        static const int LIST_BLOCK_SIZE = 32;
+        static const int RECORD_DATA_SIZE = 0x100000; // 1MB, target size of rows posted per record
+
+        static const char* OBJECT_TYPE;
+        static const char* LuaMetaName;
+        static const struct luaL_Reg LuaMetaTable[];
+
+        /*--------------------------------------------------------------------
+         * Methods
+         *--------------------------------------------------------------------*/
+
+        static int  luaCreate   (lua_State* L);
+
+    private:
+
+        /*--------------------------------------------------------------------
+         * Types
+         *--------------------------------------------------------------------*/
+
+        typedef struct {
+            const char*             name; // column name in file
+            RecordObject::field_t   field;
+        } column_field_t;
+
+        typedef struct {
+            const char*             column; // dotted path of parquet column
+            double                  min;
+            double                  max;
+        } range_filter_t;
+
+        typedef struct {
+            uint32_t                row_groups_read;
+            uint32_t                row_groups_skipped;
+            uint32_t                rows_sent;
+        } stats_t;
+
+        /*--------------------------------------------------------------------
+         * Data
+         *--------------------------------------------------------------------*/
+
+        Thread*                                 readerPid;
+        bool                                    active;
+        ArrowParms*                             parms;
+        Publisher*                              outQ;
+        const char*                             recType;
+        int                                     rowSizeBytes;
+        int                                     rowsPerRecord;
+        List<column_field_t, LIST_BLOCK_SIZE>   columnFields;
+        const char*                             lonKey; // lon/lat fields filled from geometry column when not in file
+        const char*                             latKey;
+        RecordObject::field_t                   lonField;
+        RecordObject::field_t                   latField;
+        List<range_filter_t, LIST_BLOCK_SIZE>   rangeFilters;
+        bool                                    sendTerminator;
+        stats_t                                 stats;
+
+        struct impl; // arrow implementation
+
+        /*--------------------------------------------------------------------
+         * Methods
+         *--------------------------------------------------------------------*/
+
+                        ArrowReader         (lua_State* L, ArrowParms* _parms, const char* outq_name,
+                                             const char* rec_type, const char* lon_key, const char* lat_key,
+                                             int filter_index, bool _send_terminator);
+                        ~ArrowReader        (void);
+
+        void            addColumnFields     (const char* rec_type, int offset);
+        void            addRangeFilters     (lua_State* L, int index);
+        static void*    readerThread        (void* parm);
+        bool            readFile            (const char* filename);
+        bool            postRows            (RecordObject* record, int rows);
+        static int      luaStats            (lua_State* L);
+};
+
+#endif  /* __arrow_reader__ */
@@ -34,14 +34,25 @@
  ******************************************************************************/
 
 #include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+#include <arrow/array.h>
+#include <arrow/buffer.h>
 #include <arrow/builder.h>
+#include <arrow/memory_pool.h>
 #include <arrow/table.h>
 #include <arrow/io/file.h>
+#include <arrow/io/interfaces.h>
+#include <arrow/util/compression.h>
 #include <arrow/util/key_value_metadata.h>
+#include <arrow/ipc/writer.h>
 #include <parquet/arrow/writer.h>
 #include <parquet/arrow/schema.h>
 #include <parquet/properties.h>
 #include <parquet/file_writer.h>
+#include <atomic>
+#include <unordered_set>
 
 #include "core.h"
 #include "ParquetBuilder.h"
@@ -56,22 +67,631 @@ using std::unique_ptr;
 using std::make_shared;
 using std::vector;
 
+/******************************************************************************
+ * PRIVATE IMPLEMENTATION
+ ******************************************************************************/
+
+struct ParquetBuilder::column_job_t
+{
+    const vector<batch_t>*              batches;
+    field_iterator_t*                   fields;
+    const geo_data_t*                   geo;
+    int                                 rowSizeBytes;
+    int                                 numRows;
+    uint32_t                            traceId;
+    arrow::MemoryPool*                  pool;
+    vector<shared_ptr<arrow::Array>>    columns;
+    Cond                                complete;
+    int                                 remaining;
+};
+
+struct ParquetBuilder::partition_t
+{
+    const char*                             name;       // hive style directory, e.g. rgt=1234
+    const char*                             fileName;   // local file uploaded when partition is closed
+    int                                     writer;     // index of writer thread that owns the file
+    vector<uint8_t>                         staged;     // rows waiting to fill a row group
+    int                                     rows;
+    bool                                    failed;     // file or writer failed to open, rows are dropped
+    shared_ptr<arrow::io::OutputStream>     outputStream;
+    unique_ptr<parquet::arrow::FileWriter>  parquetWriter;
+};
+
+#ifndef APACHE_ARROW_10_COMPAT
+/*----------------------------------------------------------------------------
+ * TrackedMemoryPool
+ *
+ *  arrow memory pool that counts the bytes held by a single request on top of
+ *  the default pool; allocations never block since they are made on the
+ *  shared column threads, instead the request's own threads size each row
+ *  group to the headroom left under the budget before building it
+ *----------------------------------------------------------------------------*/
+class TrackedMemoryPool: public arrow::MemoryPool
+{
+    public:
+
+        explicit TrackedMemoryPool (int64_t _budget):
+            pool(arrow::default_memory_pool()),
+            budget(_budget),
+            bytes(0),
+            peak(0),
+            total(0),
+            allocations(0)
+        {
+        }
+
+        arrow::Status Allocate (int64_t size, int64_t alignment, uint8_t** out) override
+        {
+            arrow::Status status = pool->Allocate(size, alignment, out);
+            if(status.ok())
+            {
+                reserve(size);
+                total += size;
+                allocations++;
+            }
+            return status;
+        }
+
+        arrow::Status Reallocate (int64_t old_size, int64_t new_size, int64_t alignment, uint8_t** ptr) override
+        {
+            arrow::Status status = pool->Reallocate(old_size, new_size, alignment, ptr);
+            if(status.ok())
+            {
+                if(new_size > old_size)
+                {
+                    reserve(new_size - old_size);
+                    total += new_size - old_size;
+                }
+                else
+                {
+                    bytes -= old_size - new_size;
+                }
+            }
+            return status;
+        }
+
+        void Free (uint8_t* buffer, int64_t size, int64_t alignment) override
+        {
+            pool->Free(buffer, size, alignment);
+            bytes -= size;
+        }
+
+        void ReleaseUnused (void) override  { pool->ReleaseUnused(); }
+        int64_t bytes_allocated (void) const override { return bytes.load(); }
+        int64_t max_memory (void) const override { return peak.load(); }
+        int64_t total_bytes_allocated (void) const override { return total.load(); }
+        int64_t num_allocations (void) const override { return allocations.load(); }
+        std::string backend_name (void) const override { return pool->backend_name(); }
+
+        /*--------------------------------------------------------------------
+         * headroom - bytes a row group may use without going over budget
+         *
+         *  with a single writer this is what the budget has left; when the
+         *  budget is shared by concurrent writers (partitions) each writer
+         *  gets a fixed share since the others' row groups are in flight
+         *--------------------------------------------------------------------*/
+        int64_t headroom (int shares) const
+        {
+            if(budget <= 0) return INT64_MAX;
+            if(shares > 1) return budget / shares;
+            return MAX(budget - bytes.load(), (int64_t)0);
+        }
+
+        int64_t getBudget (void) const { return budget; }
+
+    private:
+
+        arrow::MemoryPool*      pool;
+        int64_t                 budget; // 0 is unlimited
+        std::atomic<int64_t>    bytes;
+        std::atomic<int64_t>    peak;
+        std::atomic<int64_t>    total;
+        std::atomic<int64_t>    allocations;
+
+        void reserve (int64_t size)
+        {
+            int64_t held = (bytes += size);
+            int64_t prev = peak.load();
+            while(held > prev && !peak.compare_exchange_weak(prev, held)) {}
+        }
+};
+#endif
+
+/*----------------------------------------------------------------------------
+ * isS3Path
+ *----------------------------------------------------------------------------*/
+static bool isS3Path (const char* path)
+{
+    return path && StringLib::size(path) > 5 && path[0] == 's' && path[1] == '3' && path[2] == ':' && path[3] == '/' && path[4] == '/';
+}
+
+/*----------------------------------------------------------------------------
+ * ClientOutputStream
+ *
+ *  arrow output stream that posts the bytes of the file to the client as they
+ *  are written; a meta record with an unknown (-1) size is posted ahead of the
+ *  first bytes and an eof record with the final size ends the transfer; an
+ *  aborted stream posts neither so that the client only sees the error
+ *----------------------------------------------------------------------------*/
+class ClientOutputStream: public arrow::io::OutputStream
+{
+    public:
+
+        ClientOutputStream (Publisher* _outq, const char* _filename):
+            outQ(_outq),
+            dataRecord(ParquetBuilder::dataRecType, 0, false),
+            position(0),
+            bufferIndex(0),
+            isStarted(false),
+            isClosed(false)
+        {
+            data = (ParquetBuilder::arrow_file_data_t*)dataRecord.getRecordData();
+            StringLib::copy(&data->filename[0], _filename, ParquetBuilder::FILE_NAME_MAX_LEN);
+        }
+
+        ~ClientOutputStream (void) override
+        {
+            (void)Close();
+        }
+
+        arrow::Status Close (void) override
+        {
+            if(isClosed) return arrow::Status::OK();
+            isClosed = true;
+            if(!start()) return arrow::Status::IOError("failed to post start of parquet file to client");
+            if(!postData()) return arrow::Status::IOError("failed to post parquet data to client");
+            if(!postFileRecord(ParquetBuilder::eofRecType, position)) return arrow::Status::IOError("failed to post end of parquet file to client");
+            return arrow::Status::OK();
+        }
+
+        arrow::Status Abort (void) override
+        {
+            /* Closes the stream without completing the transfer */
+            isClosed = true;
+            bufferIndex = 0;
+            return arrow::Status::OK();
+        }
+
+        bool closed (void) const override
+        {
+            return isClosed;
+        }
+
+        arrow::Result<int64_t> Tell (void) const override
+        {
+            return position;
+        }
+
+        arrow::Status Flush (void) override
+        {
+            if(isClosed) return arrow::Status::OK();
+            if(!postData()) return arrow::Status::IOError("failed to post parquet data to client");
+            return arrow::Status::OK();
+        }
+
+        arrow::Status Write (const void* buffer, int64_t nbytes) override
+        {
+            if(isClosed) return arrow::Status::Invalid("write to closed stream");
+            const uint8_t* src = (const uint8_t*)buffer;
+            while(nbytes > 0)
+            {
+                int64_t bytes_to_copy = MIN(nbytes, (int64_t)ParquetBuilder::STREAM_BUFFER_SIZE - bufferIndex);
+                memcpy(&data->data[bufferIndex], src, bytes_to_copy);
+                bufferIndex += bytes_to_copy;
+                position += bytes_to_copy;
+                src += bytes_to_copy;
+                nbytes -= bytes_to_copy;
+                if(bufferIndex >= ParquetBuilder::STREAM_BUFFER_SIZE)
+                {
+                    if(!postData()) return arrow::Status::IOError("failed to post parquet data to client");
+                }
+            }
+            return arrow::Status::OK();
+        }
+
+    private:
+
+        /* Posts the meta record ahead of the first bytes of the file */
+        bool start (void)
+        {
+            if(isStarted) return true;
+            isStarted = true;
+            return postFileRecord(ParquetBuilder::metaRecType, -1);
+        }
+
+        /* Posts buffered bytes as a right sized data record */
+        bool postData (void)
+        {
+            if(bufferIndex == 0) return true;
+            if(!start()) return false;
+            uint8_t* rec_buf = NULL;
+            int rec_bytes = dataRecord.serialize(&rec_buf, RecordObject::ALLOCATE, offsetof(ParquetBuilder::arrow_file_data_t, data) + bufferIndex);
+            int post_status;
+            while((post_status = outQ->postRef(rec_buf, rec_bytes, SYS_TIMEOUT)) == MsgQ::STATE_TIMEOUT);
+            if(post_status <= 0)
+            {
+                delete [] rec_buf;
+                mlog(ERROR, "Failed to post parquet data to %s: %d", outQ->getName(), post_status);
+                return false;
+            }
+            bufferIndex = 0;
+            return true;
+        }
+
+        /* Posts meta or eof record */
+        bool postFileRecord (const char* rec_type, long size)
+        {
+            RecordObject record(rec_type);
+            ParquetBuilder::arrow_file_meta_t* meta = (ParquetBuilder::arrow_file_meta_t*)record.getRecordData();
+            StringLib::copy(&meta->filename[0], data->filename, ParquetBuilder::FILE_NAME_MAX_LEN);
+            meta->size = size;
+            return record.post(outQ);
+        }
+
+        Publisher*                          outQ;
+        RecordObject                        dataRecord; // staging buffer
+        ParquetBuilder::arrow_file_data_t*  data;
+        int64_t                             position;
+        int64_t                             bufferIndex;
+        bool                                isStarted;
+        bool                                isClosed;
+};
+
 /******************************************************************************
  * PRIVATE IMPLEMENTATION
  ******************************************************************************/
 
 struct ParquetBuilder::impl
 {
+    #ifndef APACHE_ARROW_10_COMPAT
+    unique_ptr<TrackedMemoryPool>           trackedPool; // declared first so it outlives the buffers it tracks
+    #endif
+    arrow::MemoryPool*                      memoryPool;
     shared_ptr<arrow::Schema>               schema;
+    shared_ptr<arrow::io::OutputStream>     outputStream;
     unique_ptr<parquet::arrow::FileWriter>  parquetWriter;
+    shared_ptr<arrow::ipc::RecordBatchWriter> ipcWriter;
+    shared_ptr<parquet::WriterProperties>   writerProps;
+    shared_ptr<parquet::ArrowWriterProperties> arrowWriterProps;
+    Mutex                                   writerPropsMut; // partitions select encodings from their own first row group
+
+    typedef struct {
+        int64_t samples;
+        int64_t distinct;
+        bool    monotonic;
+    } column_profile_t;
+
+    explicit impl (long memory_budget);
+
+    int rowsInBudget (int row_size, int shares);
+    int64_t memoryBudget (void);
+    void admitRowGroup (int64_t size);
+    void completeRowGroup (int64_t size);
+
+    bool openParquetWriter (const shared_ptr<arrow::io::OutputStream>& stream, unique_ptr<parquet::arrow::FileWriter>& writer);
+    void selectEncodings (const vector<shared_ptr<arrow::Array>>& columns, bool page_index);
+
+    static void selectColumnEncoding (parquet::WriterProperties::Builder& builder, const std::string& path, const shared_ptr<arrow::Array>& column, bool zstd);
+    template<typename A> static column_profile_t profileColumn (const arrow::Array& column);
+    static column_profile_t profileBinaryColumn (const arrow::BinaryArray& column);
 
     static shared_ptr<arrow::Schema> defineTableSchema (field_list_t& field_list, const char* batch_rec_type, const geo_data_t& geo);
     static bool addFieldsToSchema (vector<shared_ptr<arrow::Field>>& schema_vector, field_list_t& field_list, const geo_data_t& geo, const char* batch_rec_type, int offset);
-    static void appendGeoMetaData (const std::shared_ptr<arrow::KeyValueMetadata>& metadata);
+    static void appendGeoMetaData (const std::shared_ptr<arrow::KeyValueMetadata>& metadata, bool covering);
     static void appendServerMetaData (const std::shared_ptr<arrow::KeyValueMetadata>& metadata);
     static void appendPandasMetaData (const std::shared_ptr<arrow::KeyValueMetadata>& metadata, const shared_ptr<arrow::Schema>& _schema, const field_iterator_t* field_iterator, const char* index_key);
+    static shared_ptr<arrow::Array> buildColumn (const RecordObject::field_t& field, const vector<batch_t>& batches, int row_size_bytes, int num_rows, arrow::MemoryPool* pool);
+    static shared_ptr<arrow::Array> buildGeometryColumn (const geo_data_t& geo, const vector<batch_t>& batches, int row_size_bytes, int num_rows, arrow::MemoryPool* pool);
+    static shared_ptr<arrow::Array> buildCoveringColumn (const geo_data_t& geo, const vector<batch_t>& batches, int row_size_bytes, int num_rows, arrow::MemoryPool* pool);
+    static RecordObject* sortRows (const geo_data_t& geo, const vector<batch_t>& batches, const char* rec_type, int row_size_bytes, int num_rows);
+    static shared_ptr<arrow::Array> buildStringColumn (const RecordObject::field_t& field, const vector<batch_t>& batches, int row_size_bytes, int num_rows, arrow::MemoryPool* pool);
+    template<typename T> static shared_ptr<arrow::Array> gatherColumn (const shared_ptr<arrow::DataType>& type, const RecordObject::field_t& field, const vector<batch_t>& batches, int row_size_bytes, int num_rows, arrow::MemoryPool* pool);
+    template<typename T, bool SWAP> static void gatherRows (T* dst, const uint8_t* src, int rows, int row_size_bytes);
+    template<typename T> static void gatherPointerRows (T* dst, RecordObject* record, RecordObject::field_t field, int rows, int row_size_bytes);
 };
 
+/*----------------------------------------------------------------------------
+ * swapValue - byte swap overloads used by the gather kernels
+ *----------------------------------------------------------------------------*/
+static inline int8_t   swapValue (int8_t val)   { return val; }
+static inline uint8_t  swapValue (uint8_t val)  { return val; }
+static inline int16_t  swapValue (int16_t val)  { return (int16_t)OsApi::swaps((uint16_t)val); }
+static inline uint16_t swapValue (uint16_t val) { return OsApi::swaps(val); }
+static inline int32_t  swapValue (int32_t val)  { return (int32_t)OsApi::swapl((uint32_t)val); }
+static inline uint32_t swapValue (uint32_t val) { return OsApi::swapl(val); }
+static inline int64_t  swapValue (int64_t val)  { return (int64_t)OsApi::swapll((uint64_t)val); }
+static inline uint64_t swapValue (uint64_t val) { return OsApi::swapll(val); }
+static inline float    swapValue (float val)    { return OsApi::swapf(val); }
+static inline double   swapValue (double val)   { return OsApi::swaplf(val); }
+
+/*----------------------------------------------------------------------------
+ * hilbertIndex - distance along a hilbert curve covering the lon/lat plane
+ *----------------------------------------------------------------------------*/
+static uint64_t hilbertIndex (double lon, double lat, int order)
+{
+    const uint64_t n = 1ULL << order;
+
+    /* Invalid Coordinates Sort Last */
+    if(std::isnan(lon) || std::isnan(lat)) return UINT64_MAX;
+
+    /* Quantize Coordinates to Grid */
+    uint64_t x = (uint64_t)MIN(MAX((lon + 180.0) / 360.0 * n, 0.0), (double)(n - 1));
+    uint64_t y = (uint64_t)MIN(MAX((lat + 90.0) / 180.0 * n, 0.0), (double)(n - 1));
+
+    /* Walk Quadrants from Coarsest to Finest */
+    uint64_t d = 0;
+    for(uint64_t s = n / 2; s > 0; s /= 2)
+    {
+        uint64_t rx = (x & s) ? 1 : 0;
+        uint64_t ry = (y & s) ? 1 : 0;
+        d += s * s * ((3 * rx) ^ ry);
+        if(ry == 0)
+        {
+            if(rx == 1)
+            {
+                x = n - 1 - x;
+                y = n - 1 - y;
+            }
+            uint64_t t = x;
+            x = y;
+            y = t;
+        }
+    }
+
+    return d;
+}
+
+/*----------------------------------------------------------------------------
+ * impl constructor
+ *----------------------------------------------------------------------------*/
+ParquetBuilder::impl::impl (long memory_budget)
+{
+    #ifndef APACHE_ARROW_10_COMPAT
+    trackedPool.reset(new TrackedMemoryPool(memory_budget));
+    memoryPool = trackedPool.get();
+    #else
+    (void)memory_budget;
+    memoryPool = arrow::default_memory_pool();
+    #endif
+}
+
+/*----------------------------------------------------------------------------
+ * rowsInBudget - most rows a row group can hold under the memory budget
+ *----------------------------------------------------------------------------*/
+int ParquetBuilder::impl::rowsInBudget (int row_size, int shares)
+{
+    #ifndef APACHE_ARROW_10_COMPAT
+    int64_t headroom = trackedPool->headroom(shares);
+    return (int)MIN(headroom / MAX(row_size, 1), (int64_t)INT32_MAX);
+    #else
+    (void)row_size;
+    (void)shares;
+    return INT32_MAX;
+    #endif
+}
+
+/*----------------------------------------------------------------------------
+ * memoryBudget
+ *----------------------------------------------------------------------------*/
+int64_t ParquetBuilder::impl::memoryBudget (void)
+{
+    #ifndef APACHE_ARROW_10_COMPAT
+    return trackedPool->getBudget();
+    #else
+    return 0;
+    #endif
+}
+
+/*----------------------------------------------------------------------------
+ * admitRowGroup - reports a row group to the memory check of new requests
+ *----------------------------------------------------------------------------*/
+void ParquetBuilder::impl::admitRowGroup (int64_t size)
+{
+    LuaEndpoint::reserveMemory(size);
+}
+
+/*----------------------------------------------------------------------------
+ * completeRowGroup
+ *----------------------------------------------------------------------------*/
+void ParquetBuilder::impl::completeRowGroup (int64_t size)
+{
+    LuaEndpoint::releaseMemory(size);
+}
+
+/*----------------------------------------------------------------------------
+ * openParquetWriter
+ *----------------------------------------------------------------------------*/
+bool ParquetBuilder::impl::openParquetWriter (const shared_ptr<arrow::io::OutputStream>& stream, unique_ptr<parquet::arrow::FileWriter>& writer)
+{
+    #ifdef APACHE_ARROW_10_COMPAT
+        (void)parquet::arrow::FileWriter::Open(*schema, memoryPool, stream, writerProps, arrowWriterProps, &writer);
+    #elif 0 // alternative method of creating file writer
+        std::shared_ptr<parquet::SchemaDescriptor> parquet_schema;
+        (void)parquet::arrow::ToParquetSchema(schema.get(), *writerProps, *arrowWriterProps, &parquet_schema);
+        auto schema_node = std::static_pointer_cast<parquet::schema::GroupNode>(parquet_schema->schema_root());
+        std::unique_ptr<parquet::ParquetFileWriter> base_writer;
+        base_writer = parquet::ParquetFileWriter::Open(stream, schema_node, writerProps, schema->metadata());
+        auto schema_ptr = std::make_shared<::arrow::Schema>(*schema);
+        (void)parquet::arrow::FileWriter::Make(memoryPool, std::move(base_writer), std::move(schema_ptr), arrowWriterProps, &writer);
+    #else
+        arrow::Result<std::unique_ptr<parquet::arrow::FileWriter>> result = parquet::arrow::FileWriter::Open(*schema, memoryPool, stream, writerProps, arrowWriterProps);
+        if(result.ok()) writer = std::move(result).ValueOrDie();
+        else mlog(CRITICAL, "Failed to open parquet writer: %s", result.status().ToString().c_str());
+    #endif
+    return writer != nullptr;
+}
+
+/*----------------------------------------------------------------------------
+ * selectEncodings - builds the writer properties from the first row group
+ *
+ *  each column is sampled to pick its encoding and compression; the choice is
+ *  made once so every row group (and every partition) of the output shares it
+ *----------------------------------------------------------------------------*/
+void ParquetBuilder::impl::selectEncodings (const vector<shared_ptr<arrow::Array>>& columns, bool page_index)
+{
+    writerPropsMut.lock();
+    {
+        if(!writerProps)
+        {
+            /* Default Properties */
+            parquet::WriterProperties::Builder writer_props_builder;
+            writer_props_builder.compression(parquet::Compression::SNAPPY);
+            writer_props_builder.version(parquet::ParquetVersion::PARQUET_2_6);
+            #ifndef APACHE_ARROW_10_COMPAT
+            if(page_index) writer_props_builder.enable_write_page_index(); // lets readers prune pages of sorted row groups
+            #else
+            (void)page_index;
+            #endif
+
+            /* Per Column Encodings */
+            bool zstd = arrow::util::Codec::IsAvailable(arrow::Compression::ZSTD);
+            for(int i = 0; i < schema->num_fields() && i < (int)columns.size(); i++)
+            {
+                selectColumnEncoding(writer_props_builder, schema->field(i)->name(), columns[i], zstd);
+            }
+
+            writerProps = writer_props_builder.build();
+        }
+    }
+    writerPropsMut.unlock();
+}
+
+/*----------------------------------------------------------------------------
+ * selectColumnEncoding
+ *
+ *  low cardinality columns keep dictionary encoding (whose indices are written
+ *  with the RLE/bit-packing hybrid); monotonic integers, e.g. times and indices,
+ *  are delta encoded; other floats are byte stream split and compressed with
+ *  zstd, which compresses the split exponent bytes far better than snappy
+ *----------------------------------------------------------------------------*/
+void ParquetBuilder::impl::selectColumnEncoding (parquet::WriterProperties::Builder& builder, const std::string& path, const shared_ptr<arrow::Array>& column, bool zstd)
+{
+    column_profile_t profile = {0, 0, false};
+    bool is_float = false;
+    bool is_integer = false;
+
+    /* Profile Column */
+    switch(column->type_id())
+    {
+        case arrow::Type::STRUCT:
+        {
+            const arrow::StructArray& struct_array = static_cast<const arrow::StructArray&>(*column);
+            for(int i = 0; i < struct_array.num_fields(); i++)
+            {
+                selectColumnEncoding(builder, path + "." + struct_array.type()->field(i)->name(), struct_array.field(i), zstd);
+            }
+            return;
+        }
+        case arrow::Type::DOUBLE:       profile = profileColumn<arrow::DoubleArray>(*column);       is_float = true;    break;
+        case arrow::Type::FLOAT:        profile = profileColumn<arrow::FloatArray>(*column);        is_float = true;    break;
+        case arrow::Type::INT8:         profile = profileColumn<arrow::Int8Array>(*column);         is_integer = true;  break;
+        case arrow::Type::INT16:        profile = profileColumn<arrow::Int16Array>(*column);        is_integer = true;  break;
+        case arrow::Type::INT32:        profile = profileColumn<arrow::Int32Array>(*column);        is_integer = true;  break;
+        case arrow::Type::INT64:        profile = profileColumn<arrow::Int64Array>(*column);        is_integer = true;  break;
+        case arrow::Type::UINT8:        profile = profileColumn<arrow::UInt8Array>(*column);        is_integer = true;  break;
+        case arrow::Type::UINT16:       profile = profileColumn<arrow::UInt16Array>(*column);       is_integer = true;  break;
+        case arrow::Type::UINT32:       profile = profileColumn<arrow::UInt32Array>(*column);       is_integer = true;  break;
+        case arrow::Type::UINT64:       profile = profileColumn<arrow::UInt64Array>(*column);       is_integer = true;  break;
+        case arrow::Type::TIMESTAMP:    profile = profileColumn<arrow::TimestampArray>(*column);    is_integer = true;  break;
+        case arrow::Type::STRING:       profile = profileBinaryColumn(static_cast<const arrow::StringArray&>(*column)); break;
+        case arrow::Type::BINARY:       profile = profileBinaryColumn(static_cast<const arrow::BinaryArray&>(*column)); break;
+        default:                        return; // keep defaults
+    }
+
+    /* Nothing to Sample */
+    if(profile.samples == 0) return;
+
+    if(profile.distinct * DICTIONARY_CARDINALITY <= profile.samples)
+    {
+        /* Dictionary (the Default) */
+        builder.enable_dictionary(path);
+        mlog(DEBUG, "Column %s: dictionary encoded, %ld distinct in %ld samples", path.c_str(), (long)profile.distinct, (long)profile.samples);
+    }
+    else if(is_integer && profile.monotonic)
+    {
+        /* Delta */
+        builder.disable_dictionary(path);
+        builder.encoding(path, parquet::Encoding::DELTA_BINARY_PACKED);
+        mlog(DEBUG, "Column %s: delta encoded", path.c_str());
+    }
+    else if(is_float)
+    {
+        /* Byte Stream Split */
+        builder.disable_dictionary(path);
+        builder.encoding(path, parquet::Encoding::BYTE_STREAM_SPLIT);
+        if(zstd)
+        {
+            builder.compression(path, parquet::Compression::ZSTD);
+            builder.compression_level(path, ZSTD_COMPRESSION_LEVEL);
+        }
+        mlog(DEBUG, "Column %s: byte stream split encoded", path.c_str());
+    }
+    else
+    {
+        /* Plain - a dictionary would only be abandoned after its first page */
+        builder.disable_dictionary(path);
+        if(is_integer && zstd)
+        {
+            builder.compression(path, parquet::Compression::ZSTD);
+            builder.compression_level(path, ZSTD_COMPRESSION_LEVEL);
+        }
+        mlog(DEBUG, "Column %s: plain encoded", path.c_str());
+    }
+}
+
+/*----------------------------------------------------------------------------
+ * profileColumn - samples a numeric column for its cardinality and ordering
+ *----------------------------------------------------------------------------*/
+template<typename A>
+ParquetBuilder::impl::column_profile_t ParquetBuilder::impl::profileColumn (const arrow::Array& column)
+{
+    const A& array = static_cast<const A&>(column);
+    const auto* values = array.raw_values();
+    const int64_t length = array.length();
+    const int64_t stride = MAX(length / ENCODING_SAMPLE_SIZE, 1);
+
+    std::unordered_set<uint64_t> distinct;
+    bool ascending = true;
+    bool descending = true;
+    int64_t samples = 0;
+    for(int64_t i = 0; i < length; i += stride)
+    {
+        uint64_t bits = 0;
+        memcpy(&bits, &values[i], sizeof(values[i]));
+        distinct.insert(bits);
+        if(i > 0)
+        {
+            ascending = ascending && (values[i - stride] <= values[i]);
+            descending = descending && (values[i - stride] >= values[i]);
+        }
+        samples++;
+    }
+
+    column_profile_t profile = {samples, (int64_t)distinct.size(), samples > 1 && (ascending || descending)};
+    return profile;
+}
+
+/*----------------------------------------------------------------------------
+ * profileBinaryColumn - samples a string or binary column for its cardinality
+ *----------------------------------------------------------------------------*/
+ParquetBuilder::impl::column_profile_t ParquetBuilder::impl::profileBinaryColumn (const arrow::BinaryArray& column)
+{
+    const int64_t length = column.length();
+    const int64_t stride = MAX(length / ENCODING_SAMPLE_SIZE, 1);
+
+    std::unordered_set<uint64_t> distinct;
+    std::hash<std::string> hasher;
+    int64_t samples = 0;
+    for(int64_t i = 0; i < length; i += stride)
+    {
+        distinct.insert(hasher(column.GetString(i)));
+        samples++;
+    }
+
+    column_profile_t profile = {samples, (int64_t)distinct.size(), false};
+    return profile;
+}
+
 /*----------------------------------------------------------------------------
  * defineTableSchema
  *----------------------------------------------------------------------------*/
@@ -79,6 +699,13 @@ shared_ptr<arrow::Schema> ParquetBuilder::impl::defineTableSchema (field_list_t&
 {
     vector<shared_ptr<arrow::Field>> schema_vector;
     addFieldsToSchema(schema_vector, field_list, geo, batch_rec_type, 0);
+    if(geo.spatial_sort)
+    {
+        schema_vector.push_back(arrow::field("bbox", arrow::struct_({arrow::field("xmin", arrow::float64()),
+                                                                     arrow::field("ymin", arrow::float64()),
+                                                                     arrow::field("xmax", arrow::float64()),
+                                                                     arrow::field("ymax", arrow::float64())})));
+    }
     if(geo.as_geo) schema_vector.push_back(arrow::field("geometry", arrow::binary()));
     return make_shared<arrow::Schema>(schema_vector);
 }
@@ -156,11 +783,11 @@ bool ParquetBuilder::impl::addFieldsToSchema (vector<shared_ptr<arrow::Field>>&
 /*----------------------------------------------------------------------------
  * appendGeoMetaData
  *----------------------------------------------------------------------------*/
-void ParquetBuilder::impl::appendGeoMetaData (const std::shared_ptr<arrow::KeyValueMetadata>& metadata)
+void ParquetBuilder::impl::appendGeoMetaData (const std::shared_ptr<arrow::KeyValueMetadata>& metadata, bool covering)
 {
     /* Initialize Meta Data String */
     SafeString geostr(R"json({
-        "version": "1.0.0-beta.1",
+        "version": "$VERSION",
         "primary_column": "geometry",
         "columns": {
             "geometry": {
@@ -202,16 +829,25 @@ void ParquetBuilder::impl::appendGeoMetaData (const std::shared_ptr<arrow::KeyVa
                     }
                 },
                 "edges": "planar",
-                "bbox": [-180.0, -90.0, 180.0, 90.0],
+                "bbox": [-180.0, -90.0, 180.0, 90.0],$COVERING
                 "epoch": 2018.0
             }
         }
     })json");
 
+    /* Covering Column (GeoParquet 1.1) */
+    const char* version = "1.0.0-beta.1";
+    const char* coveringstr = "";
+    if(covering)
+    {
+        version = "1.1.0";
+        coveringstr = R"json( "covering": {"bbox": {"xmin": ["bbox", "xmin"], "ymin": ["bbox", "ymin"], "xmax": ["bbox", "xmax"], "ymax": ["bbox", "ymax"]}},)json";
+    }
+
     /* Reformat JSON */
-    const char* oldtxt[2] = { "    ", "\n" };
-    const char* newtxt[2] = { "",     " " };
-    geostr.inreplace(oldtxt, newtxt, 2);
+    const char* oldtxt[4] = { "    ", "\n", "$VERSION", "$COVERING" };
+    const char* newtxt[4] = { "",     " ",  version,    coveringstr };
+    geostr.inreplace(oldtxt, newtxt, 4);
 
     /* Append Meta String */
     const char* str = geostr.str();
@@ -328,6 +964,12 @@ void ParquetBuilder::impl::appendPandasMetaData (const std::shared_ptr<arrow::Ke
                 default:                    pandas_type = "bytes";      numpy_type = "object";          break;
             }
         }
+        else if(StringLib::match(field_name.c_str(), "bbox"))
+        {
+            /* Add Column for Covering */
+            pandas_type = "object";
+            numpy_type = "object";
+        }
         else if(StringLib::match(field_name.c_str(), "geometry"))
         {
             /* Add Column for Geometry */
@@ -365,17 +1007,265 @@ void ParquetBuilder::impl::appendPandasMetaData (const std::shared_ptr<arrow::Ke
     metadata->Append("pandas", str);
 }
 
-/******************************************************************************
- * STATIC DATA
- ******************************************************************************/
+/*----------------------------------------------------------------------------
+ * buildColumn
+ *----------------------------------------------------------------------------*/
+shared_ptr<arrow::Array> ParquetBuilder::impl::buildColumn (const RecordObject::field_t& field, const vector<batch_t>& batches, int row_size_bytes, int num_rows, arrow::MemoryPool* pool)
+{
+    switch(field.type)
+    {
+        case RecordObject::DOUBLE:  return gatherColumn<double>(arrow::float64(), field, batches, row_size_bytes, num_rows, pool);
+        case RecordObject::FLOAT:   return gatherColumn<float>(arrow::float32(), field, batches, row_size_bytes, num_rows, pool);
+        case RecordObject::INT8:    return gatherColumn<int8_t>(arrow::int8(), field, batches, row_size_bytes, num_rows, pool);
+        case RecordObject::INT16:   return gatherColumn<int16_t>(arrow::int16(), field, batches, row_size_bytes, num_rows, pool);
+        case RecordObject::INT32:   return gatherColumn<int32_t>(arrow::int32(), field, batches, row_size_bytes, num_rows, pool);
+        case RecordObject::INT64:   return gatherColumn<int64_t>(arrow::int64(), field, batches, row_size_bytes, num_rows, pool);
+        case RecordObject::UINT8:   return gatherColumn<uint8_t>(arrow::uint8(), field, batches, row_size_bytes, num_rows, pool);
+        case RecordObject::UINT16:  return gatherColumn<uint16_t>(arrow::uint16(), field, batches, row_size_bytes, num_rows, pool);
+        case RecordObject::UINT32:  return gatherColumn<uint32_t>(arrow::uint32(), field, batches, row_size_bytes, num_rows, pool);
+        case RecordObject::UINT64:  return gatherColumn<uint64_t>(arrow::uint64(), field, batches, row_size_bytes, num_rows, pool);
+        case RecordObject::TIME8:   return gatherColumn<int64_t>(arrow::timestamp(arrow::TimeUnit::NANO), field, batches, row_size_bytes, num_rows, pool);
+        case RecordObject::STRING:  return buildStringColumn(field, batches, row_size_bytes, num_rows, pool);
+        default:                    return shared_ptr<arrow::Array>();
+    }
+}
 
-const char* ParquetBuilder::OBJECT_TYPE = "ParquetBuilder";
-const char* ParquetBuilder::LuaMetaName = "ParquetBuilder";
-const struct luaL_Reg ParquetBuilder::LuaMetaTable[] = {
-    {NULL,          NULL}
-};
+/*----------------------------------------------------------------------------
+ * buildGeometryColumn
+ *----------------------------------------------------------------------------*/
+shared_ptr<arrow::Array> ParquetBuilder::impl::buildGeometryColumn (const geo_data_t& geo, const vector<batch_t>& batches, int row_size_bytes, int num_rows, arrow::MemoryPool* pool)
+{
+    shared_ptr<arrow::Array> column;
+    arrow::BinaryBuilder builder(pool);
+    (void)builder.Reserve(num_rows);
+    (void)builder.ReserveData(num_rows * sizeof(wkbpoint_t));
+    for(const batch_t& batch: batches)
+    {
+        RecordObject::field_t lon_field = geo.lon_field;
+        RecordObject::field_t lat_field = geo.lat_field;
+        lon_field.offset += batch.start * row_size_bytes * 8;
+        lat_field.offset += batch.start * row_size_bytes * 8;
+        for(int row = 0; row < batch.rows; row++)
+        {
+            wkbpoint_t point = {
+                #ifdef __be__
+                .byteOrder = 0,
+                #else
+                .byteOrder = 1,
+                #endif
+                .wkbType = 1,
+                .x = batch.record->getValueReal(lon_field),
+                .y = batch.record->getValueReal(lat_field)
+            };
+            (void)builder.UnsafeAppend((uint8_t*)&point, sizeof(wkbpoint_t));
+            lon_field.offset += row_size_bytes * 8;
+            lat_field.offset += row_size_bytes * 8;
+        }
+    }
+    (void)builder.Finish(&column);
+    return column;
+}
 
-const char* ParquetBuilder::metaRecType = "arrowrec.meta";
+/*----------------------------------------------------------------------------
+ * buildCoveringColumn
+ *
+ *  bbox struct column of the GeoParquet covering; for points the min and max
+ *  of each axis are the coordinate itself, so both children share one array
+ *----------------------------------------------------------------------------*/
+shared_ptr<arrow::Array> ParquetBuilder::impl::buildCoveringColumn (const geo_data_t& geo, const vector<batch_t>& batches, int row_size_bytes, int num_rows, arrow::MemoryPool* pool)
+{
+    shared_ptr<arrow::Array> x_column;
+    shared_ptr<arrow::Array> y_column;
+    arrow::DoubleBuilder x_builder(pool);
+    arrow::DoubleBuilder y_builder(pool);
+    (void)x_builder.Reserve(num_rows);
+    (void)y_builder.Reserve(num_rows);
+    for(const batch_t& batch: batches)
+    {
+        RecordObject::field_t lon_field = geo.lon_field;
+        RecordObject::field_t lat_field = geo.lat_field;
+        lon_field.offset += batch.start * row_size_bytes * 8;
+        lat_field.offset += batch.start * row_size_bytes * 8;
+        for(int row = 0; row < batch.rows; row++)
+        {
+            x_builder.UnsafeAppend(batch.record->getValueReal(lon_field));
+            y_builder.UnsafeAppend(batch.record->getValueReal(lat_field));
+            lon_field.offset += row_size_bytes * 8;
+            lat_field.offset += row_size_bytes * 8;
+        }
+    }
+    (void)x_builder.Finish(&x_column);
+    (void)y_builder.Finish(&y_column);
+
+    arrow::Result<shared_ptr<arrow::StructArray>> result = arrow::StructArray::Make({x_column, y_column, x_column, y_column}, {"xmin", "ymin", "xmax", "ymax"});
+    if(!result.ok())
+    {
+        mlog(CRITICAL, "Failed to build bbox column: %s", result.status().ToString().c_str());
+        return shared_ptr<arrow::Array>();
+    }
+    return result.ValueOrDie();
+}
+
+/*----------------------------------------------------------------------------
+ * sortRows
+ *
+ *  copies the rows of a row group into a single record ordered along a
+ *  hilbert curve so that pages of the written columns cover compact regions
+ *----------------------------------------------------------------------------*/
+RecordObject* ParquetBuilder::impl::sortRows (const geo_data_t& geo, const vector<batch_t>& batches, const char* rec_type, int row_size_bytes, int num_rows)
+{
+    /* Build Sort Keys */
+    vector<std::pair<uint64_t, const uint8_t*>> keys;
+    keys.reserve(num_rows);
+    for(const batch_t& batch: batches)
+    {
+        RecordObject::field_t lon_field = geo.lon_field;
+        RecordObject::field_t lat_field = geo.lat_field;
+        lon_field.offset += batch.start * row_size_bytes * 8;
+        lat_field.offset += batch.start * row_size_bytes * 8;
+        const uint8_t* row_data = batch.record->getRecordData() + (batch.start * row_size_bytes);
+        for(int row = 0; row < batch.rows; row++)
+        {
+            uint64_t key = hilbertIndex(batch.record->getValueReal(lon_field), batch.record->getValueReal(lat_field), HILBERT_ORDER);
+            keys.emplace_back(key, row_data);
+            lon_field.offset += row_size_bytes * 8;
+            lat_field.offset += row_size_bytes * 8;
+            row_data += row_size_bytes;
+        }
+    }
+
+    /* Sort Rows (ties keep arrival order) */
+    std::stable_sort(keys.begin(), keys.end(), [](const std::pair<uint64_t, const uint8_t*>& a, const std::pair<uint64_t, const uint8_t*>& b) {
+        return a.first < b.first;
+    });
+
+    /* Copy Rows into Sorted Record */
+    int data_size = MAX(num_rows * row_size_bytes, RecordObject::getRecordDataSize(rec_type));
+    RecordObject* sorted = new RecordObject(rec_type, data_size, false);
+    uint8_t* dst = sorted->getRecordData();
+    for(const std::pair<uint64_t, const uint8_t*>& key: keys)
+    {
+        memcpy(dst, key.second, row_size_bytes);
+        dst += row_size_bytes;
+    }
+
+    return sorted;
+}
+
+/*----------------------------------------------------------------------------
+ * buildStringColumn
+ *----------------------------------------------------------------------------*/
+shared_ptr<arrow::Array> ParquetBuilder::impl::buildStringColumn (const RecordObject::field_t& field, const vector<batch_t>& batches, int row_size_bytes, int num_rows, arrow::MemoryPool* pool)
+{
+    shared_ptr<arrow::Array> column;
+    arrow::StringBuilder builder(pool);
+    (void)builder.Reserve(num_rows);
+    for(const batch_t& batch: batches)
+    {
+        RecordObject::field_t row_field = field;
+        row_field.offset += batch.start * row_size_bytes * 8;
+        for(int row = 0; row < batch.rows; row++)
+        {
+            const char* str = batch.record->getValueText(row_field);
+            builder.UnsafeAppend(str, StringLib::size(str));
+            row_field.offset += row_size_bytes * 8;
+        }
+    }
+    (void)builder.Finish(&column);
+    return column;
+}
+
+/*----------------------------------------------------------------------------
+ * gatherColumn
+ *
+ *  copies a fixed stride field out of each packed batch record directly into
+ *  the column's value buffer; the byte order check is hoisted out of the row
+ *  loop and native fields that fill the whole row are copied in one block
+ *----------------------------------------------------------------------------*/
+template<typename T>
+shared_ptr<arrow::Array> ParquetBuilder::impl::gatherColumn (const shared_ptr<arrow::DataType>& type, const RecordObject::field_t& field, const vector<batch_t>& batches, int row_size_bytes, int num_rows, arrow::MemoryPool* pool)
+{
+    /* Allocate Value Buffer */
+    arrow::Result<unique_ptr<arrow::Buffer>> result = arrow::AllocateBuffer(num_rows * sizeof(T), pool);
+    if(!result.ok())
+    {
+        mlog(CRITICAL, "Failed to allocate column of %d rows: %s", num_rows, result.status().ToString().c_str());
+        return shared_ptr<arrow::Array>();
+    }
+    shared_ptr<arrow::Buffer> values = std::move(result).ValueOrDie();
+    T* dst = reinterpret_cast<T*>(values->mutable_data());
+
+    /* Gather Rows from Each Batch */
+    bool native = (NATIVE_FLAGS == (field.flags & RecordObject::BIGENDIAN));
+    uint32_t field_offset = TOBYTES(field.offset);
+    for(const batch_t& batch: batches)
+    {
+        const uint8_t* src = batch.record->getRecordData() + field_offset + (batch.start * row_size_bytes);
+        if(field.flags & RecordObject::POINTER)
+        {
+            RecordObject::field_t start_field = field;
+            start_field.offset += batch.start * row_size_bytes * 8;
+            gatherPointerRows<T>(dst, batch.record, start_field, batch.rows, row_size_bytes);
+        }
+        else if(native && (row_size_bytes == (int)sizeof(T)))
+        {
+            memcpy(dst, src, batch.rows * sizeof(T));
+        }
+        else if(native)
+        {
+            gatherRows<T, false>(dst, src, batch.rows, row_size_bytes);
+        }
+        else
+        {
+            gatherRows<T, true>(dst, src, batch.rows, row_size_bytes);
+        }
+        dst += batch.rows;
+    }
+
+    /* Wrap Buffer as Array (no validity bitmap) */
+    return arrow::MakeArray(arrow::ArrayData::Make(type, num_rows, {nullptr, values}, 0));
+}
+
+/*----------------------------------------------------------------------------
+ * gatherRows
+ *----------------------------------------------------------------------------*/
+template<typename T, bool SWAP>
+void ParquetBuilder::impl::gatherRows (T* dst, const uint8_t* src, int rows, int row_size_bytes)
+{
+    for(int row = 0; row < rows; row++)
+    {
+        T value;
+        memcpy(&value, src, sizeof(T)); // records are packed, so fields may be unaligned
+        dst[row] = SWAP ? swapValue(value) : value;
+        src += row_size_bytes;
+    }
+}
+
+/*----------------------------------------------------------------------------
+ * gatherPointerRows - slow path for fields that reference other fields
+ *----------------------------------------------------------------------------*/
+template<typename T>
+void ParquetBuilder::impl::gatherPointerRows (T* dst, RecordObject* record, RecordObject::field_t field, int rows, int row_size_bytes)
+{
+    for(int row = 0; row < rows; row++)
+    {
+        if(std::is_floating_point<T>::value)    dst[row] = (T)record->getValueReal(field);
+        else                                    dst[row] = (T)record->getValueInteger(field);
+        field.offset += row_size_bytes * 8;
+    }
+}
+
+/******************************************************************************
+ * STATIC DATA
+ ******************************************************************************/
+
+const char* ParquetBuilder::OBJECT_TYPE = "ParquetBuilder";
+const char* ParquetBuilder::LuaMetaName = "ParquetBuilder";
+const struct luaL_Reg ParquetBuilder::LuaMetaTable[] = {
+    {NULL,          NULL}
+};
+
+const char* ParquetBuilder::metaRecType = "arrowrec.meta";
 const RecordObject::fieldDef_t ParquetBuilder::metaRecDef[] = {
     {"filename",   RecordObject::STRING,   offsetof(arrow_file_meta_t, filename),  FILE_NAME_MAX_LEN,  NULL, NATIVE_FLAGS},
     {"size",       RecordObject::INT64,    offsetof(arrow_file_meta_t, size),                      1,  NULL, NATIVE_FLAGS}
@@ -387,7 +1277,19 @@ const RecordObject::fieldDef_t ParquetBuilder::dataRecDef[] = {
     {"data",       RecordObject::UINT8,    offsetof(arrow_file_data_t, data),                      0,  NULL, NATIVE_FLAGS} // variable length
 };
 
+const char* ParquetBuilder::eofRecType = "arrowrec.eof";
+
 const char* ParquetBuilder::TMP_FILE_PREFIX = "/tmp/";
+const char* ParquetBuilder::ACTIVE_MEMORY_METRIC = "arrow_memory";
+const char* ParquetBuilder::PEAK_MEMORY_METRIC = "peak_arrow_memory";
+
+Publisher*  ParquetBuilder::columnPub = NULL;
+Subscriber* ParquetBuilder::columnSub = NULL;
+bool        ParquetBuilder::columnActive = false;
+Thread**    ParquetBuilder::columnPids = NULL;
+int         ParquetBuilder::columnPoolSize = 0;
+int32_t     ParquetBuilder::activeMemoryMetricId = EventLib::INVALID_METRIC;
+int32_t     ParquetBuilder::peakMemoryMetricId = EventLib::INVALID_METRIC;
 
 /******************************************************************************
  * PUBLIC METHODS
@@ -416,9 +1318,11 @@ int ParquetBuilder::luaCreate (lua_State* L)
         /* Build Geometry Fields */
         geo_data_t geo;
         geo.as_geo = false;
+        geo.spatial_sort = false;
         if((lat_key != NULL) && (lon_key != NULL))
         {
             geo.as_geo = true;
+            geo.spatial_sort = _parms->spatial_sort;
 
             geo.lon_field = RecordObject::getDefinedField(batch_rec_type, lon_key);
             if(geo.lon_field.type == RecordObject::INVALID_FIELD)
@@ -433,8 +1337,28 @@ int ParquetBuilder::luaCreate (lua_State* L)
             }
         }
 
+        /* Build Partition Field */
+        RecordObject::field_t partition_field = {RecordObject::INVALID_FIELD, 0, 0, NULL, 0};
+        if(_parms->partition_by)
+        {
+            partition_field = RecordObject::getDefinedField(batch_rec_type, _parms->partition_by);
+            if(partition_field.type == RecordObject::INVALID_FIELD || partition_field.type == RecordObject::STRING || partition_field.type == RecordObject::USER ||
+               partition_field.type == RecordObject::FLOAT || partition_field.type == RecordObject::DOUBLE)
+            {
+                throw RunTimeException(CRITICAL, RTE_ERROR, "Unable to partition by field [%s] of record type <%s>, must be an integer or time field", _parms->partition_by, batch_rec_type);
+            }
+            else if(_parms->format != ArrowParms::PARQUET)
+            {
+                throw RunTimeException(CRITICAL, RTE_ERROR, "Partitioned output is only supported for parquet files");
+            }
+            else if(!isS3Path(_parms->path))
+            {
+                throw RunTimeException(CRITICAL, RTE_ERROR, "Partitioned output must be written to an S3 path");
+            }
+        }
+
         /* Create Dispatch */
-        return createLuaObject(L, new ParquetBuilder(L, _parms, outq_name, inq_name, rec_type, batch_rec_type, id, geo, index_key));
+        return createLuaObject(L, new ParquetBuilder(L, _parms, outq_name, inq_name, rec_type, batch_rec_type, id, geo, index_key, partition_field));
     }
     catch(const RunTimeException& e)
     {
@@ -451,6 +1375,26 @@ void ParquetBuilder::init (void)
 {
     RECDEF(metaRecType, metaRecDef, sizeof(arrow_file_meta_t), NULL);
     RECDEF(dataRecType, dataRecDef, sizeof(arrow_file_data_t), NULL);
+    RECDEF(eofRecType, metaRecDef, sizeof(arrow_file_meta_t), NULL);
+
+    /* Register Memory Metrics */
+    activeMemoryMetricId = EventLib::registerMetric(OBJECT_TYPE, EventLib::GAUGE, "%s", ACTIVE_MEMORY_METRIC);
+    peakMemoryMetricId = EventLib::registerMetric(OBJECT_TYPE, EventLib::GAUGE, "%s", PEAK_MEMORY_METRIC);
+    if(activeMemoryMetricId == EventLib::INVALID_METRIC || peakMemoryMetricId == EventLib::INVALID_METRIC)
+    {
+        mlog(ERROR, "Registry failed for %s memory metrics", OBJECT_TYPE);
+    }
+
+    /* Start Column Thread Pool */
+    columnPub = new Publisher(NULL);
+    columnSub = new Subscriber(*columnPub);
+    columnActive = true;
+    columnPoolSize = MIN(MAX(OsApi::nproc(), 1), MAX_COLUMN_THREADS);
+    columnPids = new Thread* [columnPoolSize];
+    for(int t = 0; t < columnPoolSize; t++)
+    {
+        columnPids[t] = new Thread(columnThread, NULL);
+    }
 }
 
 /*----------------------------------------------------------------------------
@@ -458,6 +1402,18 @@ void ParquetBuilder::init (void)
  *----------------------------------------------------------------------------*/
 void ParquetBuilder::deinit (void)
 {
+    columnActive = false;
+    for(int t = 0; t < columnPoolSize; t++)
+    {
+        delete columnPids[t];
+    }
+    if(columnPids) delete [] columnPids;
+    if(columnSub) delete columnSub;
+    if(columnPub) delete columnPub;
+    columnPids = NULL;
+    columnSub = NULL;
+    columnPub = NULL;
+    columnPoolSize = 0;
 }
 
 /******************************************************************************
@@ -470,8 +1426,15 @@ void ParquetBuilder::deinit (void)
 ParquetBuilder::ParquetBuilder (lua_State* L, ArrowParms* _parms,
                                 const char* outq_name, const char* inq_name,
                                 const char* rec_type, const char* batch_rec_type,
-                                const char* id, geo_data_t geo, const char* index_key):
-    LuaObject(L, OBJECT_TYPE, LuaMetaName, LuaMetaTable)
+                                const char* id, geo_data_t geo, const char* index_key,
+                                RecordObject::field_t partition_field):
+    LuaObject(L, OBJECT_TYPE, LuaMetaName, LuaMetaTable),
+    partitioned(partition_field.type != RecordObject::INVALID_FIELD),
+    partitionField(partition_field),
+    stagedBytes(0),
+    writers(NULL),
+    numWriters(0),
+    overBudget(false)
 {
     assert(_parms);
     assert(outq_name);
@@ -484,11 +1447,13 @@ ParquetBuilder::ParquetBuilder (lua_State* L, ArrowParms* _parms,
     parms = _parms;
 
     /* Allocate Private Implementation */
-    pimpl = new ParquetBuilder::impl;
+    pimpl = new ParquetBuilder::impl(parms->memory_budget);
 
     /* Row Based Parameters */
     rowSizeBytes = RecordObject::getRecordDataSize(batch_rec_type);
-    maxRowsInGroup = ROW_GROUP_SIZE / rowSizeBytes;
+    if(parms->rows_per_group > 0) maxRowsInGroup = (int)MIN(parms->rows_per_group, (long)INT32_MAX);
+    else maxRowsInGroup = MAX(ROW_GROUP_SIZE / rowSizeBytes, 1);
+    minRowsInGroup = MIN(MIN_ROWS_IN_GROUP, maxRowsInGroup);
 
     /* Initialize Record Type */
     recType = StringLib::duplicate(rec_type);
@@ -509,45 +1474,73 @@ ParquetBuilder::ParquetBuilder (lua_State* L, ArrowParms* _parms,
     fieldIterator = new field_iterator_t(fieldList);
 
     /* Create Unique Temporary Filename */
-    SafeString tmp_file("%s%s.parquet", TMP_FILE_PREFIX, id);
+    SafeString tmp_file("%s%s.%s", TMP_FILE_PREFIX, id, parms->format == ArrowParms::IPC_STREAM ? "arrows" : "parquet");
     fileName = tmp_file.str(true);
 
     /* Create Arrow Output Stream */
-    shared_ptr<arrow::io::FileOutputStream> file_output_stream;
-    PARQUET_ASSIGN_OR_THROW(file_output_stream, arrow::io::FileOutputStream::Open(fileName));
-
-    /* Create Writer Properties */
-    parquet::WriterProperties::Builder writer_props_builder;
-    writer_props_builder.compression(parquet::Compression::SNAPPY);
-    writer_props_builder.version(parquet::ParquetVersion::PARQUET_2_6);
-    shared_ptr<parquet::WriterProperties> writer_props = writer_props_builder.build();
-
-    /* Create Arrow Writer Properties */
-    auto arrow_writer_props = parquet::ArrowWriterProperties::Builder().store_schema()->build();
+    const char* path = parms->path;
+    streamToClient = !isS3Path(path);
+    if(partitioned)
+    {
+        /* Each Partition Writes its own Local File */
+    }
+    else if(streamToClient)
+    {
+        /* Write Directly to Client */
+        pimpl->outputStream = make_shared<ClientOutputStream>(outQ, path);
+    }
+    else
+    {
+        /* Write to Local File for Upload */
+        shared_ptr<arrow::io::FileOutputStream> file_output_stream;
+        PARQUET_ASSIGN_OR_THROW(file_output_stream, arrow::io::FileOutputStream::Open(fileName));
+        pimpl->outputStream = file_output_stream;
+    }
 
     /* Build GeoParquet MetaData */
     auto metadata = pimpl->schema->metadata() ? pimpl->schema->metadata()->Copy() : std::make_shared<arrow::KeyValueMetadata>();
-    if(geoData.as_geo) pimpl->appendGeoMetaData(metadata);
+    if(geoData.as_geo) pimpl->appendGeoMetaData(metadata, geoData.spatial_sort);
     pimpl->appendServerMetaData(metadata);
     pimpl->appendPandasMetaData(metadata, pimpl->schema, fieldIterator, indexKey);
     pimpl->schema = pimpl->schema->WithMetadata(metadata);
 
-    /* Create Parquet Writer */
-    #ifdef APACHE_ARROW_10_COMPAT
-        (void)parquet::arrow::FileWriter::Open(*pimpl->schema, ::arrow::default_memory_pool(), file_output_stream, writer_props, arrow_writer_props, &pimpl->parquetWriter);
-    #elif 0 // alternative method of creating file writer
-        std::shared_ptr<parquet::SchemaDescriptor> parquet_schema;
-        (void)parquet::arrow::ToParquetSchema(pimpl->schema.get(), *writer_props, *arrow_writer_props, &parquet_schema);
-        auto schema_node = std::static_pointer_cast<parquet::schema::GroupNode>(parquet_schema->schema_root());
-        std::unique_ptr<parquet::ParquetFileWriter> base_writer;
-        base_writer = parquet::ParquetFileWriter::Open(std::move(file_output_stream), schema_node, std::move(writer_props), metadata);
-        auto schema_ptr = std::make_shared<::arrow::Schema>(*pimpl->schema);
-        (void)parquet::arrow::FileWriter::Make(::arrow::default_memory_pool(), std::move(base_writer), std::move(schema_ptr), std::move(arrow_writer_props), &pimpl->parquetWriter);
-    #else
-        arrow::Result<std::unique_ptr<parquet::arrow::FileWriter>> result = parquet::arrow::FileWriter::Open(*pimpl->schema, ::arrow::default_memory_pool(), file_output_stream, writer_props, arrow_writer_props);
-        if(result.ok()) pimpl->parquetWriter = std::move(result).ValueOrDie();
-        else mlog(CRITICAL, "Failed to open parquet writer: %s", result.status().ToString().c_str());
-    #endif
+    if(parms->format == ArrowParms::IPC_STREAM)
+    {
+        /* Create Arrow IPC Stream Writer */
+        arrow::ipc::IpcWriteOptions ipc_options = arrow::ipc::IpcWriteOptions::Defaults();
+        ipc_options.memory_pool = pimpl->memoryPool;
+        arrow::Result<shared_ptr<arrow::ipc::RecordBatchWriter>> result = arrow::ipc::MakeStreamWriter(pimpl->outputStream, pimpl->schema, ipc_options);
+        if(result.ok())
+        {
+            pimpl->ipcWriter = result.ValueOrDie();
+        }
+        else
+        {
+            LuaEndpoint::generateExceptionStatus(RTE_ERROR, CRITICAL, outQ, NULL, "Failed to open arrow ipc writer: %s", result.status().ToString().c_str());
+            abortOutput();
+        }
+    }
+    else
+    {
+        /* Create Arrow Writer Properties
+         *  the parquet writer properties, and so the writer itself, are
+         *  created once the first row group is built and its columns sampled */
+        pimpl->arrowWriterProps = parquet::ArrowWriterProperties::Builder().store_schema()->build();
+    }
+
+    /* Start Partition Writers */
+    if(partitioned)
+    {
+        numWriters = MIN(MAX(OsApi::nproc(), 1), MAX_PARTITION_WRITERS);
+        writers = new writer_t [numWriters];
+        for(int w = 0; w < numWriters; w++)
+        {
+            writers[w].builder = this;
+            writers[w].pub = new Publisher(NULL, Publisher::defaultFree, PARTITION_QUEUE_DEPTH);
+            writers[w].sub = new Subscriber(*writers[w].pub);
+            writers[w].pid = new Thread(writerThread, &writers[w]);
+        }
+    }
 
     /* Start Builder Thread */
     active = true;
@@ -561,6 +1554,7 @@ ParquetBuilder::~ParquetBuilder(void)
 {
     active = false;
     delete builderPid;
+    delete pimpl; // output stream may post to outQ when closed
     parms->releaseLuaObject();
     delete [] fileName;
     if(indexKey) delete [] indexKey;
@@ -568,7 +1562,23 @@ ParquetBuilder::~ParquetBuilder(void)
     delete outQ;
     delete inQ;
     delete fieldIterator;
-    delete pimpl;
+
+    /* Free Partitions (writers joined by builder thread) */
+    partition_t* partition;
+    const char* key = partitions.first(&partition);
+    while(key != NULL)
+    {
+        delete [] partition->name;
+        delete [] partition->fileName;
+        delete partition;
+        key = partitions.next(&partition);
+    }
+    for(int w = 0; w < numWriters; w++)
+    {
+        delete writers[w].sub;
+        delete writers[w].pub;
+    }
+    delete [] writers;
 }
 
 /*----------------------------------------------------------------------------
@@ -580,7 +1590,7 @@ void* ParquetBuilder::builderThread(void* parm)
     int row_cnt = 0;
 
     /* Early Exit on No Writer */
-    if(!builder->pimpl->parquetWriter)
+    if(!builder->partitioned && !builder->pimpl->arrowWriterProps && !builder->pimpl->ipcWriter)
     {
         return NULL;
     }
@@ -622,21 +1632,76 @@ void* ParquetBuilder::builderThread(void* parm)
                     continue;
                 }
 
-                /* Create Batch Structure */
-                batch_t batch = {
-                    .ref = ref,
-                    .record = record,
-                    .rows = num_rows
-                };
-
-                /* Add Batch to Ordering */
-                builder->recordBatch.add(row_cnt, batch);
-                row_cnt += num_rows;
-                if(row_cnt >= builder->maxRowsInGroup)
+                /* Drop Rows once the Memory Budget has Failed the Request */
+                if(builder->overBudget)
                 {
-                    builder->processRecordBatch(row_cnt);
-                    row_cnt = 0;
+                    delete record;
+                    builder->inQ->dereference(ref);
+                    continue;
                 }
+
+                /* Route Rows to Partitions */
+                if(builder->partitioned)
+                {
+                    /* Each Writer Builds its Row Groups within a Share of the Budget */
+                    if(builder->pimpl->rowsInBudget(builder->rowSizeBytes, builder->numWriters) < builder->minRowsInGroup)
+                    {
+                        builder->abortOverBudget(builder->numWriters);
+                        delete record;
+                        builder->inQ->dereference(ref);
+                        continue;
+                    }
+
+                    builder->partitionRecord(record, num_rows);
+                    delete record; // rows are copied into partitions
+                    builder->inQ->dereference(ref);
+                    continue;
+                }
+
+                /* Split Record Across Row Groups */
+                int start_row = 0;
+                do
+                {
+                    /* Flush Staged Rows Early once the Memory Budget cannot Hold More */
+                    int max_rows = MIN(builder->maxRowsInGroup, builder->pimpl->rowsInBudget(builder->rowSizeBytes, 1));
+                    if(row_cnt > 0 && (row_cnt >= max_rows || max_rows < builder->minRowsInGroup))
+                    {
+                        builder->processRecordBatch(row_cnt);
+                        row_cnt = 0;
+                        max_rows = MIN(builder->maxRowsInGroup, builder->pimpl->rowsInBudget(builder->rowSizeBytes, 1));
+                    }
+
+                    /* Fail Request when not even a Minimal Row Group Fits */
+                    if(max_rows < builder->minRowsInGroup)
+                    {
+                        builder->abortOverBudget(1);
+                        delete record; // nothing is staged, so no batch refers to the record
+                        builder->inQ->dereference(ref);
+                        break;
+                    }
+
+                    /* Create Batch Structure */
+                    int batch_rows = MIN(num_rows - start_row, max_rows - row_cnt);
+                    batch_t batch = {
+                        .ref = ref,
+                        .record = record,
+                        .start = start_row,
+                        .rows = batch_rows,
+                        .last = (start_row + batch_rows) >= num_rows
+                    };
+
+                    /* Add Batch to Ordering */
+                    builder->recordBatch.add(row_cnt, batch);
+                    row_cnt += batch_rows;
+                    start_row += batch_rows;
+
+                    /* Write Row Group as soon as it is Full */
+                    if(row_cnt >= max_rows)
+                    {
+                        builder->processRecordBatch(row_cnt);
+                        row_cnt = 0;
+                    }
+                } while(start_row < num_rows);
             }
             else
             {
@@ -654,36 +1719,43 @@ void* ParquetBuilder::builderThread(void* parm)
         }
     }
 
-    /* Process Remaining Records */
-    builder->processRecordBatch(row_cnt);
-    row_cnt = 0;
-
-    /* Close Parquet Writer */
-    (void)builder->pimpl->parquetWriter->Close();
-
-    /* Send File to User */
-    const char* _path = builder->parms->path;
-    uint32_t send_trace_id = start_trace(INFO, trace_id, "send_file", "{\"path\": \"%s\"}", _path);
-    int _path_len = StringLib::size(_path);
-    if((_path_len > 5) &&
-        (_path[0] == 's') &&
-        (_path[1] == '3') &&
-        (_path[2] == ':') &&
-        (_path[3] == '/') &&
-        (_path[4] == '/'))
+    if(builder->partitioned)
     {
-        #ifdef __aws__
-        builder->send2S3(&_path[5]);
-        #else
-        LuaEndpoint::generateExceptionStatus(RTE_ERROR, CRITICAL, outQ, NULL, "Output path specifies S3, but server compiled without AWS support");
-        #endif
+        /* Write, Close, and Upload Partitions */
+        builder->closePartitions();
     }
     else
     {
-        /* Stream Back to Client */
-        builder->send2Client();
+        /* Process Remaining Records */
+        builder->processRecordBatch(row_cnt);
+        row_cnt = 0;
+
+        /* Close Writer */
+        bool opened = builder->pimpl->parquetWriter || builder->pimpl->ipcWriter;
+        if(builder->pimpl->parquetWriter) (void)builder->pimpl->parquetWriter->Close();
+        if(builder->pimpl->ipcWriter) (void)builder->pimpl->ipcWriter->Close();
+        (void)builder->pimpl->outputStream->Close(); // no-op if already closed by writer
+
+        /* Send File to S3 (client receives file as it is written) */
+        if(!builder->streamToClient && opened && !builder->overBudget)
+        {
+            const char* _path = builder->parms->path;
+            uint32_t send_trace_id = start_trace(INFO, trace_id, "send_file", "{\"path\": \"%s\"}", _path);
+            #ifdef __aws__
+            builder->send2S3(builder->fileName, &_path[5]);
+            if(remove(builder->fileName) != 0)
+            {
+                mlog(CRITICAL, "Failed to delete file %s: %s", builder->fileName, strerror(errno));
+            }
+            #else
+            LuaEndpoint::generateExceptionStatus(RTE_ERROR, CRITICAL, builder->outQ, NULL, "Output path specifies S3, but server compiled without AWS support");
+            #endif
+            stop_trace(INFO, send_trace_id);
+        }
     }
-    stop_trace(INFO, send_trace_id);
+
+    /* Report Memory Usage of Request */
+    builder->updateMemoryMetrics(true);
 
     /* Signal Completion */
     builder->signalComplete();
@@ -706,338 +1778,605 @@ void ParquetBuilder::processRecordBatch (int num_rows)
     uint32_t parent_trace_id = EventLib::grabId();
     uint32_t trace_id = start_trace(INFO, parent_trace_id, "process_batch", "{\"num_rows\": %d}", num_rows);
 
-    /* Loop Through Fields in Schema */
-    vector<shared_ptr<arrow::Array>> columns;
-    for(int i = 0; i < fieldIterator->length; i++)
+    /* Collect Batches */
+    vector<batch_t> batches;
+    batches.reserve(recordBatch.length());
+    unsigned long batch_key = recordBatch.first(&batch);
+    while(batch_key != (unsigned long)INVALID_KEY)
+    {
+        batches.push_back(batch);
+        batch_key = recordBatch.next(&batch);
+    }
+
+    /* Drop Rows once the Writer has Failed to Open or the Request is over Budget */
+    if(overBudget || (pimpl->writerProps && !pimpl->parquetWriter))
     {
-        uint32_t field_trace_id = start_trace(INFO, trace_id, "append_field", "{\"field\": %d}", i);
-        RecordObject::field_t field = (*fieldIterator)[i];
-        shared_ptr<arrow::Array> column;
+        releaseRecords(batches);
+        stop_trace(INFO, trace_id);
+        return;
+    }
+
+    /* Spatially Sort Rows into a Single Record */
+    RecordObject* sorted_record = NULL;
+    if(geoData.spatial_sort && num_rows > 0)
+    {
+        uint32_t sort_trace_id = start_trace(INFO, trace_id, "sort_rows", "%s", "{}");
+        sorted_record = impl::sortRows(geoData, batches, recType, rowSizeBytes, num_rows);
+        releaseRecords(batches); // rows were copied into the sorted record
+        batch_t sorted_batch = {
+            .ref = {NULL, 0, 0, NULL},
+            .record = sorted_record,
+            .start = 0,
+            .rows = num_rows,
+            .last = false // not owned by the input queue
+        };
+        batches.push_back(sorted_batch);
+        stop_trace(INFO, sort_trace_id);
+    }
+
+    /* Build Columns */
+    int64_t row_group_bytes = (int64_t)num_rows * rowSizeBytes;
+    pimpl->admitRowGroup(row_group_bytes);
+    column_job_t job;
+    buildColumns(job, batches, num_rows, trace_id);
+    vector<shared_ptr<arrow::Array>>& columns = job.columns;
+
+    /* Release Source Records - columns hold copies of the data */
+    uint32_t clear_trace_id = start_trace(INFO, trace_id, "clear_batch", "%s", "{}");
+    releaseRecords(batches);
+    delete sorted_record;
+    stop_trace(INFO, clear_trace_id);
 
-        /* Loop Through Each Row */
-        switch(field.type)
+    /* Open Parquet Writer with Encodings Sampled from First Row Group */
+    if(pimpl->arrowWriterProps && !pimpl->writerProps)
+    {
+        pimpl->selectEncodings(columns, geoData.spatial_sort);
+        if(!pimpl->openParquetWriter(pimpl->outputStream, pimpl->parquetWriter))
         {
-            case RecordObject::DOUBLE:
-            {
-                arrow::DoubleBuilder builder;
-                (void)builder.Reserve(num_rows);
-                unsigned long key = recordBatch.first(&batch);
-                while(key != (unsigned long)INVALID_KEY)
-                {
-                    int32_t starting_offset = field.offset;
-                    for(int row = 0; row < batch.rows; row++)
-                    {
-                        builder.UnsafeAppend((double)batch.record->getValueReal(field));
-                        field.offset += rowSizeBytes * 8;
-                    }
-                    field.offset = starting_offset;
-                    key = recordBatch.next(&batch);
-                }
-                (void)builder.Finish(&column);
-                break;
-            }
+            LuaEndpoint::generateExceptionStatus(RTE_ERROR, CRITICAL, outQ, NULL, "Failed to open parquet writer for %s", fileName);
+            abortOutput();
+        }
+    }
 
-            case RecordObject::FLOAT:
-            {
-                arrow::FloatBuilder builder;
-                (void)builder.Reserve(num_rows);
-                unsigned long key = recordBatch.first(&batch);
-                while(key != (unsigned long)INVALID_KEY)
-                {
-                    int32_t starting_offset = field.offset;
-                    for(int row = 0; row < batch.rows; row++)
-                    {
-                        builder.UnsafeAppend((float)batch.record->getValueReal(field));
-                        field.offset += rowSizeBytes * 8;
-                    }
-                    field.offset = starting_offset;
-                    key = recordBatch.next(&batch);
-                }
-                (void)builder.Finish(&column);
-                break;
-            }
+    /* Build and Write Row Group */
+    uint32_t write_trace_id = start_trace(INFO, trace_id, "write_table", "%s", "{}");
+    shared_ptr<arrow::Table> table = arrow::Table::Make(pimpl->schema, columns);
+    if(pimpl->parquetWriter)
+    {
+        (void)pimpl->parquetWriter->WriteTable(*table, num_rows);
+    }
+    else if(pimpl->ipcWriter)
+    {
+        /* Each Row Group is Sent as an IPC Record Batch Immediately */
+        (void)pimpl->ipcWriter->WriteTable(*table);
+        (void)pimpl->outputStream->Flush();
+    }
+    stop_trace(INFO, write_trace_id);
 
-            case RecordObject::INT8:
-            {
-                arrow::Int8Builder builder;
-                (void)builder.Reserve(num_rows);
-                unsigned long key = recordBatch.first(&batch);
-                while(key != (unsigned long)INVALID_KEY)
-                {
-                    int32_t starting_offset = field.offset;
-                    for(int row = 0; row < batch.rows; row++)
-                    {
-                        builder.UnsafeAppend((int8_t)batch.record->getValueInteger(field));
-                        field.offset += rowSizeBytes * 8;
-                    }
-                    field.offset = starting_offset;
-                    key = recordBatch.next(&batch);
-                }
-                (void)builder.Finish(&column);
-                break;
-            }
+    /* Report Memory Held while Writing */
+    updateMemoryMetrics(false);
 
-            case RecordObject::INT16:
-            {
-                arrow::Int16Builder builder;
-                (void)builder.Reserve(num_rows);
-                unsigned long key = recordBatch.first(&batch);
-                while(key != (unsigned long)INVALID_KEY)
-                {
-                    int32_t starting_offset = field.offset;
-                    for(int row = 0; row < batch.rows; row++)
-                    {
-                        builder.UnsafeAppend((int16_t)batch.record->getValueInteger(field));
-                        field.offset += rowSizeBytes * 8;
-                    }
-                    field.offset = starting_offset;
-                    key = recordBatch.next(&batch);
-                }
-                (void)builder.Finish(&column);
-                break;
-            }
+    /* Free Columns of Row Group */
+    table.reset();
+    columns.clear();
+    pimpl->completeRowGroup(row_group_bytes);
 
-            case RecordObject::INT32:
-            {
-                arrow::Int32Builder builder;
-                (void)builder.Reserve(num_rows);
-                unsigned long key = recordBatch.first(&batch);
-                while(key != (unsigned long)INVALID_KEY)
-                {
-                    int32_t starting_offset = field.offset;
-                    for(int row = 0; row < batch.rows; row++)
-                    {
-                        builder.UnsafeAppend((int32_t)batch.record->getValueInteger(field));
-                        field.offset += rowSizeBytes * 8;
-                    }
-                    field.offset = starting_offset;
-                    key = recordBatch.next(&batch);
-                }
-                (void)builder.Finish(&column);
-                break;
-            }
+    /* Stop Trace */
+    stop_trace(INFO, trace_id);
+}
 
-            case RecordObject::INT64:
-            {
-                arrow::Int64Builder builder;
-                (void)builder.Reserve(num_rows);
-                unsigned long key = recordBatch.first(&batch);
-                while(key != (unsigned long)INVALID_KEY)
-                {
-                    int32_t starting_offset = field.offset;
-                    for(int row = 0; row < batch.rows; row++)
-                    {
-                        builder.UnsafeAppend((int64_t)batch.record->getValueInteger(field));
-                        field.offset += rowSizeBytes * 8;
-                    }
-                    field.offset = starting_offset;
-                    key = recordBatch.next(&batch);
-                }
-                (void)builder.Finish(&column);
-                break;
-            }
+/*----------------------------------------------------------------------------
+ * abortOutput - ends the output without a file after a writer failed to open
+ *----------------------------------------------------------------------------*/
+void ParquetBuilder::abortOutput (void)
+{
+    /* Client gets the Error Instead of an Empty File */
+    (void)pimpl->outputStream->Abort();
 
-            case RecordObject::UINT8:
-            {
-                arrow::UInt8Builder builder;
-                (void)builder.Reserve(num_rows);
-                unsigned long key = recordBatch.first(&batch);
-                while(key != (unsigned long)INVALID_KEY)
-                {
-                    int32_t starting_offset = field.offset;
-                    for(int row = 0; row < batch.rows; row++)
-                    {
-                        builder.UnsafeAppend((uint8_t)batch.record->getValueInteger(field));
-                        field.offset += rowSizeBytes * 8;
-                    }
-                    field.offset = starting_offset;
-                    key = recordBatch.next(&batch);
-                }
-                (void)builder.Finish(&column);
-                break;
-            }
+    /* Nothing is Uploaded */
+    if(!streamToClient)
+    {
+        if(remove(fileName) != 0)
+        {
+            mlog(CRITICAL, "Failed to delete file %s: %s", fileName, strerror(errno));
+        }
+    }
+}
 
-            case RecordObject::UINT16:
-            {
-                arrow::UInt16Builder builder;
-                (void)builder.Reserve(num_rows);
-                unsigned long key = recordBatch.first(&batch);
-                while(key != (unsigned long)INVALID_KEY)
-                {
-                    int32_t starting_offset = field.offset;
-                    for(int row = 0; row < batch.rows; row++)
-                    {
-                        builder.UnsafeAppend((uint16_t)batch.record->getValueInteger(field));
-                        field.offset += rowSizeBytes * 8;
-                    }
-                    field.offset = starting_offset;
-                    key = recordBatch.next(&batch);
-                }
-                (void)builder.Finish(&column);
-                break;
-            }
+/*----------------------------------------------------------------------------
+ * abortOverBudget - fails the request when the memory budget cannot hold a
+ *                   minimal row group, the rows that follow are dropped
+ *----------------------------------------------------------------------------*/
+void ParquetBuilder::abortOverBudget (int shares)
+{
+    LuaEndpoint::generateExceptionStatus(RTE_ERROR, CRITICAL, outQ, NULL, "Memory budget of %ld bytes (%d writers) cannot hold a row group of %d rows (%ld bytes) for %s",
+                                         (long)pimpl->memoryBudget(), shares, minRowsInGroup, (long)minRowsInGroup * rowSizeBytes, fileName);
+    overBudget = true;
+    if(!partitioned) abortOutput();
+}
 
-            case RecordObject::UINT32:
-            {
-                arrow::UInt32Builder builder;
-                (void)builder.Reserve(num_rows);
-                unsigned long key = recordBatch.first(&batch);
-                while(key != (unsigned long)INVALID_KEY)
-                {
-                    int32_t starting_offset = field.offset;
-                    for(int row = 0; row < batch.rows; row++)
-                    {
-                        builder.UnsafeAppend((uint32_t)batch.record->getValueInteger(field));
-                        field.offset += rowSizeBytes * 8;
-                    }
-                    field.offset = starting_offset;
-                    key = recordBatch.next(&batch);
-                }
-                (void)builder.Finish(&column);
-                break;
-            }
+/*----------------------------------------------------------------------------
+ * updateMemoryMetrics
+ *----------------------------------------------------------------------------*/
+void ParquetBuilder::updateMemoryMetrics (bool complete)
+{
+    /* Arrow Memory Held by all Requests */
+    update_metric(DEBUG, activeMemoryMetricId, arrow::default_memory_pool()->bytes_allocated());
 
-            case RecordObject::UINT64:
-            {
-                arrow::UInt64Builder builder;
-                (void)builder.Reserve(num_rows);
-                unsigned long key = recordBatch.first(&batch);
-                while(key != (unsigned long)INVALID_KEY)
-                {
-                    int32_t starting_offset = field.offset;
-                    for(int row = 0; row < batch.rows; row++)
-                    {
-                        builder.UnsafeAppend((uint64_t)batch.record->getValueInteger(field));
-                        field.offset += rowSizeBytes * 8;
-                    }
-                    field.offset = starting_offset;
-                    key = recordBatch.next(&batch);
-                }
-                (void)builder.Finish(&column);
-                break;
-            }
+    /* Peak Arrow Memory of this Request */
+    if(complete)
+    {
+        int64_t peak = pimpl->memoryPool->max_memory();
+        update_metric(INFO, peakMemoryMetricId, peak);
+        mlog(INFO, "Peak arrow memory of %s was %ld bytes", fileName, (long)peak);
+    }
+}
+
+/*----------------------------------------------------------------------------
+ * buildColumns - builds every column of a row group on the column thread pool
+ *----------------------------------------------------------------------------*/
+void ParquetBuilder::buildColumns (column_job_t& job, const vector<batch_t>& batches, int num_rows, uint32_t trace_id)
+{
+    /* Initialize Column Job */
+    job.batches = &batches;
+    job.fields = fieldIterator;
+    job.geo = &geoData;
+    job.rowSizeBytes = rowSizeBytes;
+    job.numRows = num_rows;
+    job.traceId = trace_id;
+    job.pool = pimpl->memoryPool;
+    int num_columns = fieldIterator->length + (geoData.spatial_sort ? 1 : 0) + (geoData.as_geo ? 1 : 0); // geometry is the last column
+    job.columns.resize(num_columns);
+    job.remaining = num_columns;
+
+    /* Build Columns on Thread Pool */
+    for(int i = 0; i < num_columns; i++)
+    {
+        column_task_t task = {
+            .job = &job,
+            .column = i
+        };
+
+        /* Build Locally if Pool is Unavailable */
+        if(!columnActive || columnPub->postCopy(&task, sizeof(column_task_t), IO_CHECK) <= 0)
+        {
+            buildColumnTask(task);
+        }
+    }
+
+    /* Wait for Columns to Complete */
+    job.complete.lock();
+    {
+        while(job.remaining > 0)
+        {
+            job.complete.wait(0, SYS_TIMEOUT);
+        }
+    }
+    job.complete.unlock();
+}
+
+/*----------------------------------------------------------------------------
+ * releaseRecords
+ *----------------------------------------------------------------------------*/
+void ParquetBuilder::releaseRecords (vector<batch_t>& batches)
+{
+    for(batch_t& done_batch: batches)
+    {
+        if(done_batch.last)
+        {
+            delete done_batch.record;
+            inQ->dereference(done_batch.ref);
+        }
+    }
+    recordBatch.clear();
+    batches.clear();
+}
+
+/*----------------------------------------------------------------------------
+ * partitionRecord - copies each row of a record into the partition it belongs to
+ *----------------------------------------------------------------------------*/
+void ParquetBuilder::partitionRecord (RecordObject* record, int num_rows)
+{
+    partition_t* partition = NULL;
+    int64_t prev_key = 0;
+    RecordObject::field_t field = partitionField;
+    const uint8_t* row_data = record->getRecordData();
+    for(int row = 0; row < num_rows; row++)
+    {
+        /* Get Partition Key of Row */
+        int64_t key;
+        if(field.type == RecordObject::TIME8)
+        {
+            int64_t nsecs = record->getValueInteger(field);
+            key = (nsecs / NSECS_PER_DAY) - ((nsecs % NSECS_PER_DAY) < 0 ? 1 : 0); // floor to day
+        }
+        else
+        {
+            key = (int64_t)record->getValueInteger(field);
+        }
+
+        /* Look Up Partition only when Key Changes */
+        if(!partition || key != prev_key)
+        {
+            partition = getPartition(key);
+            prev_key = key;
+        }
 
-            case RecordObject::TIME8:
+        /* Stage Row */
+        partition->staged.insert(partition->staged.end(), row_data, row_data + rowSizeBytes);
+        partition->rows++;
+        stagedBytes += rowSizeBytes;
+        if(partition->rows >= maxRowsInGroup)
+        {
+            flushPartition(partition);
+        }
+
+        /* Bound Rows Staged Across all Partitions */
+        while(stagedBytes > MAX_PARTITION_STAGED_BYTES)
+        {
+            flushPartition(largestPartition());
+        }
+
+        /* Next Row */
+        field.offset += rowSizeBytes * 8;
+        row_data += rowSizeBytes;
+    }
+}
+
+/*----------------------------------------------------------------------------
+ * getPartition - finds or creates the partition for a key
+ *----------------------------------------------------------------------------*/
+ParquetBuilder::partition_t* ParquetBuilder::getPartition (int64_t key)
+{
+    /* Build Hive Style Partition Name */
+    char name[MAX_STR_SIZE];
+    if(partitionField.type == RecordObject::TIME8)
+    {
+        TimeLib::gmt_time_t gmt_time = TimeLib::sys2gmttime(key * (NSECS_PER_DAY / 1000));
+        TimeLib::date_t gmt_date = TimeLib::gmt2date(gmt_time);
+        StringLib::format(name, MAX_STR_SIZE, "date=%04d-%02d-%02d", gmt_date.year, gmt_date.month, gmt_date.day);
+    }
+    else
+    {
+        StringLib::format(name, MAX_STR_SIZE, "%s=%ld", parms->partition_by, (long)key);
+    }
+
+    /* Return Existing Partition */
+    partition_t* partition = NULL;
+    if(partitions.find(name, &partition))
+    {
+        return partition;
+    }
+
+    /* Create Partition */
+    SafeString tmp_file("%s.%s", fileName, name);
+    partition = new partition_t;
+    partition->name = StringLib::duplicate(name);
+    partition->fileName = tmp_file.str(true);
+    partition->writer = partitions.length() % numWriters;
+    partition->rows = 0;
+    partition->failed = false;
+    partitions.add(name, partition);
+
+    return partition;
+}
+
+/*----------------------------------------------------------------------------
+ * flushPartition - hands the staged rows of a partition to its writer
+ *----------------------------------------------------------------------------*/
+void ParquetBuilder::flushPartition (partition_t* partition)
+{
+    int data_size = MAX(partition->rows * rowSizeBytes, RecordObject::getRecordDataSize(recType));
+    RecordObject* record = new RecordObject(recType, data_size, false);
+    memcpy(record->getRecordData(), partition->staged.data(), partition->rows * rowSizeBytes);
+    postWriteTask(partition, record, partition->rows);
+    stagedBytes -= partition->rows * rowSizeBytes;
+    vector<uint8_t>().swap(partition->staged); // frees memory, many partitions may never fill again
+    partition->rows = 0;
+}
+
+/*----------------------------------------------------------------------------
+ * largestPartition - partition with the most staged rows
+ *----------------------------------------------------------------------------*/
+ParquetBuilder::partition_t* ParquetBuilder::largestPartition (void)
+{
+    partition_t* largest = NULL;
+    partition_t* partition;
+    const char* key = partitions.first(&partition);
+    while(key != NULL)
+    {
+        if(!largest || partition->rows > largest->rows) largest = partition;
+        key = partitions.next(&partition);
+    }
+    return largest;
+}
+
+/*----------------------------------------------------------------------------
+ * postWriteTask - blocks when the writer is behind, bounding staged memory
+ *----------------------------------------------------------------------------*/
+void ParquetBuilder::postWriteTask (partition_t* partition, RecordObject* record, int rows)
+{
+    write_task_t task = {
+        .partition = partition,
+        .record = record,
+        .rows = rows
+    };
+
+    Publisher* pub = writers[partition->writer].pub;
+    if(pub->postCopy(&task, sizeof(write_task_t), IO_PEND) <= 0)
+    {
+        mlog(CRITICAL, "Failed to post write of partition %s", partition->name);
+        delete record;
+    }
+}
+
+/*----------------------------------------------------------------------------
+ * writePartition - writes one row group to the file of a partition
+ *----------------------------------------------------------------------------*/
+void ParquetBuilder::writePartition (partition_t* partition, RecordObject* record, int rows)
+{
+    uint32_t trace_id = start_trace(INFO, traceId, "write_partition", "{\"partition\": \"%s\", \"num_rows\": %d}", partition->name, rows);
+
+    /* Open Partition File on First Write */
+    bool opened = (partition->outputStream != nullptr) && !partition->failed;
+    if(!opened && !partition->failed)
+    {
+        arrow::Result<shared_ptr<arrow::io::FileOutputStream>> result = arrow::io::FileOutputStream::Open(partition->fileName);
+        if(result.ok())
+        {
+            partition->outputStream = result.ValueOrDie();
+            opened = true;
+        }
+        else
+        {
+            LuaEndpoint::generateExceptionStatus(RTE_ERROR, CRITICAL, outQ, NULL, "Failed to open file of partition %s: %s", partition->name, result.status().ToString().c_str());
+            partition->failed = true;
+        }
+    }
+
+    if(opened)
+    {
+        /* Spatially Sort Rows */
+        if(geoData.spatial_sort)
+        {
+            batch_t unsorted = {
+                .ref = {NULL, 0, 0, NULL},
+                .record = record,
+                .start = 0,
+                .rows = rows,
+                .last = false
+            };
+            RecordObject* sorted_record = impl::sortRows(geoData, vector<batch_t>(1, unsorted), recType, rowSizeBytes, rows);
+            delete record;
+            record = sorted_record;
+        }
+
+        /* Write Rows in Row Groups that Fit the Writer's Share of the Memory Budget */
+        int max_rows = MAX(MIN(rows, pimpl->rowsInBudget(rowSizeBytes, numWriters)), 1);
+        for(int start = 0; start < rows && !partition->failed; start += max_rows)
+        {
+            /* Build Columns */
+            int group_rows = MIN(rows - start, max_rows);
+            vector<batch_t> batches;
+            batch_t batch = {
+                .ref = {NULL, 0, 0, NULL},
+                .record = record,
+                .start = start,
+                .rows = group_rows,
+                .last = false
+            };
+            batches.push_back(batch);
+            int64_t row_group_bytes = (int64_t)group_rows * rowSizeBytes;
+            pimpl->admitRowGroup(row_group_bytes);
+            column_job_t job;
+            buildColumns(job, batches, group_rows, trace_id);
+
+            /* Open Parquet Writer with Encodings Sampled from First Row Group */
+            if(!partition->parquetWriter)
             {
-                arrow::TimestampBuilder builder(arrow::timestamp(arrow::TimeUnit::NANO), arrow::default_memory_pool());
-                (void)builder.Reserve(num_rows);
-                unsigned long key = recordBatch.first(&batch);
-                while(key != (unsigned long)INVALID_KEY)
+                pimpl->selectEncodings(job.columns, geoData.spatial_sort);
+                if(!pimpl->openParquetWriter(partition->outputStream, partition->parquetWriter))
                 {
-                    int32_t starting_offset = field.offset;
-                    for(int row = 0; row < batch.rows; row++)
-                    {
-                        builder.UnsafeAppend((int64_t)batch.record->getValueInteger(field));
-                        field.offset += rowSizeBytes * 8;
-                    }
-                    field.offset = starting_offset;
-                    key = recordBatch.next(&batch);
+                    LuaEndpoint::generateExceptionStatus(RTE_ERROR, CRITICAL, outQ, NULL, "Failed to open parquet writer of partition %s", partition->name);
+                    partition->failed = true;
                 }
-                (void)builder.Finish(&column);
-                break;
             }
 
-            case RecordObject::STRING:
+            /* Write Row Group */
+            if(partition->parquetWriter)
             {
-                arrow::StringBuilder builder;
-                (void)builder.Reserve(num_rows);
-                unsigned long key = recordBatch.first(&batch);
-                while(key != (unsigned long)INVALID_KEY)
-                {
-                    int32_t starting_offset = field.offset;
-                    for(int row = 0; row < batch.rows; row++)
-                    {
-                        const char* str = batch.record->getValueText(field);
-                        builder.UnsafeAppend(str, StringLib::size(str));
-                        field.offset += rowSizeBytes * 8;
-                    }
-                    field.offset = starting_offset;
-                    key = recordBatch.next(&batch);
-                }
-                (void)builder.Finish(&column);
-                break;
+                shared_ptr<arrow::Table> table = arrow::Table::Make(pimpl->schema, job.columns);
+                (void)partition->parquetWriter->WriteTable(*table, group_rows);
             }
 
-            default:
+            /* Free Columns of Row Group */
+            job.columns.clear();
+            pimpl->completeRowGroup(row_group_bytes);
+        }
+    }
+
+    /* Release Rows */
+    delete record;
+
+    stop_trace(INFO, trace_id);
+}
+
+/*----------------------------------------------------------------------------
+ * closePartition - finishes the file of a partition and uploads it
+ *----------------------------------------------------------------------------*/
+void ParquetBuilder::closePartition (partition_t* partition)
+{
+    /* Discard File of a Partition whose Writer Failed to Open */
+    if(!partition->parquetWriter)
+    {
+        if(partition->outputStream)
+        {
+            (void)partition->outputStream->Close();
+            if(remove(partition->fileName) != 0)
             {
-                break;
+                mlog(CRITICAL, "Failed to delete file %s: %s", partition->fileName, strerror(errno));
             }
         }
+        return;
+    }
 
-        /* Add Column to Columns */
-        columns.push_back(column);
-        stop_trace(INFO, field_trace_id);
+    /* Close File */
+    (void)partition->parquetWriter->Close();
+    (void)partition->outputStream->Close();
+
+    /* Upload File */
+    #ifdef __aws__
+    const char* _path = parms->path;
+    const char* separator = (_path[StringLib::size(_path) - 1] == '/') ? "" : "/";
+    SafeString s3dst("%s%s%s/part-0.parquet", &_path[5], separator, partition->name);
+    send2S3(partition->fileName, s3dst.str());
+    #else
+    LuaEndpoint::generateExceptionStatus(RTE_ERROR, CRITICAL, outQ, NULL, "Output path specifies S3, but server compiled without AWS support");
+    #endif
+
+    /* Remove Local File */
+    if(remove(partition->fileName) != 0)
+    {
+        mlog(CRITICAL, "Failed to delete file %s: %s", partition->fileName, strerror(errno));
     }
+}
 
-    /* Add Geometry Column (if GeoParquet) */
-    if(geoData.as_geo)
+/*----------------------------------------------------------------------------
+ * closePartitions - writes remaining rows then closes and uploads all files
+ *----------------------------------------------------------------------------*/
+void ParquetBuilder::closePartitions (void)
+{
+    /* Flush and Close Partitions (writers upload in parallel) */
+    partition_t* partition;
+    const char* key = partitions.first(&partition);
+    while(key != NULL)
     {
-        uint32_t geo_trace_id = start_trace(INFO, trace_id, "geo_column", "%s", "{}");
-        RecordObject::field_t lon_field = geoData.lon_field;
-        RecordObject::field_t lat_field = geoData.lat_field;
-        shared_ptr<arrow::Array> column;
-        arrow::BinaryBuilder builder;
-        (void)builder.Reserve(num_rows);
-        (void)builder.ReserveData(num_rows * sizeof(wkbpoint_t));
-        unsigned long key = recordBatch.first(&batch);
-        while(key != (unsigned long)INVALID_KEY)
+        if(partition->rows > 0) flushPartition(partition);
+        postWriteTask(partition, NULL, 0);
+        key = partitions.next(&partition);
+    }
+
+    /* Stop Writers */
+    for(int w = 0; w < numWriters; w++)
+    {
+        write_task_t terminator = {
+            .partition = NULL,
+            .record = NULL,
+            .rows = 0
+        };
+        writers[w].pub->postCopy(&terminator, sizeof(write_task_t), IO_PEND);
+    }
+    for(int w = 0; w < numWriters; w++)
+    {
+        delete writers[w].pid;
+        writers[w].pid = NULL;
+
+        /* Drain Tasks Left by a Failed Writer */
+        write_task_t task;
+        while(writers[w].sub->receiveCopy(&task, sizeof(write_task_t), IO_CHECK) > 0)
         {
-            int32_t starting_lon_offset = lon_field.offset;
-            int32_t starting_lat_offset = lat_field.offset;
-            for(int row = 0; row < batch.rows; row++)
-            {
-                wkbpoint_t point = {
-                    #ifdef __be__
-                    .byteOrder = 0,
-                    #else
-                    .byteOrder = 1,
-                    #endif
-                    .wkbType = 1,
-                    .x = batch.record->getValueReal(lon_field),
-                    .y = batch.record->getValueReal(lat_field)
-                };
-                (void)builder.UnsafeAppend((uint8_t*)&point, sizeof(wkbpoint_t));
-                lon_field.offset += rowSizeBytes * 8;
-                lat_field.offset += rowSizeBytes * 8;
-            }
-            lon_field.offset = starting_lon_offset;
-            lat_field.offset = starting_lat_offset;
-            key = recordBatch.next(&batch);
+            delete task.record;
         }
-        (void)builder.Finish(&column);
-        columns.push_back(column);
-        stop_trace(INFO, geo_trace_id);
     }
+}
 
-    /* Build and Write Table */
-    uint32_t write_trace_id = start_trace(INFO, trace_id, "write_table", "%s", "{}");
-    if(pimpl->parquetWriter)
+/*----------------------------------------------------------------------------
+ * writerThread
+ *----------------------------------------------------------------------------*/
+void* ParquetBuilder::writerThread (void* parm)
+{
+    writer_t* writer = (writer_t*)parm;
+    ParquetBuilder* builder = writer->builder;
+
+    bool complete = false;
+    while(!complete)
     {
-        shared_ptr<arrow::Table> table = arrow::Table::Make(pimpl->schema, columns);
-        (void)pimpl->parquetWriter->WriteTable(*table, num_rows);
+        write_task_t task;
+        int recv_status = writer->sub->receiveCopy(&task, sizeof(write_task_t), SYS_TIMEOUT);
+        if(recv_status > 0)
+        {
+            if(task.partition == NULL)  complete = true;
+            else if(task.record)        builder->writePartition(task.partition, task.record, task.rows);
+            else                        builder->closePartition(task.partition);
+        }
+        else if(recv_status != MsgQ::STATE_TIMEOUT)
+        {
+            mlog(CRITICAL, "Failed to receive write task: %d", recv_status);
+            break;
+        }
     }
-    stop_trace(INFO, write_trace_id);
 
-    /* Clear Record Batch */
-    uint32_t clear_trace_id = start_trace(INFO, trace_id, "clear_batch", "%s", "{}");
-    unsigned long key = recordBatch.first(&batch);
-    while(key != (unsigned long)INVALID_KEY)
+    return NULL;
+}
+
+/*----------------------------------------------------------------------------
+ * columnThread
+ *----------------------------------------------------------------------------*/
+void* ParquetBuilder::columnThread (void* parm)
+{
+    (void)parm;
+
+    while(columnActive)
     {
-        delete batch.record;
-        inQ->dereference(batch.ref);
-        key = recordBatch.next(&batch);
+        column_task_t task;
+        int recv_status = columnSub->receiveCopy(&task, sizeof(column_task_t), SYS_TIMEOUT);
+        if(recv_status > 0)
+        {
+            buildColumnTask(task);
+        }
+        else if(recv_status != MsgQ::STATE_TIMEOUT)
+        {
+            mlog(CRITICAL, "Failed to receive column task: %d", recv_status);
+            break;
+        }
     }
-    recordBatch.clear();
-    stop_trace(INFO, clear_trace_id);
 
-    /* Stop Trace */
-    stop_trace(INFO, trace_id);
+    return NULL;
+}
+
+/*----------------------------------------------------------------------------
+ * buildColumnTask
+ *----------------------------------------------------------------------------*/
+void ParquetBuilder::buildColumnTask (column_task_t& task)
+{
+    column_job_t* job = task.job;
+    shared_ptr<arrow::Array> column;
+
+    /* Build Column */
+    if(task.column < job->fields->length)
+    {
+        uint32_t field_trace_id = start_trace(INFO, job->traceId, "append_field", "{\"field\": %d}", task.column);
+        RecordObject::field_t field = (*job->fields)[task.column];
+        column = impl::buildColumn(field, *job->batches, job->rowSizeBytes, job->numRows, job->pool);
+        stop_trace(INFO, field_trace_id);
+    }
+    else if(task.column < (int)job->columns.size() - 1)
+    {
+        uint32_t bbox_trace_id = start_trace(INFO, job->traceId, "bbox_column", "%s", "{}");
+        column = impl::buildCoveringColumn(*job->geo, *job->batches, job->rowSizeBytes, job->numRows, job->pool);
+        stop_trace(INFO, bbox_trace_id);
+    }
+    else
+    {
+        uint32_t geo_trace_id = start_trace(INFO, job->traceId, "geo_column", "%s", "{}");
+        column = impl::buildGeometryColumn(*job->geo, *job->batches, job->rowSizeBytes, job->numRows, job->pool);
+        stop_trace(INFO, geo_trace_id);
+    }
+
+    /* Signal Completion */
+    job->complete.lock();
+    {
+        job->columns[task.column] = column;
+        job->remaining--;
+        if(job->remaining == 0) job->complete.signal();
+    }
+    job->complete.unlock();
 }
 
 /*----------------------------------------------------------------------------
  * send2S3
  *----------------------------------------------------------------------------*/
-bool ParquetBuilder::send2S3 (const char* s3dst)
+bool ParquetBuilder::send2S3 (const char* local_file, const char* s3dst)
 {
     #ifdef __aws__
 
@@ -1070,7 +2409,7 @@ bool ParquetBuilder::send2S3 (const char* s3dst)
         try
         {
             /* Upload to S3 */
-            int64_t bytes_uploaded = S3CurlIODriver::put(fileName, bucket, key, parms->region, &parms->credentials);
+            int64_t bytes_uploaded = S3CurlIODriver::put(local_file, bucket, key, parms->region, &parms->credentials);
 
             /* Send Successful Status */
             LuaEndpoint::generateExceptionStatus(RTE_INFO, INFO, outQ, NULL, "Upload to S3 completed, bucket = %s, key = %s, size = %ld", bucket, key, bytes_uploaded);
@@ -1094,75 +2433,3 @@ bool ParquetBuilder::send2S3 (const char* s3dst)
     return false;
     #endif
 }
-
-/*----------------------------------------------------------------------------
- * send2Client
- *----------------------------------------------------------------------------*/
-bool ParquetBuilder::send2Client (void)
-{
-    bool status = true;
-
-    /* Reopen Parquet File to Stream Back as Response */
-    FILE* fp = fopen(fileName, "r");
-    if(fp)
-    {
-        /* Get Size of File */
-        fseek(fp, 0L, SEEK_END);
-        long file_size = ftell(fp);
-        fseek(fp, 0L, SEEK_SET);
-
-        do
-        {
-            /* Send Meta Record */
-            RecordObject meta_record(metaRecType);
-            arrow_file_meta_t* meta = (arrow_file_meta_t*)meta_record.getRecordData();
-            StringLib::copy(&meta->filename[0], parms->path, FILE_NAME_MAX_LEN);
-            meta->size = file_size;
-            if(!meta_record.post(outQ))
-            {
-                status = false;
-                break; // early exit on error
-            }
-
-            /* Send Data Records */
-            long offset = 0;
-            while(offset < file_size)
-            {
-                RecordObject data_record(dataRecType, 0, false);
-                arrow_file_data_t* data = (arrow_file_data_t*)data_record.getRecordData();
-                StringLib::copy(&data->filename[0], parms->path, FILE_NAME_MAX_LEN);
-                size_t bytes_read = fread(data->data, 1, FILE_BUFFER_RSPS_SIZE, fp);
-                if(!data_record.post(outQ, offsetof(arrow_file_data_t, data) + bytes_read))
-                {
-                    status = false;
-                    break; // early exit on error
-                }
-                offset += bytes_read;
-            }
-        } while(false);
-
-        /* Close File */
-        int rc1 = fclose(fp);
-        if(rc1 != 0)
-        {
-            status = false;
-            mlog(CRITICAL, "Failed (%d) to close file %s: %s", rc1, fileName, strerror(errno));
-        }
-
-        /* Remove File */
-        int rc2 = remove(fileName);
-        if(rc2 != 0)
-        {
-            status = false;
-            mlog(CRITICAL, "Failed (%d) to delete file %s: %s", rc2, fileName, strerror(errno));
-        }
-    }
-    else // unable to open file
-    {
-        status = false;
-        mlog(CRITICAL, "Failed (%d) to read parquet file %s: %s", errno, fileName, strerror(errno));
-    }
-
-    /* Return Status */
-    return status;
-}
@@ -44,8 +44,11 @@
  * INCLUDES
  ******************************************************************************/
 
+#include <vector>
+
 #include "MsgQ.h"
 #include "LuaObject.h"
+#include "Dictionary.h"
 #include "Ordering.h"
 #include "RecordObject.h"
 #include "ArrowParms.h"
@@ -67,8 +70,19 @@ class ParquetBuilder: public LuaObject
         static const int LIST_BLOCK_SIZE = 32;
         static const int FILE_NAME_MAX_LEN = 128;
         static const int FILE_BUFFER_RSPS_SIZE = 0x2000000; // 32MB
+        static const int STREAM_BUFFER_SIZE = 0x400000; // 4MB, bytes posted per data record when streaming to client
         static const int ROW_GROUP_SIZE = 0x4000000; // 64MB
         static const int QUEUE_BUFFER_FACTOR = 3;
+        static const int MAX_COLUMN_THREADS = 32;
+        static const int HILBERT_ORDER = 16; // bits per axis of the spatial sort curve
+        static const int MAX_PARTITION_WRITERS = 8;
+        static const int PARTITION_QUEUE_DEPTH = 4; // row groups queued per writer before the builder blocks
+        static const int64_t MAX_PARTITION_STAGED_BYTES = 0x10000000; // 256MB, rows staged across all partitions before the largest is flushed
+        static const int64_t NSECS_PER_DAY = 86400000000000LL; // time partitions are binned by day
+        static const int MIN_ROWS_IN_GROUP = 1024; // smallest row group built to stay under a memory budget
+        static const int ENCODING_SAMPLE_SIZE = 4096; // values sampled per column to choose its encoding
+        static const int DICTIONARY_CARDINALITY = 16; // dictionary encode when sampled values repeat this often on average
+        static const int ZSTD_COMPRESSION_LEVEL = 3;
 
         static const char* OBJECT_TYPE;
         static const char* LuaMetaName;
@@ -80,7 +94,11 @@ class ParquetBuilder: public LuaObject
         static const char* dataRecType;
         static const RecordObject::fieldDef_t dataRecDef[];
 
+        static const char* eofRecType; // uses meta record definition
+
         static const char* TMP_FILE_PREFIX;
+        static const char* ACTIVE_MEMORY_METRIC;
+        static const char* PEAK_MEMORY_METRIC;
 
         /*--------------------------------------------------------------------
          * Types
@@ -115,6 +133,7 @@ class ParquetBuilder: public LuaObject
 
         typedef struct {
             bool                    as_geo;
+            bool                    spatial_sort; // hilbert sort rows and add bbox covering column
             RecordObject::field_t   lon_field;
             RecordObject::field_t   lat_field;
         } geo_data_t;
@@ -129,13 +148,45 @@ class ParquetBuilder: public LuaObject
         typedef struct {
             Subscriber::msgRef_t    ref;
             RecordObject*           record;
+            int                     start;  // first row of record in this batch
             int                     rows;
+            bool                    last;   // batch holds the last rows of the record
         } batch_t;
 
+        struct column_job_t; // set of columns built for one row group
+
+        typedef struct {
+            column_job_t*           job;
+            int                     column;
+        } column_task_t;
+
+        struct partition_t; // open file and staged rows of one output partition
+
+        typedef struct {
+            partition_t*            partition; // NULL terminates writer
+            RecordObject*           record; // NULL closes and uploads partition
+            int                     rows;
+        } write_task_t;
+
+        typedef struct {
+            ParquetBuilder*         builder;
+            Publisher*              pub;
+            Subscriber*             sub;
+            Thread*                 pid;
+        } writer_t;
+
         /*--------------------------------------------------------------------
          * Data
          *--------------------------------------------------------------------*/
 
+        static Publisher*   columnPub;
+        static Subscriber*  columnSub;
+        static bool         columnActive;
+        static Thread**     columnPids; // thread pool
+        static int          columnPoolSize;
+        static int32_t      activeMemoryMetricId; // arrow bytes held across all requests
+        static int32_t      peakMemoryMetricId; // most arrow bytes held by the last completed request
+
         Thread*             builderPid;
         bool                active;
         Subscriber*         inQ;
@@ -147,9 +198,18 @@ class ParquetBuilder: public LuaObject
         Publisher*          outQ;
         int                 rowSizeBytes;
         int                 maxRowsInGroup;
+        int                 minRowsInGroup; // request fails when the memory budget cannot hold this many rows
         const char*         fileName; // used locally to build file
+        bool                streamToClient; // file is written directly to outQ
         geo_data_t          geoData;
         const char*         indexKey;
+        bool                partitioned; // output is a hive style dataset of files
+        RecordObject::field_t partitionField;
+        Dictionary<partition_t*> partitions;
+        int64_t             stagedBytes; // rows staged across all partitions
+        writer_t*           writers;
+        int                 numWriters;
+        bool                overBudget; // memory budget cannot hold a row group, remaining rows are dropped
 
         struct impl; // arrow implementation
         impl* pimpl; // private arrow data
@@ -161,13 +221,29 @@ class ParquetBuilder: public LuaObject
                             ParquetBuilder          (lua_State* L, ArrowParms* parms,
                                                      const char* outq_name, const char* inq_name,
                                                      const char* rec_type, const char* batch_rec_type,
-                                                     const char* id, geo_data_t geo, const char* index_key);
+                                                     const char* id, geo_data_t geo, const char* index_key,
+                                                     RecordObject::field_t partition_field);
                             ~ParquetBuilder         (void);
 
         static void*        builderThread           (void* parm);
+        static void*        columnThread            (void* parm);
+        static void*        writerThread            (void* parm);
+        static void         buildColumnTask         (column_task_t& task);
+        void                buildColumns            (column_job_t& job, const std::vector<batch_t>& batches, int num_rows, uint32_t trace_id);
         void                processRecordBatch      (int num_rows);
-        bool                send2S3                 (const char* s3dst);
-        bool                send2Client             (void);
+        void                releaseRecords          (std::vector<batch_t>& batches);
+        void                abortOutput             (void);
+        void                abortOverBudget         (int shares);
+        void                updateMemoryMetrics     (bool complete);
+        void                partitionRecord         (RecordObject* record, int num_rows);
+        partition_t*        getPartition            (int64_t key);
+        void                flushPartition          (partition_t* partition);
+        partition_t*        largestPartition        (void);
+        void                postWriteTask           (partition_t* partition, RecordObject* record, int rows);
+        void                writePartition          (partition_t* partition, RecordObject* record, int rows);
+        void                closePartition          (partition_t* partition);
+        void                closePartitions         (void);
+        bool                send2S3                 (const char* local_file, const char* s3dst);
 };
 
 #endif  /* __parquet_builder__ */
@@ -37,6 +37,7 @@
  ******************************************************************************/
 
 #include "ArrowParms.h"
+#include "ArrowReader.h"
 #include "ParquetBuilder.h"
 
 /******************************************************************************
@@ -38,13 +38,29 @@
 #include "core.h"
 
 #include <assert.h>
+#include <thread>
+
+/******************************************************************************
+ * LOCAL TYPES
+ ******************************************************************************/
+
+struct CredentialStore::snapshot_t
+{
+    std::atomic<long>       refs;
+    Dictionary<Credential>  store;
+
+    snapshot_t(void): refs(1), store(STARTING_STORE_SIZE) {}
+};
 
 /******************************************************************************
  * STATIC DATA
  ******************************************************************************/
 
 Mutex CredentialStore::credentialLock;
-Dictionary<CredentialStore::Credential> CredentialStore::credentialStore(STARTING_STORE_SIZE);
+std::atomic<CredentialStore::snapshot_t*> CredentialStore::currentSnapshot{NULL};
+std::atomic<long> CredentialStore::snapshotEpoch{0};
+std::atomic<long> CredentialStore::activeReaders[2] = {{0}, {0}};
+const CredentialStore::Credential CredentialStore::emptyCredential;
 Dictionary<int32_t> CredentialStore::metricIds(STARTING_STORE_SIZE);
 
 const char* CredentialStore::LIBRARY_NAME = "CredentialStore";
@@ -80,29 +96,63 @@ void CredentialStore::init (void)
  *----------------------------------------------------------------------------*/
 void CredentialStore::deinit (void)
 {
+    credentialLock.lock();
+    {
+        snapshot_t* snapshot = currentSnapshot.exchange(NULL);
+        long epoch = snapshotEpoch.load();
+        snapshotEpoch.store(epoch + 1);
+        while(activeReaders[epoch & 1].load() > 0) std::this_thread::yield();
+        if(snapshot) releaseSnapshot(snapshot);
+    }
+    credentialLock.unlock();
 }
 
 /*----------------------------------------------------------------------------
- * get
+ * acquire
+ *
+ *  lock-free; readers register in the current epoch for the few instructions
+ *  it takes to reference the published snapshot, and writers wait for the
+ *  previous epoch to drain before dropping the snapshot they replaced
  *----------------------------------------------------------------------------*/
-CredentialStore::Credential CredentialStore::get (const char* host)
+CredentialStore::Handle CredentialStore::acquire (const char* host)
 {
-    Credential credential;
+    /* Enter Read Side Critical Section */
+    long epoch;
+    while(true)
+    {
+        epoch = snapshotEpoch.load();
+        activeReaders[epoch & 1]++;
+        if(snapshotEpoch.load() == epoch) break;
+        activeReaders[epoch & 1]--;
+    }
 
-    credentialLock.lock();
+    /* Reference Published Snapshot */
+    snapshot_t* snapshot = currentSnapshot.load();
+    if(snapshot) snapshot->refs++;
+
+    /* Exit Read Side Critical Section */
+    activeReaders[epoch & 1]--;
+
+    /* Look Up Credential */
+    if(snapshot)
     {
-        try
-        {
-            credential = credentialStore[host];
-        }
-        catch(const RunTimeException& e)
+        if(host && snapshot->store.find(host))
         {
-            (void)e;
+            return Handle(snapshot, &snapshot->store.get(host));
         }
+        releaseSnapshot(snapshot);
     }
-    credentialLock.unlock();
 
-    return credential;
+    return Handle();
+}
+
+/*----------------------------------------------------------------------------
+ * get
+ *----------------------------------------------------------------------------*/
+CredentialStore::Credential CredentialStore::get (const char* host)
+{
+    Handle handle = acquire(host);
+    return *handle;
 }
 
 /*----------------------------------------------------------------------------
@@ -114,8 +164,20 @@ bool CredentialStore::put (const char* host, Credential& credential)
 
     credentialLock.lock();
     {
-        /* Store Credentials */
-        status = credentialStore.add(host, credential);
+        /* Build New Snapshot */
+        snapshot_t* snapshot = new snapshot_t;
+        snapshot_t* previous = currentSnapshot.load();
+        if(previous) snapshot->store = previous->store;
+        status = snapshot->store.add(host, credential);
+
+        /* Publish New Snapshot */
+        previous = currentSnapshot.exchange(snapshot);
+
+        /* Wait for Readers of Previous Snapshot */
+        long epoch = snapshotEpoch.load();
+        snapshotEpoch.store(epoch + 1);
+        while(activeReaders[epoch & 1].load() > 0) std::this_thread::yield();
+        if(previous) releaseSnapshot(previous);
 
         /* Find/Register Metric Id */
         int32_t metric_id = EventLib::INVALID_METRIC;
@@ -208,3 +270,69 @@ int CredentialStore::luaPut(lua_State* L)
     lua_pushboolean(L, status);
     return 1;
 }
+
+/*----------------------------------------------------------------------------
+ * releaseSnapshot
+ *----------------------------------------------------------------------------*/
+void CredentialStore::releaseSnapshot (snapshot_t* snapshot)
+{
+    if(--snapshot->refs == 0)
+    {
+        delete snapshot;
+    }
+}
+
+/******************************************************************************
+ * HANDLE SUBCLASS
+ ******************************************************************************/
+
+/*----------------------------------------------------------------------------
+ * Constructor
+ *----------------------------------------------------------------------------*/
+CredentialStore::Handle::Handle (void):
+    snapshot(NULL),
+    credential(&emptyCredential)
+{
+}
+
+/*----------------------------------------------------------------------------
+ * Constructor - takes ownership of caller's snapshot reference
+ *----------------------------------------------------------------------------*/
+CredentialStore::Handle::Handle (snapshot_t* _snapshot, const Credential* _credential):
+    snapshot(_snapshot),
+    credential(_credential)
+{
+}
+
+/*----------------------------------------------------------------------------
+ * Copy Constructor
+ *----------------------------------------------------------------------------*/
+CredentialStore::Handle::Handle (const Handle& h):
+    snapshot(h.snapshot),
+    credential(h.credential)
+{
+    if(snapshot) snapshot->refs++;
+}
+
+/*----------------------------------------------------------------------------
+ * Destructor
+ *----------------------------------------------------------------------------*/
+CredentialStore::Handle::~Handle (void)
+{
+    if(snapshot) releaseSnapshot(snapshot);
+}
+
+/*----------------------------------------------------------------------------
+ * operator=
+ *----------------------------------------------------------------------------*/
+CredentialStore::Handle& CredentialStore::Handle::operator= (const Handle& h)
+{
+    if(this != &h)
+    {
+        if(h.snapshot) h.snapshot->refs++;
+        if(snapshot) releaseSnapshot(snapshot);
+        snapshot = h.snapshot;
+        credential = h.credential;
+    }
+    return *this;
+}
@@ -42,6 +42,8 @@
 #include "LuaObject.h"
 #include "TimeLib.h"
 
+#include <atomic>
+
 /******************************************************************************
  * AWS S3 LIBRARY CLASS
  ******************************************************************************/
@@ -234,6 +236,31 @@ class CredentialStore
                 }
         };
 
+        /* Immutable copy of the store published by put */
+        struct snapshot_t;
+
+        /* Reference counted, read-only view of a stored credential */
+        class Handle
+        {
+            public:
+
+                                    Handle      (void);
+                                    Handle      (const Handle& h);
+                                    ~Handle     (void);
+                Handle&             operator=   (const Handle& h);
+                const Credential*   operator->  (void) const { return credential; }
+                const Credential&   operator*   (void) const { return *credential; }
+                const Credential*   get         (void) const { return credential; }
+
+            private:
+
+                friend class CredentialStore;
+                                    Handle      (snapshot_t* _snapshot, const Credential* _credential);
+
+                snapshot_t*         snapshot;
+                const Credential*   credential;
+        };
+
         /*--------------------------------------------------------------------
          * Methods
          *--------------------------------------------------------------------*/
@@ -241,6 +268,7 @@ class CredentialStore
         static void         init    (void);
         static void         deinit  (void);
 
+        static Handle       acquire (const char* host);
         static Credential   get     (const char* host);
         static bool         put     (const char* host, Credential& credential);
 
@@ -249,12 +277,21 @@ class CredentialStore
 
     private:
 
+        /*--------------------------------------------------------------------
+         * Methods
+         *--------------------------------------------------------------------*/
+
+        static void         releaseSnapshot (snapshot_t* snapshot);
+
         /*--------------------------------------------------------------------
          * Data
          *--------------------------------------------------------------------*/
 
-        static Mutex credentialLock;
-        static Dictionary<Credential> credentialStore;
+        static Mutex credentialLock; // serializes writers only
+        static std::atomic<snapshot_t*> currentSnapshot;
+        static std::atomic<long> snapshotEpoch;
+        static std::atomic<long> activeReaders[2];
+        static const Credential emptyCredential;
         static Dictionary<int32_t> metricIds;
 };
 
@@ -42,7 +42,8 @@
 #include <assert.h>
 #include <sys/stat.h>
 #include <stdio.h>
-#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <string.h>
 
 /******************************************************************************
@@ -52,17 +53,25 @@
 const char* S3CacheIODriver::FORMAT = "s3cache";
 
 const char* S3CacheIODriver::DEFAULT_CACHE_ROOT = ".cache";
-const char* S3CacheIODriver::cacheRoot = NULL;
-
-int         S3CacheIODriver::cacheMaxSize = 0;
-okey_t      S3CacheIODriver::cacheIndex = 0;
-Mutex       S3CacheIODriver::cacheMut;
-
-Dictionary<okey_t> S3CacheIODriver::cacheLookUp;
-MgOrdering<const char*, okey_t, true> S3CacheIODriver::cacheFiles;
+const char* S3CacheIODriver::CACHE_INDEX_FILE = "s3cache.idx";
+const char* S3CacheIODriver::CACHE_DATA_FILE = "s3cache.dat";
+
+const char*     S3CacheIODriver::cacheRoot = NULL;
+int64_t         S3CacheIODriver::cacheBlockSize = 0;
+long            S3CacheIODriver::cacheNumSlots = 0;
+int             S3CacheIODriver::cacheDataFd = -1;
+int             S3CacheIODriver::cacheIndexFd = -1;
+Mutex           S3CacheIODriver::cacheMut;
+
+S3CacheIODriver::cache_slot_t*  S3CacheIODriver::cacheSlots = NULL;
+S3CacheIODriver::cache_shard_t  S3CacheIODriver::cacheShards[NUM_CACHE_SHARDS];
+Mutex                           S3CacheIODriver::slotMut;
+okey_t                          S3CacheIODriver::slotIndex = 0;
+long                            S3CacheIODriver::clockHand = 0;
+List<long>                      S3CacheIODriver::freeSlots;
 
 /******************************************************************************
- * FILE IO DRIVER CLASS
+ * S3 CACHE IO DRIVER CLASS
  ******************************************************************************/
 
 /*----------------------------------------------------------------------------
@@ -71,8 +80,24 @@ MgOrdering<const char*, okey_t, true> S3CacheIODriver::cacheFiles;
 void S3CacheIODriver::init (void)
 {
     cacheRoot = NULL;
-    cacheMaxSize = DEFAULT_MAX_CACHE_FILES;
+    cacheBlockSize = DEFAULT_CACHE_BLOCK_SIZE;
+    cacheNumSlots = 0;
+}
+
+/*----------------------------------------------------------------------------
+ * deinit
+ *----------------------------------------------------------------------------*/
+void S3CacheIODriver::deinit (void)
+{
+    cacheMut.lock();
+    {
+        closeCache();
+        if(cacheRoot) delete [] cacheRoot;
+        cacheRoot = NULL;
+    }
+    cacheMut.unlock();
 }
+
 /*----------------------------------------------------------------------------
  * create
  *----------------------------------------------------------------------------*/
@@ -82,7 +107,7 @@ Asset::IODriver* S3CacheIODriver::create (const Asset* _asset, const char* resou
 }
 
 /*----------------------------------------------------------------------------
- * luaCreateCache - s3cache(<root>, [<max_files>])
+ * luaCreateCache - s3cache(<root>, [<max_size>], [<block_size>])
  *----------------------------------------------------------------------------*/
 int S3CacheIODriver::luaCreateCache(lua_State* L)
 {
@@ -90,10 +115,11 @@ int S3CacheIODriver::luaCreateCache(lua_State* L)
     {
         /* Get Parameters */
         const char* cache_root  = LuaObject::getLuaString(L, 1, true, DEFAULT_CACHE_ROOT);
-        int         max_files   = LuaObject::getLuaInteger(L, 2, true, DEFAULT_MAX_CACHE_FILES);
+        long        max_size    = LuaObject::getLuaInteger(L, 2, true, DEFAULT_MAX_CACHE_SIZE);
+        long        block_size  = LuaObject::getLuaInteger(L, 3, true, DEFAULT_CACHE_BLOCK_SIZE);
 
         /* Create Cache */
-        createCache(cache_root, max_files);
+        createCache(cache_root, max_size, block_size);
 
         lua_pushboolean(L, true);
         return 1;
@@ -108,10 +134,33 @@ int S3CacheIODriver::luaCreateCache(lua_State* L)
 
 /*----------------------------------------------------------------------------
  * createCache
+ *
+ *  The cache is a single data file divided into fixed size slots, each
+ *  holding one block of an S3 object, and an index file that records which
+ *  block lives in each slot so that the cache survives a restart.  An
+ *  existing index is reused only if it was built with the same geometry.
+ *  Blocks hash to shards that lock their names independently, while slots
+ *  are shared by the whole cache and replaced in clock order: a hit only
+ *  pins its slot and sets its reference bit, and the evictor sweeping under
+ *  slotMut gives referenced blocks a second chance.
+ *
+ *  Reads do not take cacheMut, so the cache must not be recreated while
+ *  S3 cache drivers are in use.
  *----------------------------------------------------------------------------*/
-int S3CacheIODriver::createCache (const char* cache_root, int max_files)
+long S3CacheIODriver::createCache (const char* cache_root, int64_t max_size, int64_t block_size)
 {
-    int file_count = 0;
+    long blocks_loaded = 0;
+
+    /* Check Parameters */
+    if(block_size < MIN_CACHE_BLOCK_SIZE)
+    {
+        throw RunTimeException(CRITICAL, RTE_ERROR, "Invalid cache block size: %ld", (long)block_size);
+    }
+    long num_slots = max_size / block_size;
+    if(num_slots <= 0)
+    {
+        throw RunTimeException(CRITICAL, RTE_ERROR, "Invalid cache size %ld for block size %ld", (long)max_size, (long)block_size);
+    }
 
     cacheMut.lock();
     {
@@ -123,56 +172,110 @@ int S3CacheIODriver::createCache (const char* cache_root, int max_files)
             throw RunTimeException(CRITICAL, RTE_ERROR, "Failed to create cache directory %s: %s", cache_root, strerror(errno));
         }
 
-        /* Set Cache Root */
+        /* Release Existing Cache */
+        closeCache();
+
+        /* Set Cache Attributes */
         if(cacheRoot) delete [] cacheRoot;
         cacheRoot = StringLib::duplicate(cache_root);
+        cacheBlockSize = block_size;
+        cacheNumSlots = num_slots;
+
+        /* Open Cache Files */
+        SafeString index_filepath("%s%c%s", cacheRoot, PATH_DELIMETER, CACHE_INDEX_FILE);
+        SafeString data_filepath("%s%c%s", cacheRoot, PATH_DELIMETER, CACHE_DATA_FILE);
+        cacheIndexFd = open(index_filepath.str(), O_RDWR | O_CREAT, 0600);
+        cacheDataFd = open(data_filepath.str(), O_RDWR | O_CREAT, 0600);
+        if(cacheIndexFd < 0 || cacheDataFd < 0)
+        {
+            int errcode = errno;
+            closeCache();
+            cacheMut.unlock();
+            throw RunTimeException(CRITICAL, RTE_ERROR, "Failed to open cache files in %s: %s", cache_root, strerror(errcode));
+        }
 
-        /* Set Maximum Number of Files */
-        cacheMaxSize = max_files;
+        /* Allocate Slots */
+        cacheSlots = new cache_slot_t [cacheNumSlots];
+        for(long slot = 0; slot < cacheNumSlots; slot++)
+        {
+            cacheSlots[slot].name = NULL;
+            cacheSlots[slot].sequence = 0;
+            cacheSlots[slot].size = 0;
+            cacheSlots[slot].pins = 0;
+            cacheSlots[slot].referenced = false;
+        }
 
-        /* Clear Out Cache Lookup Table and Files */
-        cacheLookUp.clear();
-        cacheFiles.clear();
+        /* Check Existing Index */
+        index_header_t header;
+        bool reuse_index =  (pread(cacheIndexFd, &header, sizeof(header), 0) == (ssize_t)sizeof(header)) &&
+                            (header.magic == CACHE_INDEX_MAGIC) &&
+                            (header.version == CACHE_INDEX_VERSION) &&
+                            (header.block_size == cacheBlockSize) &&
+                            (header.num_slots == cacheNumSlots);
 
-        /* Traverse Directory and Build Cache (if it does exist) */
-        DIR *dir;
-        if((dir = opendir(cacheRoot)) != NULL)
+        if(reuse_index)
         {
-            struct dirent *ent;
-            while((ent = readdir(dir)) != NULL)
+            /* Load Blocks from Index */
+            index_entry_t entry;
+            for(long slot = cacheNumSlots - 1; slot >= 0; slot--)
             {
-                if(!StringLib::match(".", ent->d_name) && !StringLib::match("..", ent->d_name))
+                off_t offset = sizeof(index_header_t) + (slot * sizeof(index_entry_t));
+                bool valid = (pread(cacheIndexFd, &entry, sizeof(entry), offset) == (ssize_t)sizeof(entry)) &&
+                             (entry.size > 0) && (entry.size <= cacheBlockSize) &&
+                             (entry.name[MAX_BLOCK_NAME_SIZE - 1] == '\0');
+                Dictionary<long>* look_up = valid ? &cacheShards[getShard(entry.name)].lookUp : NULL;
+                if(valid && !look_up->find(entry.name))
+                {
+                    cache_slot_t& cache_slot = cacheSlots[slot];
+                    cache_slot.name = StringLib::duplicate(entry.name, MAX_BLOCK_NAME_SIZE);
+                    cache_slot.sequence = entry.sequence;
+                    cache_slot.size = entry.size;
+                    look_up->add(cache_slot.name, slot);
+                    slotIndex = MAX(slotIndex, cache_slot.sequence);
+                    blocks_loaded++;
+                }
+                else
                 {
-                    if(file_count++ < cacheMaxSize)
-                    {
-                        char cache_filepath[MAX_STR_SIZE];
-                        StringLib::format(cache_filepath, MAX_STR_SIZE, "%s%c%s", cacheRoot, PATH_DELIMETER, ent->d_name);
-
-                        /* Reformat Filename to Key */
-                        SafeString key("%s", ent->d_name);
-                        key.replace("#", PATH_DELIMETER_STR);
-
-                        /* Add File to Cache */
-                        cacheIndex++;
-                        cacheLookUp.add(key.str(), cacheIndex);
-                        const char* cache_key = StringLib::duplicate(key.str());
-                        cacheFiles.add(cacheIndex, cache_key);
-                        mlog(INFO, "Caching %s for S3 retrieval", key.str());
-                    }
+                    freeSlots.add(slot);
                 }
             }
-            closedir(dir);
+        }
+        else
+        {
+            /* Reset Cache Files */
+            header.magic = CACHE_INDEX_MAGIC;
+            header.version = CACHE_INDEX_VERSION;
+            header.block_size = cacheBlockSize;
+            header.num_slots = cacheNumSlots;
+            off_t index_size = sizeof(index_header_t) + (cacheNumSlots * sizeof(index_entry_t));
+            off_t data_size = cacheNumSlots * cacheBlockSize;
+            bool reset =    (ftruncate(cacheIndexFd, 0) == 0) &&
+                            (ftruncate(cacheIndexFd, index_size) == 0) &&
+                            (pwrite(cacheIndexFd, &header, sizeof(header), 0) == (ssize_t)sizeof(header)) &&
+                            (fdatasync(cacheIndexFd) == 0) &&
+                            (ftruncate(cacheDataFd, 0) == 0) &&
+                            (ftruncate(cacheDataFd, data_size) == 0);
+            if(!reset)
+            {
+                int errcode = errno;
+                closeCache();
+                cacheMut.unlock();
+                throw RunTimeException(CRITICAL, RTE_ERROR, "Failed to initialize cache files in %s: %s", cache_root, strerror(errcode));
+            }
 
-            /* Log Status */
-            if(file_count > 0)
+            /* All Slots Free */
+            for(long slot = cacheNumSlots - 1; slot >= 0; slot--)
             {
-                mlog(INFO, "Loaded %ld of %d files into S3 cache", cacheFiles.length(), file_count);
+                freeSlots.add(slot);
             }
         }
+
+        /* Log Status */
+        mlog(INFO, "Loaded %ld of %ld blocks into S3 cache at %s", blocks_loaded, cacheNumSlots, cacheRoot);
     }
     cacheMut.unlock();
 
-    return file_count;
+    return blocks_loaded;
 }
 
 /*----------------------------------------------------------------------------
@@ -180,14 +283,61 @@ int S3CacheIODriver::createCache (const char* cache_root, int max_files)
  *----------------------------------------------------------------------------*/
 int64_t S3CacheIODriver::ioRead (uint8_t* data, int64_t size, uint64_t pos)
 {
-    /* Seek to New Position */
-    if(fseek(ioFile, pos, SEEK_SET) != 0)
+    int64_t bytes_read = 0;
+
+    while(bytes_read < size)
     {
-        throw RunTimeException(CRITICAL, RTE_ERROR, "failed to go to I/O position: 0x%lx", pos);
+        uint64_t offset = pos + bytes_read;
+        uint64_t block = offset / cacheBlockSize;
+        int64_t block_offset = offset % cacheBlockSize;
+        int64_t bytes_to_read = MIN(size - bytes_read, cacheBlockSize - block_offset);
+
+        /* Attempt to Read Block from Cache */
+        int64_t bytes_copied = readBlock(block, &data[bytes_read], bytes_to_read, block_offset);
+        if(bytes_copied < 0)
+        {
+            /* Claim Block, or Wait on Reader Already Downloading It */
+            cache_fill_t* fill = NULL;
+            claim_t claim = claimBlock(block, &fill);
+            if(claim == BLOCK_IN_FLIGHT)
+            {
+                waitBlock(block, fill);
+                continue;
+            }
+            else if(claim == BLOCK_CACHED)
+            {
+                continue;
+            }
+
+            /* Claim Run of Missing Blocks */
+            uint64_t last_block = (pos + size - 1) / cacheBlockSize;
+            int num_blocks = 1;
+            while((block + num_blocks <= last_block) && (num_blocks < MAX_FILL_BLOCKS) && (claimBlock(block + num_blocks, NULL) == BLOCK_CLAIMED))
+            {
+                num_blocks++;
+            }
+
+            /* Download Claimed Blocks */
+            bytes_to_read = MIN(size - bytes_read, (num_blocks * cacheBlockSize) - block_offset);
+            try
+            {
+                bytes_copied = fillBlocks(block, num_blocks, &data[bytes_read], bytes_to_read, block_offset);
+            }
+            catch(const RunTimeException& e)
+            {
+                /* Ranges starting past the end of the object fail */
+                if(bytes_read == 0) throw;
+                mlog(DEBUG, "Short read of %s at %lu: %s", ioObject, (unsigned long)offset, e.what());
+                break;
+            }
+        }
+
+        /* Stop at End of Object */
+        bytes_read += bytes_copied;
+        if(bytes_copied < bytes_to_read) break;
     }
 
-    /* Read Data */
-    return fread(data, 1, size, ioFile);
+    return bytes_read;
 }
 
 /*----------------------------------------------------------------------------
@@ -196,107 +346,487 @@ int64_t S3CacheIODriver::ioRead (uint8_t* data, int64_t size, uint64_t pos)
 S3CacheIODriver::S3CacheIODriver (const Asset* _asset, const char* resource):
     S3CurlIODriver(_asset, resource)
 {
-    ioFile = NULL;
-
     /* Check if Cache Created */
     if(cacheRoot == NULL) throw RunTimeException(CRITICAL, RTE_ERROR, "cache has not been created yet");
 
-    /* Get Cached File */
-    const char* filename = NULL;
-    if(fileGet(ioBucket, ioKey, &filename))
+    /* Build Object Name */
+    SafeString object_name("%s/%s", ioBucket, ioKey);
+    if(object_name.length() >= (MAX_BLOCK_NAME_SIZE - 32))
     {
-        ioFile = fopen(filename, "r");
-        delete [] filename;
+        throw RunTimeException(CRITICAL, RTE_ERROR, "resource name too long to cache: %s", resource);
     }
+    ioObject = StringLib::duplicate(object_name.str());
+}
 
-    /* Check if File Opened */
-    if(ioFile == NULL)
+/*----------------------------------------------------------------------------
+ * Destructor
+ *----------------------------------------------------------------------------*/
+S3CacheIODriver::~S3CacheIODriver (void)
+{
+    delete [] ioObject;
+}
+
+/*----------------------------------------------------------------------------
+ * readBlock
+ *
+ *  returns number of bytes copied, or -1 if the block is not in the cache
+ *----------------------------------------------------------------------------*/
+int64_t S3CacheIODriver::readBlock (uint64_t block, uint8_t* data, int64_t size, int64_t offset)
+{
+    SafeString name("%s:%lu", ioObject, (unsigned long)block);
+    cache_shard_t& shard = cacheShards[getShard(name.str())];
+    long slot = -1;
+    int64_t block_size = 0;
+
+    /* Look Up and Pin Block - a published slot cannot be evicted while its shard is locked */
+    shard.mut.lock();
+    {
+        if(shard.lookUp.find(name.str(), &slot))
+        {
+            cache_slot_t& cache_slot = cacheSlots[slot];
+            cache_slot.pins++;
+            cache_slot.referenced = true;
+            block_size = cache_slot.size;
+        }
+    }
+    shard.mut.unlock();
+
+    /* Cache Miss */
+    if(slot < 0) return -1;
+
+    /* Read Block */
+    int64_t bytes_to_copy = MAX(MIN(size, block_size - offset), 0);
+    ssize_t bytes_copied = 0;
+    if(bytes_to_copy > 0)
     {
-        throw RunTimeException(CRITICAL, RTE_ERROR, "failed to open resource");
+        bytes_copied = pread(cacheDataFd, data, bytes_to_copy, (slot * cacheBlockSize) + offset);
     }
+
+    /* Unpin Block */
+    cacheSlots[slot].pins--;
+
+    /* Check Read */
+    if(bytes_copied != bytes_to_copy)
+    {
+        throw RunTimeException(CRITICAL, RTE_ERROR, "failed to read cached block %s: %s", name.str(), strerror(errno));
+    }
+
+    return bytes_copied;
 }
 
 /*----------------------------------------------------------------------------
- * Destructor
+ * fillBlocks
+ *
+ *  downloads a run of claimed blocks, copies the requested bytes into data,
+ *  caches each block that was returned, and releases the claims; returns
+ *  number of bytes copied
  *----------------------------------------------------------------------------*/
-S3CacheIODriver::~S3CacheIODriver (void)
+int64_t S3CacheIODriver::fillBlocks (uint64_t block, int num_blocks, uint8_t* data, int64_t size, int64_t offset)
 {
-    if(ioFile) fclose(ioFile);
-    ioFile = NULL;
+    /* Download Blocks */
+    int64_t fill_size = num_blocks * cacheBlockSize;
+    uint8_t* buffer = new uint8_t [fill_size];
+    int64_t bytes_downloaded = 0;
+    try
+    {
+        bytes_downloaded = get(buffer, fill_size, block * cacheBlockSize, ioBucket, ioKey, asset->getRegion(), latestCredentials.get());
+    }
+    catch(const RunTimeException& e)
+    {
+        delete [] buffer;
+        for(int i = 0; i < num_blocks; i++) releaseBlock(block + i);
+        throw;
+    }
+
+    /* Copy Requested Data */
+    int64_t bytes_copied = MAX(MIN(size, bytes_downloaded - offset), 0);
+    if(bytes_copied > 0) memcpy(data, &buffer[offset], bytes_copied);
+
+    /* Populate Cache and Wake Waiting Readers */
+    storeBlocks(block, num_blocks, buffer, bytes_downloaded);
+    for(int i = 0; i < num_blocks; i++)
+    {
+        releaseBlock(block + i);
+    }
+
+    /* Clean Up */
+    delete [] buffer;
+
+    return bytes_copied;
 }
 
 /*----------------------------------------------------------------------------
- * fileGet
+ * storeBlocks
+ *
+ *  caches each block of a downloaded run; size is the number of bytes
+ *  downloaded starting at the first block
  *----------------------------------------------------------------------------*/
-bool S3CacheIODriver::fileGet (const char* bucket, const char* key, const char** file)
+void S3CacheIODriver::storeBlocks (uint64_t block, int num_blocks, const uint8_t* data, int64_t size)
 {
-    /* Check Cache */
-    bool found_in_cache = false;
-    cacheMut.lock();
+    long* slots = new long [num_blocks];
+    bool reserved = false;
+
+    /* Reserve Slots (returned pinned) and Invalidate Their Entries */
+    for(int i = 0; i < num_blocks; i++)
     {
-        if(cacheLookUp.find(key))
+        slots[i] = -1;
+        int64_t block_size = MIN(cacheBlockSize, size - (i * cacheBlockSize));
+        if(block_size <= 0) continue;
+
+        SafeString name("%s:%lu", ioObject, (unsigned long)(block + i));
+        long slot = allocateSlot();
+        if(slot < 0)
         {
-            cacheIndex++;
-            cacheFiles.remove(cacheLookUp[key]);
-            cacheLookUp.add(key, cacheIndex);
-            const char* cache_key = StringLib::duplicate(key);
-            cacheFiles.add(cacheIndex, cache_key);
-            found_in_cache = true;
+            mlog(DEBUG, "No room in S3 cache for %s", name.str());
+            continue;
         }
+        slotMut.lock();
+        {
+            cache_slot_t& cache_slot = cacheSlots[slot];
+            cache_slot.name = StringLib::duplicate(name.str());
+            cache_slot.sequence = ++slotIndex;
+            cache_slot.size = block_size;
+        }
+        slotMut.unlock();
+
+        writeIndexEntry(slot, false);
+        slots[i] = slot;
+        reserved = true;
     }
-    cacheMut.unlock();
 
-    /* Build Cache Filename */
-    SafeString cache_filename("%s", key);
-    cache_filename.replace(PATH_DELIMETER_STR, "#");
-    SafeString cache_filepath("%s%c%s", cacheRoot, PATH_DELIMETER, cache_filename.str());
+    /* Write Blocks
+     *  the entries are invalidated and synced before the data is written,
+     *  and the data is synced before the entries are rewritten, so after a
+     *  crash an entry never points at a partially written block; each file
+     *  is synced once for the whole run */
+    bool written = reserved && (fdatasync(cacheIndexFd) == 0);
+    for(int i = 0; written && i < num_blocks; i++)
+    {
+        long slot = slots[i];
+        if(slot < 0) continue;
+        int64_t block_size = cacheSlots[slot].size;
+        written = (pwrite(cacheDataFd, &data[i * cacheBlockSize], block_size, slot * cacheBlockSize) == block_size);
+    }
+    written = written && (fdatasync(cacheDataFd) == 0);
+    if(reserved && !written)
+    {
+        mlog(CRITICAL, "Failed to write blocks of %s to S3 cache: %s", ioObject, strerror(errno));
+    }
+
+    /* Publish Blocks */
+    for(int i = 0; i < num_blocks; i++)
+    {
+        long slot = slots[i];
+        if(slot < 0) continue;
+        if(written) writeIndexEntry(slot, true);
+
+        cache_slot_t& cache_slot = cacheSlots[slot];
+        cache_shard_t& shard = cacheShards[getShard(cache_slot.name)];
+        shard.mut.lock();
+        {
+            if(written && !shard.lookUp.find(cache_slot.name))
+            {
+                shard.lookUp.add(cache_slot.name, slot);
+                cache_slot.referenced = true;
+                cache_slot.pins--;
+            }
+            else
+            {
+                slotMut.lock();
+                {
+                    cache_slot.pins--;
+                    releaseSlot(slot);
+                }
+                slotMut.unlock();
+            }
+        }
+        shard.mut.unlock();
+    }
+    if(written) (void)fdatasync(cacheIndexFd);
+
+    /* Clean Up */
+    delete [] slots;
+}
 
-    /* Log Operation */
-    mlog(DEBUG, "S3 %s object %s in bucket %s: %s", found_in_cache ? "cache hit on" : "download of", key, bucket, cache_filepath.str());
+/*----------------------------------------------------------------------------
+ * claimBlock
+ *
+ *  a claimed block must be released by the caller once it has been stored;
+ *  if fill is supplied and the block is in flight, a reference to the
+ *  download is returned and must be passed to waitBlock
+ *----------------------------------------------------------------------------*/
+S3CacheIODriver::claim_t S3CacheIODriver::claimBlock (uint64_t block, cache_fill_t** fill)
+{
+    SafeString name("%s:%lu", ioObject, (unsigned long)block);
+    cache_shard_t& shard = cacheShards[getShard(name.str())];
+    claim_t claim;
 
-    /* Quick Exit If Cache Hit */
-    if(found_in_cache)
+    shard.mut.lock();
     {
-        *file = cache_filepath.str(true);
-        return true;
+        cache_fill_t* in_flight = NULL;
+        if(shard.lookUp.find(name.str()))
+        {
+            claim = BLOCK_CACHED;
+        }
+        else if(shard.inFlight.find(name.str(), &in_flight))
+        {
+            claim = BLOCK_IN_FLIGHT;
+            if(fill)
+            {
+                in_flight->refs++;
+                *fill = in_flight;
+            }
+        }
+        else
+        {
+            cache_fill_t* new_fill = new cache_fill_t;
+            shard.inFlight.add(name.str(), new_fill);
+            claim = BLOCK_CLAIMED;
+        }
     }
+    shard.mut.unlock();
+
+    return claim;
+}
+
+/*----------------------------------------------------------------------------
+ * releaseBlock
+ *----------------------------------------------------------------------------*/
+void S3CacheIODriver::releaseBlock (uint64_t block)
+{
+    SafeString name("%s:%lu", ioObject, (unsigned long)block);
+    cache_shard_t& shard = cacheShards[getShard(name.str())];
 
-    /* Download File */
-    int64_t bytes_read = get(cache_filepath.str(), bucket, key, asset->getRegion(), &latestCredentials);
-    if(bytes_read <= 0)
+    /* Remove Download */
+    cache_fill_t* fill = NULL;
+    shard.mut.lock();
     {
-        mlog(CRITICAL, "Failed to download S3 object: %ld", (long int)bytes_read);
-        return false;
+        if(shard.inFlight.find(name.str(), &fill))
+        {
+            shard.inFlight.remove(name.str());
+        }
     }
+    shard.mut.unlock();
+    if(!fill) return;
 
-    /* Populate Cache */
-    cacheMut.lock();
+    /* Wake Waiting Readers */
+    fill->cond.lock();
     {
-        if(cacheLookUp.length() >= cacheMaxSize)
+        fill->complete = true;
+        fill->cond.signal();
+    }
+    fill->cond.unlock();
+
+    /* Drop Owner's Reference */
+    bool last_ref;
+    shard.mut.lock();
+    {
+        last_ref = (--fill->refs == 0);
+    }
+    shard.mut.unlock();
+    if(last_ref) delete fill;
+}
+
+/*----------------------------------------------------------------------------
+ * waitBlock
+ *----------------------------------------------------------------------------*/
+void S3CacheIODriver::waitBlock (uint64_t block, cache_fill_t* fill)
+{
+    SafeString name("%s:%lu", ioObject, (unsigned long)block);
+    cache_shard_t& shard = cacheShards[getShard(name.str())];
+
+    /* Wait for Download to Complete */
+    fill->cond.lock();
+    {
+        while(!fill->complete)
         {
-            /* Get Oldest File from Cache */
-            const char* oldest_key = NULL;
-            okey_t index = cacheFiles.first(&oldest_key);
-            if(oldest_key != NULL)
+            fill->cond.wait(0, SYS_TIMEOUT);
+        }
+    }
+    fill->cond.unlock();
+
+    /* Drop Waiter's Reference */
+    bool last_ref;
+    shard.mut.lock();
+    {
+        last_ref = (--fill->refs == 0);
+    }
+    shard.mut.unlock();
+    if(last_ref) delete fill;
+}
+
+/*----------------------------------------------------------------------------
+ * getShard
+ *----------------------------------------------------------------------------*/
+int S3CacheIODriver::getShard (const char* name)
+{
+    /* FNV-1a Hash */
+    uint32_t hash = 2166136261U;
+    for(const char* c = name; *c != '\0'; c++)
+    {
+        hash ^= (uint8_t)*c;
+        hash *= 16777619U;
+    }
+    return hash % NUM_CACHE_SHARDS;
+}
+
+/*----------------------------------------------------------------------------
+ * allocateSlot
+ *
+ *  must be called with no shard locked; returns the slot pinned by the
+ *  caller, or -1 if every slot is in use.  The clock hand sweeps the slots,
+ *  clearing reference bits, until it finds an unpinned block that was not
+ *  read since the last pass.  The block is pinned before its shard is locked
+ *  to unpublish it; if a reader pinned it in the meantime the block is left
+ *  cached and the sweep continues.
+ *----------------------------------------------------------------------------*/
+long S3CacheIODriver::allocateSlot (void)
+{
+    while(true)
+    {
+        long slot = -1;
+
+        slotMut.lock();
+        {
+            int num_free = freeSlots.length();
+            if(num_free > 0)
+            {
+                /* Use Free Slot */
+                slot = freeSlots[num_free - 1];
+                freeSlots.remove(num_free - 1);
+                cacheSlots[slot].pins = 1;
+                slotMut.unlock();
+                return slot;
+            }
+
+            /* Sweep Clock - two passes clear every reference bit */
+            for(long i = 0; i < (2 * cacheNumSlots); i++)
             {
-                /* Delete File in Local File System */
-                SafeString oldest_filename("%s", oldest_key);
-                oldest_filename.replace(PATH_DELIMETER_STR, "#");
-                SafeString oldest_filepath("%s%c%s", cacheRoot, PATH_DELIMETER, oldest_filename.str());
-                remove(oldest_filepath.str());
-                cacheFiles.remove(index);
+                long candidate = clockHand;
+                clockHand = (clockHand + 1) % cacheNumSlots;
+
+                cache_slot_t& cache_slot = cacheSlots[candidate];
+                if(cache_slot.name == NULL || cache_slot.pins > 0) continue;
+                if(cache_slot.referenced.exchange(false)) continue;
+
+                slot = candidate;
+                cache_slot.pins++;
+                break;
             }
         }
+        slotMut.unlock();
 
-        /* Add New File to Cache */
-        cacheIndex++;
-        cacheLookUp.add(key, cacheIndex);
-        const char* cache_key = StringLib::duplicate(key);
-        cacheFiles.add(cacheIndex, cache_key);
+        /* No Room */
+        if(slot < 0) return -1;
+
+        /* Evict Block - name cannot change while the slot is pinned */
+        bool evicted = false;
+        cache_shard_t& shard = cacheShards[getShard(cacheSlots[slot].name)];
+        shard.mut.lock();
+        {
+            slotMut.lock();
+            {
+                cache_slot_t& cache_slot = cacheSlots[slot];
+                if(cache_slot.pins == 1)
+                {
+                    shard.lookUp.remove(cache_slot.name);
+                    delete [] cache_slot.name;
+                    cache_slot.name = NULL;
+                    cache_slot.size = 0;
+                    cache_slot.referenced = false;
+                    evicted = true;
+                }
+                else
+                {
+                    cache_slot.pins--; // a reader is using it again
+                }
+            }
+            slotMut.unlock();
+        }
+        shard.mut.unlock();
+
+        if(evicted) return slot;
     }
-    cacheMut.unlock();
+}
+
+/*----------------------------------------------------------------------------
+ * releaseSlot
+ *
+ *  must be called with slotMut locked
+ *----------------------------------------------------------------------------*/
+void S3CacheIODriver::releaseSlot (long slot)
+{
+    cache_slot_t& cache_slot = cacheSlots[slot];
+    delete [] cache_slot.name;
+    cache_slot.name = NULL;
+    cache_slot.size = 0;
+    freeSlots.add(slot);
+}
 
-    /* Return Success */
-    *file = cache_filepath.str(true);
-    return true;
+/*----------------------------------------------------------------------------
+ * writeIndexEntry
+ *
+ *  slot must be pinned by the caller
+ *----------------------------------------------------------------------------*/
+void S3CacheIODriver::writeIndexEntry (long slot, bool valid)
+{
+    index_entry_t entry;
+    memset(&entry, 0, sizeof(entry));
+    if(valid)
+    {
+        const cache_slot_t& cache_slot = cacheSlots[slot];
+        entry.size = cache_slot.size;
+        entry.sequence = cache_slot.sequence;
+        StringLib::copy(entry.name, cache_slot.name, MAX_BLOCK_NAME_SIZE);
+    }
+
+    off_t offset = sizeof(index_header_t) + (slot * sizeof(index_entry_t));
+    if(pwrite(cacheIndexFd, &entry, sizeof(entry), offset) != (ssize_t)sizeof(entry))
+    {
+        mlog(CRITICAL, "Failed to write S3 cache index entry %ld: %s", slot, strerror(errno));
+    }
+}
+
+/*----------------------------------------------------------------------------
+ * closeCache
+ *
+ *  must be called with cacheMut locked
+ *----------------------------------------------------------------------------*/
+void S3CacheIODriver::closeCache (void)
+{
+    if(cacheIndexFd >= 0) (void)fsync(cacheIndexFd);
+    if(cacheDataFd >= 0) (void)fsync(cacheDataFd);
+    if(cacheIndexFd >= 0) close(cacheIndexFd);
+    if(cacheDataFd >= 0) close(cacheDataFd);
+    cacheIndexFd = -1;
+    cacheDataFd = -1;
+
+    if(cacheSlots)
+    {
+        for(long slot = 0; slot < cacheNumSlots; slot++)
+        {
+            delete [] cacheSlots[slot].name;
+        }
+        delete [] cacheSlots;
+    }
+    cacheSlots = NULL;
+    cacheNumSlots = 0;
+
+    for(int i = 0; i < NUM_CACHE_SHARDS; i++)
+    {
+        cache_shard_t& shard = cacheShards[i];
+        shard.mut.lock();
+        {
+            shard.lookUp.clear();
+        }
+        shard.mut.unlock();
+    }
+
+    slotMut.lock();
+    {
+        slotIndex = 0;
+        clockHand = 0;
+        freeSlots.clear();
+    }
+    slotMut.unlock();
 }
@@ -39,10 +39,12 @@
 #include "OsApi.h"
 #include "Asset.h"
 #include "LuaEngine.h"
-#include "Ordering.h"
 #include "Dictionary.h"
+#include "List.h"
 #include "S3CurlIODriver.h"
 
+#include <atomic>
+
 /******************************************************************************
  * S3 CACHE IO DRIVER CLASS
  ******************************************************************************/
@@ -58,42 +60,118 @@ class S3CacheIODriver: public S3CurlIODriver
         static const char* FORMAT;
 
         static const char* DEFAULT_CACHE_ROOT;
-        static const int DEFAULT_MAX_CACHE_FILES = 16;
+        static const int64_t DEFAULT_MAX_CACHE_SIZE = 0x400000000L; // 16GB
+        static const int64_t DEFAULT_CACHE_BLOCK_SIZE = 0x100000L; // 1MB
+        static const int64_t MIN_CACHE_BLOCK_SIZE = 0x1000L; // 4KB
+        static const int MAX_FILL_BLOCKS = 64; // blocks downloaded per request
+        static const int MAX_BLOCK_NAME_SIZE = MAX_STR_SIZE;
+        static const int NUM_CACHE_SHARDS = 16; // independently locked partitions of the block names
+
+        static const char* CACHE_INDEX_FILE;
+        static const char* CACHE_DATA_FILE;
+        static const uint32_t CACHE_INDEX_MAGIC = 0x53334243; // "S3BC"
+        static const uint32_t CACHE_INDEX_VERSION = 2;
 
         /*--------------------------------------------------------------------
          * Methods
          *--------------------------------------------------------------------*/
 
         static void         init            (void);
+        static void         deinit          (void);
         static IODriver*    create          (const Asset* _asset, const char* resource);
         static int          luaCreateCache  (lua_State* L);
-        static int          createCache     (const char* cache_root=DEFAULT_CACHE_ROOT, int max_files=DEFAULT_MAX_CACHE_FILES);
-        int64_t             ioRead          (uint8_t* data, int64_t size, uint64_t pos);
+        static long         createCache     (const char* cache_root=DEFAULT_CACHE_ROOT, int64_t max_size=DEFAULT_MAX_CACHE_SIZE, int64_t block_size=DEFAULT_CACHE_BLOCK_SIZE);
+        int64_t             ioRead          (uint8_t* data, int64_t size, uint64_t pos) override;
 
     private:
 
         /*--------------------------------------------------------------------
-         * Methods
+         * Types
          *--------------------------------------------------------------------*/
 
-                S3CacheIODriver     (const Asset* _asset, const char* resource);
-                ~S3CacheIODriver    (void);
+        /* Persisted at the start of the index file */
+        typedef struct {
+            uint32_t    magic;
+            uint32_t    version;
+            int64_t     block_size;
+            int64_t     num_slots;
+        } index_header_t;
+
+        /* Persisted for each slot in the index file */
+        typedef struct {
+            int64_t     size;       // valid bytes in block, 0 if slot is free
+            okey_t      sequence;   // order in which block was filled
+            char        name[MAX_BLOCK_NAME_SIZE];
+        } index_entry_t;
+
+        /* In-memory state of each slot in the data file */
+        typedef struct {
+            char*               name;       // NULL if slot is free
+            okey_t              sequence;   // order in which block was filled
+            int64_t             size;
+            std::atomic<int>    pins;       // readers and writers currently using the slot
+            std::atomic<bool>   referenced; // read since the clock hand last passed
+        } cache_slot_t;
+
+        /* Download of a block that other readers can wait on */
+        struct cache_fill_t {
+            Cond        cond;
+            bool        complete;
+            int         refs;       // owner plus waiters
+            cache_fill_t(void): complete(false), refs(1) {}
+        };
+
+        /* Names and downloads of the blocks that hash to a shard; slots are
+         * allocated from the whole cache so any block can use any slot */
+        struct cache_shard_t {
+            Mutex                       mut;
+            Dictionary<long>            lookUp;
+            Dictionary<cache_fill_t*>   inFlight;
+        };
+
+        typedef enum {
+            BLOCK_CACHED,
+            BLOCK_IN_FLIGHT,
+            BLOCK_CLAIMED
+        } claim_t;
 
-        bool    fileGet             (const char* bucket, const char* key, const char** file);
+        /*--------------------------------------------------------------------
+         * Methods
+         *--------------------------------------------------------------------*/
+
+                        S3CacheIODriver     (const Asset* _asset, const char* resource);
+                        ~S3CacheIODriver    (void);
+
+        int64_t         readBlock           (uint64_t block, uint8_t* data, int64_t size, int64_t offset);
+        int64_t         fillBlocks          (uint64_t block, int num_blocks, uint8_t* data, int64_t size, int64_t offset);
+        void            storeBlocks         (uint64_t block, int num_blocks, const uint8_t* data, int64_t size);
+        claim_t         claimBlock          (uint64_t block, cache_fill_t** fill);
+        void            releaseBlock        (uint64_t block);
+        void            waitBlock           (uint64_t block, cache_fill_t* fill);
+        static int      getShard            (const char* name);
+        static long     allocateSlot        (void);
+        static void     releaseSlot         (long slot);
+        static void     writeIndexEntry     (long slot, bool valid);
+        static void     closeCache          (void);
 
         /*--------------------------------------------------------------------
          * Data
          *--------------------------------------------------------------------*/
 
-        static const char*                              cacheRoot;
-        static int                                      cacheMaxSize;
-        static Mutex                                    cacheMut;
-        static okey_t                                   cacheIndex;
-        static Dictionary<okey_t>                       cacheLookUp;
-        static MgOrdering<const char*, okey_t, true>    cacheFiles;
-
-        const Asset*    asset;
-        fileptr_t       ioFile;
+        static const char*              cacheRoot;
+        static int64_t                  cacheBlockSize;
+        static long                     cacheNumSlots;
+        static int                      cacheDataFd;
+        static int                      cacheIndexFd;
+        static Mutex                    cacheMut;
+        static cache_slot_t*            cacheSlots;
+        static cache_shard_t            cacheShards[NUM_CACHE_SHARDS];
+        static Mutex                    slotMut; // slot names, free list, and clock hand; taken after a shard's mutex
+        static okey_t                   slotIndex;
+        static long                     clockHand;
+        static List<long>               freeSlots;
+
+        char*           ioObject;   // <bucket>/<key>, prefix of every block name
 };
 
 #endif  /* __s3_cache_io_driver__ */
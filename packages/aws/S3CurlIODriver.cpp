@@ -41,6 +41,9 @@
 #include <openssl/hmac.h>
 #include <openssl/sha.h>
 #include <openssl/evp.h>
+#include <algorithm>
+#include <stdlib.h>
+#include <strings.h>
 
 
 /******************************************************************************
@@ -130,6 +133,28 @@ static size_t curlWriteFile(void *buffer, size_t size, size_t nmemb, void *userp
     return bytes_written;
 }
 
+/*----------------------------------------------------------------------------
+ * curlHeaderSize - parses object size from "Content-Range: bytes <first>-<last>/<size>"
+ *----------------------------------------------------------------------------*/
+static size_t curlHeaderSize(char* buffer, size_t size, size_t nitems, void *userp)
+{
+    int64_t* object_size = (int64_t*)userp;
+    size_t header_size = size * nitems;
+
+    char header[MAX_STR_SIZE];
+    size_t header_len = MIN(header_size, (size_t)MAX_STR_SIZE - 1);
+    memcpy(header, buffer, header_len);
+    header[header_len] = '\0';
+
+    if(strncasecmp(header, "content-range:", 14) == 0)
+    {
+        const char* total = strchr(header, '/');
+        if(total && total[1] != '*') *object_size = strtoll(&total[1], NULL, 10);
+    }
+
+    return header_size;
+}
+
 /*----------------------------------------------------------------------------
  * curlReadFile
  *----------------------------------------------------------------------------*/
@@ -147,7 +172,7 @@ static size_t curlReadFile(void* buffer, size_t size, size_t nmemb, void *userp)
 /*----------------------------------------------------------------------------
  * buildReadHeadersV2
  *----------------------------------------------------------------------------*/
-static headers_t buildReadHeadersV2 (const char* bucket, const char* key, CredentialStore::Credential* credentials)
+static headers_t buildReadHeadersV2 (const char* bucket, const char* key, const CredentialStore::Credential* credentials)
 {
     /* Initial HTTP Header List */
     struct curl_slist* headers = NULL;
@@ -182,7 +207,7 @@ static headers_t buildReadHeadersV2 (const char* bucket, const char* key, Creden
 /*----------------------------------------------------------------------------
  * buildWriteHeadersV2
  *----------------------------------------------------------------------------*/
-static headers_t buildWriteHeadersV2 (const char* bucket, const char* key, const char* region, CredentialStore::Credential* credentials, long content_length)
+static headers_t buildWriteHeadersV2 (const char* bucket, const char* key, const char* region, const CredentialStore::Credential* credentials, long content_length)
 {
     (void)region;
 
@@ -236,7 +261,7 @@ static headers_t buildWriteHeadersV2 (const char* bucket, const char* key, const
  * when using temporary credentials
  *----------------------------------------------------------------------------*/
 #if 0
-static headers_t buildWriteHeadersV4 (const char* bucket, const char* key, const char* region, CredentialStore::Credential* credentials, long content_length)
+static headers_t buildWriteHeadersV4 (const char* bucket, const char* key, const char* region, const CredentialStore::Credential* credentials, long content_length)
 {
     /* Must Supply Credentials */
     if(!credentials || !credentials->provided)
@@ -370,6 +395,90 @@ static CURL* initializeWriteRequest (SafeString& url, headers_t headers, write_c
     return curl;
 }
 
+/*----------------------------------------------------------------------------
+ * performHedgedRequest
+ *
+ *  runs the primary request and, if it has not returned any data after
+ *  hedge_delay_ms, a duplicate hedge request; the first request to succeed
+ *  is returned in winner (or the last to fail if neither succeeds); the
+ *  hedge's handle and buffer are only created once the hedge is launched,
+ *  and the handle is returned in hedge for the caller to clean up
+ *----------------------------------------------------------------------------*/
+static CURLcode performHedgedRequest (CURL* curl, fixed_data_t* info, SafeString& url, headers_t headers, fixed_data_t* hedge_info, long hedge_delay_ms, CURL** hedge, CURL** winner)
+{
+    CURLcode result = CURLE_FAILED_INIT;
+    *winner = curl;
+    *hedge = NULL;
+
+    /* Initialize Multi Handle */
+    CURLM* multi = curl_multi_init();
+    if(!multi)
+    {
+        mlog(CRITICAL, "Failed to initialize cURL multi request");
+        return result;
+    }
+    curl_multi_add_handle(multi, curl);
+
+    /* Run Transfers */
+    int64_t start = OsApi::time(OsApi::CPU_CLK);
+    int active = 1;
+    bool hedged = false;
+    bool complete = false;
+    while(!complete)
+    {
+        int running = 0;
+        curl_multi_perform(multi, &running);
+
+        /* Check Completed Transfers */
+        int msgs_left = 0;
+        CURLMsg* msg = NULL;
+        while(!complete && (msg = curl_multi_info_read(multi, &msgs_left)) != NULL)
+        {
+            if(msg->msg == CURLMSG_DONE)
+            {
+                long http_code = 0;
+                curl_easy_getinfo(msg->easy_handle, CURLINFO_RESPONSE_CODE, &http_code);
+                result = msg->data.result;
+                active--;
+                if(((result == CURLE_OK) && (http_code < 300)) || (active == 0))
+                {
+                    *winner = msg->easy_handle;
+                    complete = true;
+                }
+            }
+        }
+
+        if(!complete)
+        {
+            /* Launch Hedge if Primary Has Not Answered */
+            int64_t elapsed_ms = (OsApi::time(OsApi::CPU_CLK) - start) / 1000;
+            if(!hedged && (info->index == 0) && (elapsed_ms >= hedge_delay_ms))
+            {
+                hedged = true;
+                hedge_info->index = 0;
+                *hedge = initializeReadRequest(url, headers, curlWriteFixed, hedge_info);
+                if(*hedge)
+                {
+                    if(!hedge_info->buffer) hedge_info->buffer = new uint8_t [hedge_info->size];
+                    curl_multi_add_handle(multi, *hedge);
+                    active++;
+                }
+            }
+
+            /* Wait for Activity */
+            int wait_ms = hedged ? 100 : (int)MAX(MIN(hedge_delay_ms - elapsed_ms, 100), 1);
+            curl_multi_wait(multi, NULL, 0, wait_ms, NULL);
+        }
+    }
+
+    /* Clean Up Multi Handle */
+    curl_multi_remove_handle(multi, curl);
+    if(*hedge) curl_multi_remove_handle(multi, *hedge);
+    curl_multi_cleanup(multi);
+
+    return result;
+}
+
 /******************************************************************************
  * STATIC DATA
  ******************************************************************************/
@@ -378,6 +487,15 @@ const char* S3CurlIODriver::DEFAULT_REGION = "us-west-2";
 const char* S3CurlIODriver::DEFAULT_IDENTITY = "iam-role";
 const char* S3CurlIODriver::FORMAT = "s3";
 
+Mutex   S3CurlIODriver::latencyMut;
+int64_t S3CurlIODriver::latencySamples[LATENCY_WINDOW];
+long    S3CurlIODriver::latencyCount = 0;
+long    S3CurlIODriver::latencyThreshold = 0;
+bool    S3CurlIODriver::hedgeEnabled = false;
+long    S3CurlIODriver::hedgeMinDelay = DEFAULT_HEDGE_MIN_DELAY_MS;
+Mutex   S3CurlIODriver::endpointMut;
+char    S3CurlIODriver::endpointUrl[MAX_STR_SIZE] = {'\0'};
+
 /******************************************************************************
  * AWS S3 cURL I/O DRIVER CLASS
  ******************************************************************************/
@@ -395,13 +513,13 @@ Asset::IODriver* S3CurlIODriver::create (const Asset* _asset, const char* resour
  *----------------------------------------------------------------------------*/
 int64_t S3CurlIODriver::ioRead (uint8_t* data, int64_t size, uint64_t pos)
 {
-    return get(data, size, pos, ioBucket, ioKey, asset->getRegion(), &latestCredentials);
+    return get(data, size, pos, ioBucket, ioKey, asset->getRegion(), latestCredentials.get());
 }
 
 /*----------------------------------------------------------------------------
  * get - fixed
  *----------------------------------------------------------------------------*/
-int64_t S3CurlIODriver::get (uint8_t* data, int64_t size, uint64_t pos, const char* bucket, const char* key, const char* region, CredentialStore::Credential* credentials)
+int64_t S3CurlIODriver::get (uint8_t* data, int64_t size, uint64_t pos, const char* bucket, const char* key, const char* region, const CredentialStore::Credential* credentials)
 {
     bool status = false;
 
@@ -410,7 +528,7 @@ int64_t S3CurlIODriver::get (uint8_t* data, int64_t size, uint64_t pos, const ch
     if(key_ptr[0] == '/') key_ptr++;
 
     /* Build URL */
-    SafeString url("https://s3.%s.amazonaws.com/%s/%s", region, bucket, key_ptr);
+    SafeString url = buildUrl(bucket, key_ptr, region);
 
     /* Setup Buffer for Callback */
     fixed_data_t info = {
@@ -419,8 +537,18 @@ int64_t S3CurlIODriver::get (uint8_t* data, int64_t size, uint64_t pos, const ch
         .index = 0
     };
 
+    /* Setup Buffer for Hedged Requests (allocated if a hedge is launched) */
+    long hedge_delay_ms = getHedgeDelay();
+    fixed_data_t hedge_info = {
+        .buffer = NULL,
+        .size = size,
+        .index = 0
+    };
+
     /* Issue Get Request */
     int attempts = ATTEMPTS_PER_REQUEST;
+    int retries = 0;
+    int throttle_retries = 0;
     bool rqst_complete = false;
     while(!rqst_complete && (attempts > 0))
     {
@@ -440,16 +568,44 @@ int64_t S3CurlIODriver::get (uint8_t* data, int64_t size, uint64_t pos, const ch
             while(!rqst_complete && (attempts-- > 0))
             {
                 /* Perform Request */
-                CURLcode res = curl_easy_perform(curl);
+                CURL* hedge = NULL;
+                CURL* winner = curl;
+                CURLcode res;
+                if(hedge_delay_ms >= 0)
+                {
+                    res = performHedgedRequest(curl, &info, url, headers, &hedge_info, hedge_delay_ms, &hedge, &winner);
+                    if(hedge && (winner == hedge))
+                    {
+                        memcpy(info.buffer, hedge_info.buffer, hedge_info.index);
+                        info.index = hedge_info.index;
+                    }
+                }
+                else
+                {
+                    res = curl_easy_perform(curl);
+                }
+
                 if(res == CURLE_OK)
                 {
                     /* Get HTTP Code */
                     long http_code = 0;
-                    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
+                    curl_easy_getinfo(winner, CURLINFO_RESPONSE_CODE, &http_code);
                     if(http_code < 300)
                     {
                         /* Request Succeeded */
+                        double ttfb = 0.0;
+                        curl_easy_getinfo(winner, CURLINFO_STARTTRANSFER_TIME, &ttfb);
+                        recordLatency((int64_t)(ttfb * 1000000.0));
                         status = true;
+                        rqst_complete = true;
+                    }
+                    else if((http_code == 503) && (throttle_retries < MAX_THROTTLE_RETRIES))
+                    {
+                        /* Request Throttled - does not count against attempts */
+                        mlog(WARNING, "S3 get throttled <%ld>, retrying request: %s", http_code, key_ptr);
+                        info.index = 0;
+                        attempts++;
+                        backoff(throttle_retries++);
                     }
                     else
                     {
@@ -457,10 +613,8 @@ int64_t S3CurlIODriver::get (uint8_t* data, int64_t size, uint64_t pos, const ch
                         StringLib::printify((char*)info.buffer, info.index);
                         mlog(INFO, "%s", info.buffer);
                         mlog(CRITICAL, "S3 get returned http error <%ld>", http_code);
+                        rqst_complete = true;
                     }
-
-                    /* Get Request Completed */
-                    rqst_complete = true;
                 }
                 else if(info.index > 0)
                 {
@@ -474,8 +628,11 @@ int64_t S3CurlIODriver::get (uint8_t* data, int64_t size, uint64_t pos, const ch
                 else
                 {
                     mlog(CRITICAL, "cURL call failed (%d) for request: %s", res, key_ptr);
-                    OsApi::performIOTimeout();
+                    backoff(retries++);
                 }
+
+                /* Clean Up Hedge Request */
+                if(hedge) curl_easy_cleanup(hedge);
             }
 
             /* Clean Up cURL */
@@ -491,20 +648,23 @@ int64_t S3CurlIODriver::get (uint8_t* data, int64_t size, uint64_t pos, const ch
         curl_slist_free_all(headers);
     }
 
+    /* Clean Up Hedge Buffer */
+    delete [] hedge_info.buffer;
+
     /* Throw Exception on Failure */
     if(!status)
     {
         throw RunTimeException(CRITICAL, RTE_ERROR, "cURL fixed request to S3 failed");
     }
 
-    /* Return Success */
-    return size;
+    /* Return Success - may be short if range extends past end of object */
+    return info.index;
 }
 
 /*----------------------------------------------------------------------------
  * get - streaming
  *----------------------------------------------------------------------------*/
-int64_t S3CurlIODriver::get (uint8_t** data, const char* bucket, const char* key, const char* region, CredentialStore::Credential* credentials)
+int64_t S3CurlIODriver::get (uint8_t** data, const char* bucket, const char* key, const char* region, const CredentialStore::Credential* credentials)
 {
     /* Initialize Function Parameters */
     bool status = false;
@@ -522,7 +682,7 @@ int64_t S3CurlIODriver::get (uint8_t** data, const char* bucket, const char* key
     List<streaming_data_t> rsps_set;
 
     /* Build URL */
-    SafeString url("https://s3.%s.amazonaws.com/%s/%s", region, bucket, key_ptr);
+    SafeString url = buildUrl(bucket, key_ptr, region);
 
     /* Initialize cURL Request */
     bool rqst_complete = false;
@@ -616,7 +776,7 @@ int64_t S3CurlIODriver::get (uint8_t** data, const char* bucket, const char* key
 /*----------------------------------------------------------------------------
  * get - file
  *----------------------------------------------------------------------------*/
-int64_t S3CurlIODriver::get (const char* filename, const char* bucket, const char* key, const char* region, CredentialStore::Credential* credentials)
+int64_t S3CurlIODriver::get (const char* filename, const char* bucket, const char* key, const char* region, const CredentialStore::Credential* credentials)
 {
     bool status = false;
 
@@ -634,7 +794,7 @@ int64_t S3CurlIODriver::get (const char* filename, const char* bucket, const cha
     if(data.fd)
     {
         /* Build URL */
-        SafeString url("https://s3.%s.amazonaws.com/%s/%s", region, bucket, key_ptr);
+        SafeString url = buildUrl(bucket, key_ptr, region);
 
         /* Initialize cURL Request */
         bool rqst_complete = false;
@@ -706,10 +866,86 @@ int64_t S3CurlIODriver::get (const char* filename, const char* bucket, const cha
     return data.size;
 }
 
+/*----------------------------------------------------------------------------
+ * size - object size from the content range of a one byte read
+ *----------------------------------------------------------------------------*/
+int64_t S3CurlIODriver::size (const char* bucket, const char* key, const char* region, const CredentialStore::Credential* credentials)
+{
+    int64_t object_size = -1;
+
+    /* Massage Key */
+    const char* key_ptr = key;
+    if(key_ptr[0] == '/') key_ptr++;
+
+    /* Build URL */
+    SafeString url = buildUrl(bucket, key_ptr, region);
+
+    /* Build Headers */
+    struct curl_slist* headers = buildReadHeadersV2(bucket, key_ptr, credentials);
+    headers = curl_slist_append(headers, "Range: bytes=0-0");
+
+    /* Setup Buffer for Callback */
+    uint8_t first_byte;
+    fixed_data_t info = {
+        .buffer = &first_byte,
+        .size = 1,
+        .index = 0
+    };
+
+    /* Initialize cURL Request */
+    bool rqst_complete = false;
+    int attempts = ATTEMPTS_PER_REQUEST;
+    CURL* curl = initializeReadRequest(url, headers, curlWriteFixed, &info);
+    if(curl)
+    {
+        curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, curlHeaderSize);
+        curl_easy_setopt(curl, CURLOPT_HEADERDATA, &object_size);
+        while(!rqst_complete && (attempts-- > 0))
+        {
+            /* Perform Request */
+            CURLcode res = curl_easy_perform(curl);
+            if(res == CURLE_OK)
+            {
+                /* Get HTTP Code */
+                long http_code = 0;
+                curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
+                if(http_code >= 300)
+                {
+                    mlog(CRITICAL, "S3 get returned http error <%ld>", http_code);
+                    object_size = -1;
+                }
+
+                /* Request Completed */
+                rqst_complete = true;
+            }
+            else
+            {
+                mlog(CRITICAL, "cURL call failed (%d) for request: %s", res, key_ptr);
+                info.index = 0;
+                backoff(ATTEMPTS_PER_REQUEST - attempts - 1);
+            }
+        }
+
+        /* Clean Up cURL */
+        curl_easy_cleanup(curl);
+    }
+
+    /* Clean Up Headers */
+    curl_slist_free_all(headers);
+
+    /* Throw Exception on Failure */
+    if(object_size < 0)
+    {
+        throw RunTimeException(CRITICAL, RTE_ERROR, "failed to get size of S3 object %s/%s", bucket, key_ptr);
+    }
+
+    return object_size;
+}
+
 /*----------------------------------------------------------------------------
  * put - file
  *----------------------------------------------------------------------------*/
-int64_t S3CurlIODriver::put (const char* filename, const char* bucket, const char* key, const char* region, CredentialStore::Credential* credentials)
+int64_t S3CurlIODriver::put (const char* filename, const char* bucket, const char* key, const char* region, const CredentialStore::Credential* credentials)
 {
     bool status = false;
 
@@ -732,7 +968,7 @@ int64_t S3CurlIODriver::put (const char* filename, const char* bucket, const cha
         struct curl_slist* headers = buildWriteHeadersV2(bucket, key_ptr, region, credentials, content_length);
 
         /* Build URL */
-        SafeString url("https://s3.%s.amazonaws.com/%s/%s", region, bucket, key_ptr);
+        SafeString url = buildUrl(bucket, key_ptr, region);
 
         /* Initialize cURL Request */
         bool rqst_complete = false;
@@ -821,11 +1057,11 @@ int S3CurlIODriver::luaGet(lua_State* L)
         const char* identity    = LuaObject::getLuaString(L, 4, true, S3CurlIODriver::DEFAULT_IDENTITY);
 
         /* Get Credentials */
-        CredentialStore::Credential credentials = CredentialStore::get(identity);
+        CredentialStore::Handle credentials = CredentialStore::acquire(identity);
 
         /* Make Request */
         uint8_t* rsps_data = NULL;
-        int64_t rsps_size = get(&rsps_data, bucket, key, region, &credentials);
+        int64_t rsps_size = get(&rsps_data, bucket, key, region, credentials.get());
 
         /* Push Contents */
         if(rsps_data)
@@ -867,10 +1103,10 @@ int S3CurlIODriver::luaDownload(lua_State* L)
         const char* filename    = LuaObject::getLuaString(L, 5, true, key);
 
         /* Get Credentials */
-        CredentialStore::Credential credentials = CredentialStore::get(identity);
+        CredentialStore::Handle credentials = CredentialStore::acquire(identity);
 
         /* Make Request */
-        int64_t rsps_size = get(filename, bucket, key, region, &credentials);
+        int64_t rsps_size = get(filename, bucket, key, region, credentials.get());
 
         /* Push Contents */
         if(rsps_size > 0)   status = true;
@@ -909,11 +1145,11 @@ int S3CurlIODriver::luaRead(lua_State* L)
         else if(pos < 0) throw RunTimeException(CRITICAL, RTE_ERROR, "Invalid position: %ld", pos);
 
         /* Get Credentials */
-        CredentialStore::Credential credentials = CredentialStore::get(identity);
+        CredentialStore::Handle credentials = CredentialStore::acquire(identity);
 
         /* Make Request */
         uint8_t* rsps_data = new uint8_t [size];
-        int64_t rsps_size = get(rsps_data, size, pos, bucket, key, region, &credentials);
+        int64_t rsps_size = get(rsps_data, size, pos, bucket, key, region, credentials.get());
 
         /* Push Contents */
         if(rsps_size > 0)
@@ -955,10 +1191,10 @@ int S3CurlIODriver::luaUpload(lua_State* L)
         const char* identity    = LuaObject::getLuaString(L, 5, true, S3CurlIODriver::DEFAULT_IDENTITY);
 
         /* Get Credentials */
-        CredentialStore::Credential credentials = CredentialStore::get(identity);
+        CredentialStore::Handle credentials = CredentialStore::acquire(identity);
 
         /* Make Request */
-        int64_t upload_size = put(filename, bucket, key, region, &credentials);
+        int64_t upload_size = put(filename, bucket, key, region, credentials.get());
 
         /* Push Contents */
         if(upload_size > 0)
@@ -981,6 +1217,194 @@ int S3CurlIODriver::luaUpload(lua_State* L)
     return 1;
 }
 
+/*----------------------------------------------------------------------------
+ * luaHedge - s3hedge(<enable>, [<min_delay_ms>])
+ *----------------------------------------------------------------------------*/
+int S3CurlIODriver::luaHedge(lua_State* L)
+{
+    bool status = false;
+
+    try
+    {
+        /* Get Parameters */
+        bool enable             = LuaObject::getLuaBoolean(L, 1);
+        long min_delay_ms       = LuaObject::getLuaInteger(L, 2, true, DEFAULT_HEDGE_MIN_DELAY_MS);
+
+        /* Check Parameters */
+        if(min_delay_ms < 0) throw RunTimeException(CRITICAL, RTE_ERROR, "Invalid hedge delay: %ld", min_delay_ms);
+
+        /* Configure Hedging */
+        configureHedging(enable, min_delay_ms);
+        status = true;
+    }
+    catch(const RunTimeException& e)
+    {
+        mlog(e.level(), "Error configuring S3 hedged requests: %s", e.what());
+    }
+
+    /* Return Results */
+    lua_pushboolean(L, status);
+    return 1;
+}
+
+/*----------------------------------------------------------------------------
+ * luaEndpoint - s3endpoint([<url>])
+ *
+ *  redirects all S3 requests to the supplied endpoint (e.g. http://127.0.0.1:9000);
+ *  calling without a url restores the AWS endpoint
+ *----------------------------------------------------------------------------*/
+int S3CurlIODriver::luaEndpoint(lua_State* L)
+{
+    bool status = false;
+
+    try
+    {
+        /* Get Parameters */
+        const char* endpoint = LuaObject::getLuaString(L, 1, true, NULL);
+
+        /* Check Parameters */
+        if(endpoint && StringLib::find(endpoint, "://") == NULL)
+        {
+            throw RunTimeException(CRITICAL, RTE_ERROR, "Invalid endpoint, must include scheme: %s", endpoint);
+        }
+
+        /* Set Endpoint */
+        setEndpoint(endpoint);
+        status = true;
+    }
+    catch(const RunTimeException& e)
+    {
+        mlog(e.level(), "Error setting S3 endpoint: %s", e.what());
+    }
+
+    /* Return Results */
+    lua_pushboolean(L, status);
+    return 1;
+}
+
+/*----------------------------------------------------------------------------
+ * configureHedging
+ *
+ *  when enabled, a range request that has not answered within the running
+ *  95th percentile time to first byte (but no sooner than min_delay_ms) is
+ *  duplicated and whichever request finishes first is used
+ *----------------------------------------------------------------------------*/
+void S3CurlIODriver::configureHedging (bool enable, long min_delay_ms)
+{
+    latencyMut.lock();
+    {
+        hedgeEnabled = enable;
+        hedgeMinDelay = min_delay_ms;
+        latencyCount = 0;
+        latencyThreshold = 0;
+    }
+    latencyMut.unlock();
+}
+
+/*----------------------------------------------------------------------------
+ * setEndpoint
+ *
+ *  NULL or empty endpoint restores the AWS endpoint
+ *----------------------------------------------------------------------------*/
+void S3CurlIODriver::setEndpoint (const char* endpoint)
+{
+    endpointMut.lock();
+    {
+        if(endpoint)
+        {
+            StringLib::copy(endpointUrl, endpoint, MAX_STR_SIZE);
+
+            /* Remove Trailing Slashes */
+            int len = StringLib::size(endpointUrl);
+            while(len > 0 && endpointUrl[len - 1] == '/')
+            {
+                endpointUrl[--len] = '\0';
+            }
+        }
+        else
+        {
+            endpointUrl[0] = '\0';
+        }
+    }
+    endpointMut.unlock();
+}
+
+/*----------------------------------------------------------------------------
+ * buildUrl
+ *
+ *  uses path style addressing when an endpoint (e.g. a local stand-in) is set
+ *----------------------------------------------------------------------------*/
+SafeString S3CurlIODriver::buildUrl (const char* bucket, const char* key, const char* region)
+{
+    SafeString url;
+    endpointMut.lock();
+    {
+        if(endpointUrl[0] != '\0') url = SafeString("%s/%s/%s", endpointUrl, bucket, key);
+        else                        url = SafeString("https://s3.%s.amazonaws.com/%s/%s", region, bucket, key);
+    }
+    endpointMut.unlock();
+    return url;
+}
+
+/*----------------------------------------------------------------------------
+ * getHedgeDelay
+ *
+ *  returns -1 if requests should not be hedged
+ *----------------------------------------------------------------------------*/
+long S3CurlIODriver::getHedgeDelay (void)
+{
+    long delay_ms = -1;
+    latencyMut.lock();
+    {
+        if(hedgeEnabled && (latencyCount >= LATENCY_MIN_SAMPLES))
+        {
+            delay_ms = MAX(latencyThreshold, hedgeMinDelay);
+        }
+    }
+    latencyMut.unlock();
+    return delay_ms;
+}
+
+/*----------------------------------------------------------------------------
+ * recordLatency
+ *----------------------------------------------------------------------------*/
+void S3CurlIODriver::recordLatency (int64_t latency_us)
+{
+    latencyMut.lock();
+    {
+        /* Latency is Only Tracked for Hedging */
+        if(hedgeEnabled)
+        {
+            latencySamples[latencyCount % LATENCY_WINDOW] = latency_us;
+            latencyCount++;
+
+            /* Periodically Update Threshold */
+            if(latencyCount % LATENCY_MIN_SAMPLES == 0)
+            {
+                int num_samples = MIN(latencyCount, LATENCY_WINDOW);
+                int64_t samples[LATENCY_WINDOW];
+                memcpy(samples, latencySamples, num_samples * sizeof(int64_t));
+                int index = (num_samples * LATENCY_PERCENTILE) / 100;
+                std::nth_element(samples, samples + index, samples + num_samples);
+                latencyThreshold = samples[index] / 1000;
+            }
+        }
+    }
+    latencyMut.unlock();
+}
+
+/*----------------------------------------------------------------------------
+ * backoff
+ *
+ *  sleeps for a random time up to an exponentially increasing ceiling
+ *----------------------------------------------------------------------------*/
+void S3CurlIODriver::backoff (int retry)
+{
+    long ceiling_ms = MIN(BACKOFF_MAX_MS, BACKOFF_BASE_MS << MIN(retry, 16));
+    double delay_ms = ceiling_ms * ((double)random() / (double)RAND_MAX);
+    OsApi::sleep(delay_ms / 1000.0);
+}
+
 /*----------------------------------------------------------------------------
  * Constructor - for derived classes
  *----------------------------------------------------------------------------*/
@@ -991,7 +1415,7 @@ S3CurlIODriver::S3CurlIODriver (const Asset* _asset):
     ioKey = NULL;
 
     /* Get Latest Credentials */
-    latestCredentials = CredentialStore::get(asset->getIdentity());
+    latestCredentials = CredentialStore::acquire(asset->getIdentity());
 }
 
 /*----------------------------------------------------------------------------
@@ -1018,7 +1442,7 @@ S3CurlIODriver::S3CurlIODriver (const Asset* _asset, const char* resource):
     ioKey++;
 
     /* Get Latest Credentials */
-    latestCredentials = CredentialStore::get(asset->getIdentity());
+    latestCredentials = CredentialStore::acquire(asset->getIdentity());
 }
 
 /*----------------------------------------------------------------------------
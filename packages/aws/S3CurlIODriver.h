@@ -38,6 +38,7 @@
 
 #include "OsApi.h"
 #include "Dictionary.h"
+#include "StringLib.h"
 #include "Asset.h"
 #include "CredentialStore.h"
 
@@ -58,6 +59,13 @@ class S3CurlIODriver: public Asset::IODriver
         static const long LOW_SPEED_LIMIT = 32768; // 32 KB/s
         static const long LOW_SPEED_TIME = 5; // seconds
         static const long ATTEMPTS_PER_REQUEST = 3;
+        static const long MAX_THROTTLE_RETRIES = 5; // additional attempts for throttled (503) responses
+        static const long BACKOFF_BASE_MS = 100;
+        static const long BACKOFF_MAX_MS = 10000;
+        static const long DEFAULT_HEDGE_MIN_DELAY_MS = 50;
+        static const int LATENCY_WINDOW = 256; // number of recent requests used to estimate latency
+        static const int LATENCY_MIN_SAMPLES = 32; // requests needed before hedging starts
+        static const int LATENCY_PERCENTILE = 95;
         static const long SSL_VERIFYPEER = 0;
         static const long SSL_VERIFYHOST = 0;
         static const char* DEFAULT_REGION;
@@ -74,27 +82,36 @@ class S3CurlIODriver: public Asset::IODriver
         // fixed GET - memory preallocated
         static int64_t      get             (uint8_t* data, int64_t size, uint64_t pos,
                                              const char* bucket, const char* key, const char* region,
-                                             CredentialStore::Credential* credentials);
+                                             const CredentialStore::Credential* credentials);
 
         // streaming GET - memory allocated and returned
         static int64_t      get             (uint8_t** data,
                                              const char* bucket, const char* key, const char* region,
-                                             CredentialStore::Credential* credentials);
+                                             const CredentialStore::Credential* credentials);
 
         // file GET - data written directly to file
         static int64_t      get             (const char* filename,
                                              const char* bucket, const char* key, const char* region,
-                                             CredentialStore::Credential* credentials);
+                                             const CredentialStore::Credential* credentials);
+
+        // object size - from the content range of a one byte GET
+        static int64_t      size            (const char* bucket, const char* key, const char* region,
+                                             const CredentialStore::Credential* credentials);
 
         // file PUT - data read directly from file
         static int64_t      put             (const char* filename,
                                              const char* bucket, const char* key, const char* region,
-                                             CredentialStore::Credential* credentials);
+                                             const CredentialStore::Credential* credentials);
 
         static int          luaGet          (lua_State* L);
         static int          luaDownload     (lua_State* L);
         static int          luaRead         (lua_State* L);
         static int          luaUpload       (lua_State* L);
+        static int          luaHedge        (lua_State* L);
+        static int          luaEndpoint     (lua_State* L);
+
+        static void         configureHedging(bool enable, long min_delay_ms=DEFAULT_HEDGE_MIN_DELAY_MS);
+        static void         setEndpoint     (const char* endpoint);
 
     protected:
 
@@ -106,12 +123,26 @@ class S3CurlIODriver: public Asset::IODriver
                             S3CurlIODriver  (const Asset* _asset, const char* resource);
         virtual             ~S3CurlIODriver (void);
 
+        static long         getHedgeDelay   (void);
+        static void         recordLatency   (int64_t latency_us);
+        static void         backoff         (int retry);
+        static SafeString   buildUrl        (const char* bucket, const char* key, const char* region);
+
         /*--------------------------------------------------------------------
          * Data
          *--------------------------------------------------------------------*/
 
+        static Mutex                latencyMut;
+        static int64_t              latencySamples[LATENCY_WINDOW];
+        static long                 latencyCount;
+        static long                 latencyThreshold; // milliseconds
+        static bool                 hedgeEnabled;
+        static long                 hedgeMinDelay; // milliseconds
+        static Mutex                endpointMut;
+        static char                 endpointUrl[MAX_STR_SIZE]; // empty for AWS
+
         const Asset*                asset;
-        CredentialStore::Credential latestCredentials;
+        CredentialStore::Handle     latestCredentials;
         char*                       ioBucket;
         char*                       ioKey;
 };
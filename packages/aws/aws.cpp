@@ -59,6 +59,8 @@ int aws_open (lua_State *L)
         {"s3read",      S3CurlIODriver::luaRead},
         {"s3upload",    S3CurlIODriver::luaUpload},
         {"s3cache",     S3CacheIODriver::luaCreateCache},
+        {"s3hedge",     S3CurlIODriver::luaHedge},
+        {"s3endpoint",  S3CurlIODriver::luaEndpoint},
         {NULL,          NULL}
     };
 
@@ -77,6 +79,7 @@ void initaws (void)
 {
     /* Initialize Modules */
     CredentialStore::init();
+    S3CacheIODriver::init();
 
     /* Register I/O Drivers */
     Asset::registerDriver(S3CacheIODriver::FORMAT, S3CacheIODriver::create);
@@ -95,6 +98,7 @@ void initaws (void)
 void deinitaws (void)
 {
     /* Uninitialize Modules */
+    S3CacheIODriver::deinit();
     CredentialStore::deinit();
 }
 }
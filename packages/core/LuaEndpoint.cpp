@@ -65,6 +65,7 @@ const char* LuaEndpoint::UNREGISTERED_ENDPOINT = "untracked";
 const char* LuaEndpoint::HITS_METRIC = "hits";
 
 int32_t LuaEndpoint::totalMetricId = EventLib::INVALID_METRIC;
+std::atomic<int64_t> LuaEndpoint::reservedMemory(0);
 
 /******************************************************************************
  * AUTHENTICATOR SUBCLASS
@@ -161,6 +162,41 @@ void LuaEndpoint::generateExceptionStatus (int code, event_level_t level, Publis
     record.post(outq, 0, active);
 }
 
+/*----------------------------------------------------------------------------
+ * reserveMemory - counts memory a request is about to allocate
+ *
+ *  the memory check of new requests only sees what is already allocated, so
+ *  requests report the size of large builds (e.g. arrow row groups) before
+ *  they start them and release it once the memory is freed
+ *----------------------------------------------------------------------------*/
+void LuaEndpoint::reserveMemory (int64_t bytes)
+{
+    reservedMemory += bytes;
+}
+
+/*----------------------------------------------------------------------------
+ * releaseMemory
+ *----------------------------------------------------------------------------*/
+void LuaEndpoint::releaseMemory (int64_t bytes)
+{
+    reservedMemory -= bytes;
+}
+
+/*----------------------------------------------------------------------------
+ * memusage - fraction of system memory used and reserved by requests
+ *----------------------------------------------------------------------------*/
+double LuaEndpoint::memusage (void)
+{
+    double mem = OsApi::memusage();
+    int64_t reserved = reservedMemory.load();
+    int64_t total = OsApi::memtotal();
+    if(reserved > 0 && total > 0)
+    {
+        mem += (double)reserved / (double)total;
+    }
+    return mem;
+}
+
 /******************************************************************************
  * PROTECTED METHODS
  ******************************************************************************/
@@ -297,7 +333,7 @@ void LuaEndpoint::normalResponse (const char* scriptpath, Request* request, Publ
 
     /* Check Memory */
     if( (normalRequestMemoryThreshold >= 1.0) ||
-        ((mem = OsApi::memusage()) < normalRequestMemoryThreshold) )
+        ((mem = memusage()) < normalRequestMemoryThreshold) )
     {
         /* Launch Engine */
         engine = new LuaEngine(scriptpath, (const char*)request->body, trace_id, NULL, true);
@@ -350,7 +386,7 @@ void LuaEndpoint::streamResponse (const char* scriptpath, Request* request, Publ
 
     /* Check Memory */
     if( (streamRequestMemoryThreshold >= 1.0) ||
-        ((mem = OsApi::memusage()) < streamRequestMemoryThreshold) )
+        ((mem = memusage()) < streamRequestMemoryThreshold) )
     {
         /* Send Header */
         int header_length = buildheader(header, OK, "application/octet-stream", 0, "chunked", serverHead.str());
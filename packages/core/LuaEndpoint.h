@@ -36,6 +36,8 @@
  * INCLUDES
  ******************************************************************************/
 
+#include <atomic>
+
 #include "EndpointObject.h"
 #include "OsApi.h"
 #include "StringLib.h"
@@ -115,6 +117,9 @@ class LuaEndpoint: public EndpointObject
         static bool         init                    (void);
         static int          luaCreate               (lua_State* L);
         static void         generateExceptionStatus (int code, event_level_t level, Publisher* outq, bool* active, const char* errmsg, ...) VARG_CHECK(printf, 5, 6);
+        static void         reserveMemory           (int64_t bytes);
+        static void         releaseMemory           (int64_t bytes);
+        static double       memusage                (void);
 
     protected:
 
@@ -142,6 +147,7 @@ class LuaEndpoint: public EndpointObject
          *--------------------------------------------------------------------*/
 
         static int32_t      totalMetricId;
+        static std::atomic<int64_t> reservedMemory; // bytes running requests are about to allocate
         Dictionary<int32_t> metricIds;
         double              normalRequestMemoryThreshold;
         double              streamRequestMemoryThreshold;
@@ -41,6 +41,7 @@
 
 #define _USE_MATH_DEFINES
 #include <cmath>
+#include <cfloat>
 #include <string>
 
 #include "MathLib.h"
@@ -159,6 +160,44 @@ MathLib::point_t MathLib::coord2point (const coord_t c, proj_t projection)
     return p;
 }
 
+/*----------------------------------------------------------------------------
+ * coord2point - batch
+ *
+ *  projects n coordinates held in separate longitude and latitude arrays;
+ *  the projection is selected once for the whole batch
+ *----------------------------------------------------------------------------*/
+void MathLib::coord2point (const double* lon, const double* lat, long n, proj_t projection, point_t* points)
+{
+    if(projection == NORTH_POLAR)
+    {
+        for(long k = 0; k < n; k++)
+        {
+            double lonrad = lon[k] * M_PI / 180.0;
+            double r = 2 * tan((M_PI / 4.0) - ((lat[k] * M_PI / 180.0) / 2.0));
+            points[k].x = r * cos(lonrad);
+            points[k].y = r * sin(lonrad);
+        }
+    }
+    else if(projection == SOUTH_POLAR)
+    {
+        for(long k = 0; k < n; k++)
+        {
+            double o = -(lon[k] * M_PI / 180.0);
+            double r = -2 * tan(-(M_PI / 4.0) - ((lat[k] * M_PI / 180.0) / 2.0));
+            points[k].x = r * cos(o);
+            points[k].y = r * sin(o);
+        }
+    }
+    else if(projection == PLATE_CARREE)
+    {
+        for(long k = 0; k < n; k++)
+        {
+            points[k].x = EARTHRADIUS * (lon[k] * M_PI / 180.0);
+            points[k].y = EARTHRADIUS * (lat[k] * M_PI / 180.0);
+        }
+    }
+}
+
 /*----------------------------------------------------------------------------
  * point2coord
  *----------------------------------------------------------------------------*/
@@ -274,6 +313,94 @@ bool MathLib::inpoly (point_t* poly, int len, point_t point)
     return c == 1;
 }
 
+/*----------------------------------------------------------------------------
+ * initpoly
+ *
+ *  builds a prepared polygon from the projected vertices; the same crossing
+ *  test as inpoly is applied to every edge that can span the point, so both
+ *  return the same inclusion
+ *----------------------------------------------------------------------------*/
+void MathLib::initpoly (poly_t* prep, const point_t* poly, int len)
+{
+    /* Bounding Box */
+    prep->min_x = DBL_MAX;
+    prep->min_y = DBL_MAX;
+    prep->max_x = -DBL_MAX;
+    prep->max_y = -DBL_MAX;
+    for(int i = 0; i < len; i++)
+    {
+        if(poly[i].x < prep->min_x) prep->min_x = poly[i].x;
+        if(poly[i].y < prep->min_y) prep->min_y = poly[i].y;
+        if(poly[i].x > prep->max_x) prep->max_x = poly[i].x;
+        if(poly[i].y > prep->max_y) prep->max_y = poly[i].y;
+    }
+
+    /* Size Bands - roughly one edge per band */
+    prep->num_bands = MAX(MIN(len, MAX_POLY_BANDS), 1);
+    prep->band_scale = 0.0;
+    if(len > 0 && prep->max_y > prep->min_y)
+    {
+        prep->band_scale = prep->num_bands / (prep->max_y - prep->min_y);
+    }
+
+    /* Count Edges Per Band
+     *  horizontal edges never change the crossing count and are dropped; an
+     *  edge is placed in every band between the bands of its end points, and
+     *  since polyband is monotonic any point the edge spans looks it up */
+    prep->band_index = new int [prep->num_bands + 1];
+    for(int b = 0; b <= prep->num_bands; b++) prep->band_index[b] = 0;
+    for(int i = 0, j = len - 1; i < len; j = i++)
+    {
+        if(poly[i].y == poly[j].y) continue;
+        int b0 = polyband(prep, MIN(poly[i].y, poly[j].y));
+        int b1 = polyband(prep, MAX(poly[i].y, poly[j].y));
+        for(int b = b0; b <= b1; b++) prep->band_index[b + 1] += 2;
+    }
+    for(int b = 0; b < prep->num_bands; b++)
+    {
+        prep->band_index[b + 1] += prep->band_index[b];
+    }
+
+    /* Populate Bands */
+    prep->edges = new point_t [MAX(prep->band_index[prep->num_bands], 1)];
+    int* fill = new int [prep->num_bands];
+    for(int b = 0; b < prep->num_bands; b++) fill[b] = prep->band_index[b];
+    for(int i = 0, j = len - 1; i < len; j = i++)
+    {
+        if(poly[i].y == poly[j].y) continue;
+        int b0 = polyband(prep, MIN(poly[i].y, poly[j].y));
+        int b1 = polyband(prep, MAX(poly[i].y, poly[j].y));
+        for(int b = b0; b <= b1; b++)
+        {
+            prep->edges[fill[b]++] = poly[i];
+            prep->edges[fill[b]++] = poly[j];
+        }
+    }
+    delete [] fill;
+}
+
+/*----------------------------------------------------------------------------
+ * freepoly
+ *----------------------------------------------------------------------------*/
+void MathLib::freepoly (poly_t* prep)
+{
+    delete [] prep->band_index;
+    delete [] prep->edges;
+    prep->band_index = NULL;
+    prep->edges = NULL;
+}
+
+/*----------------------------------------------------------------------------
+ * inpoly - batch
+ *----------------------------------------------------------------------------*/
+void MathLib::inpoly (const poly_t* prep, const point_t* points, long n, bool* inclusion)
+{
+    for(long k = 0; k < n; k++)
+    {
+        inclusion[k] = inpoly(prep, points[k]);
+    }
+}
+
 /*----------------------------------------------------------------------------
  * b64encode
  *
@@ -44,6 +44,8 @@ class MathLib
 
         static const int MAXFREQSPEC = 8192;
         static const int LOG2DATASIZE = 13;
+        static const int MAX_POLY_BANDS = 1024;
+        static const int POLY_BATCH_SIZE = 256;
         static const double EARTHRADIUS;
         static const char* B64CHARS;
         static const int B64INDEX[256];
@@ -77,6 +79,21 @@ class MathLib
             double  y;
         } point_t;
 
+        /* Prepared Polygon
+         *  the non-horizontal edges of the polygon are bucketed into horizontal
+         *  bands of the bounding box so that an inclusion test only visits the
+         *  edges that span the band the point falls in */
+        typedef struct {
+            double      min_x;
+            double      min_y;
+            double      max_x;
+            double      max_y;
+            double      band_scale;     // bands per unit of y
+            int         num_bands;
+            int*        band_index;     // num_bands + 1 offsets into edges
+            point_t*    edges;          // endpoint pairs, bucketed by band
+        } poly_t;
+
         /*--------------------------------------------------------------------
          * Methods
          *--------------------------------------------------------------------*/
@@ -84,7 +101,32 @@ class MathLib
         static double   FFT         (double result[], int data[], unsigned long size);
         static point_t  coord2point (const coord_t c, proj_t projection);
         static coord_t  point2coord (const point_t p, proj_t projection);
+        static void     coord2point (const double* lon, const double* lat, long n, proj_t projection, point_t* points);
         static bool     inpoly      (point_t* poly, int len, point_t point);
+        static void     initpoly    (poly_t* prep, const point_t* poly, int len);
+        static void     freepoly    (poly_t* prep);
+        static void     inpoly      (const poly_t* prep, const point_t* points, long n, bool* inclusion);
+        static inline bool inpoly   (const poly_t* prep, point_t point)
+        {
+            /* Bounding Box (written so that NaNs are excluded) */
+            if(!(point.y >= prep->min_y && point.y <= prep->max_y && point.x <= prep->max_x)) return false;
+
+            /* Edges Spanning the Point's Band */
+            int band = polyband(prep, point.y);
+            bool c = false;
+            for(int e = prep->band_index[band]; e < prep->band_index[band + 1]; e += 2)
+            {
+                const point_t& pi = prep->edges[e];
+                const point_t& pj = prep->edges[e + 1];
+                if((pi.y > point.y) != (pj.y > point.y))
+                {
+                    double x_extent = (pj.x - pi.x) * (point.y - pi.y) / (pj.y - pi.y) + pi.x;
+                    if(point.x < x_extent) c = !c;
+                }
+            }
+
+            return c;
+        }
 
         static const std::string b64encode(const void* data, const size_t &len);
         static const std::string b64decode(const void* data, const size_t &len);
@@ -100,6 +142,14 @@ class MathLib
         static void     freqCorrelation     (complex_t data[], unsigned long size, int isign);
         static double   getPolarMagnitude   (double ReX, double ImX);
         static double   getPolarPhase       (double ReX, double ImX);
+
+        static inline int polyband          (const poly_t* prep, double y)
+        {
+            int band = (int)((y - prep->min_y) * prep->band_scale);
+            if(band < 0) return 0;
+            if(band >= prep->num_bands) return prep->num_bands - 1;
+            return band;
+        }
 };
 
 #endif /* __math_lib__ */
@@ -48,6 +48,21 @@
  * STATIC DATA
  ******************************************************************************/
 
+Mutex                                       GdalRaster::datasetMut;
+Dictionary<GdalRaster::dataset_entry_t*>    GdalRaster::datasetCache;
+Ordering<GdalRaster::dataset_entry_t*>      GdalRaster::datasetLru;
+int64_t                                     GdalRaster::datasetBytes = 0;
+int64_t                                     GdalRaster::datasetBudget = GdalRaster::DEFAULT_DATASET_CACHE_SIZE;
+unsigned long                               GdalRaster::datasetSeq = 0;
+
+Mutex                                       GdalRaster::transformMut;
+Dictionary<GdalRaster::transform_entry_t*>  GdalRaster::transformCache;
+
+Publisher*                                  GdalRaster::prefetchPub = NULL;
+Subscriber*                                 GdalRaster::prefetchSub = NULL;
+bool                                        GdalRaster::prefetchActive = false;
+Thread**                                    GdalRaster::prefetchPids = NULL;
+
 /******************************************************************************
  * PUBLIC METHODS
  ******************************************************************************/
@@ -61,16 +76,28 @@ GdalRaster::GdalRaster(GeoParms* _parms, const std::string& _fileName, double _g
    gpsTime    (_gpsTime),
    sample     (),
    transf     (NULL),
+   polar      (),
    overrideCRS(cb),
    fileName   (_fileName),
    dset       (NULL),
+   datasetEntry(NULL),
    band       (NULL),
    dataIsElevation(_dataIsElevation),
    rows       (0),
    cols       (0),
    cellSize   (0),
    bbox       (),
-   radiusInPixels(0)
+   radiusInPixels(0),
+   xBlockSize (0),
+   yBlockSize (0),
+   resampleKey(-1),
+   resampleValue(0),
+   windowDset (NULL),
+   windowOverview(-1),
+   windowCol  (0),
+   windowRow  (0),
+   windowCols (0),
+   windowRows (0)
 {
 }
 
@@ -79,8 +106,18 @@ GdalRaster::GdalRaster(GeoParms* _parms, const std::string& _fileName, double _g
  *----------------------------------------------------------------------------*/
 GdalRaster::~GdalRaster(void)
 {
-    if(dset) GDALClose((GDALDatasetH)dset);
-    if(transf) OGRCoordinateTransformation::DestroyCT(transf);
+    clearWindow();
+
+    if(datasetEntry)
+    {
+        /* Keep dataset and transform open for the next raster of this file */
+        checkinDataset(datasetEntry);
+    }
+    else
+    {
+        if(dset) GDALClose((GDALDatasetH)dset);
+        if(transf) OGRCoordinateTransformation::DestroyCT(transf);
+    }
 }
 
 /*----------------------------------------------------------------------------
@@ -94,11 +131,26 @@ void GdalRaster::open(void)
         return;
     }
 
-    dset = (GDALDataset*)GDALOpenEx(fileName.c_str(), GDAL_OF_RASTER | GDAL_OF_READONLY | GDAL_OF_VERBOSE_ERROR, NULL, NULL, NULL);
-    if(dset == NULL)
-        throw RunTimeException(CRITICAL, RTE_ERROR, "Failed to opened raster: %s:", fileName.c_str());
+    /* Reuse dataset and transform left open by an earlier raster of this file,
+     * in-memory rasters are unique to their owner and never shared */
+    const bool cacheable = fileName.compare(0, 8, "/vsimem/") != 0;
+    const std::string key = cacheable ? datasetKey() : fileName;
+    if(cacheable) datasetEntry = checkoutDataset(key);
+    if(datasetEntry)
+    {
+        dset   = datasetEntry->dset;
+        transf = datasetEntry->transf;
+        polar  = datasetEntry->polar;
+        mlog(DEBUG, "Reusing %s", fileName.c_str());
+    }
+    else
+    {
+        dset = (GDALDataset*)GDALOpenEx(fileName.c_str(), GDAL_OF_RASTER | GDAL_OF_READONLY | GDAL_OF_VERBOSE_ERROR, NULL, NULL, NULL);
+        if(dset == NULL)
+            throw RunTimeException(CRITICAL, RTE_ERROR, "Failed to opened raster: %s:", fileName.c_str());
 
-    mlog(DEBUG, "Opened %s", fileName.c_str());
+        mlog(DEBUG, "Opened %s", fileName.c_str());
+    }
 
     /* Store information about raster */
     cols = dset->GetRasterXSize();
@@ -132,9 +184,23 @@ void GdalRaster::open(void)
 
     band = dset->GetRasterBand(1);
     CHECKPTR(band);
+    band->GetBlockSize(&xBlockSize, &yBlockSize);
 
-    /* Create coordinates transform for raster */
-    createTransform();
+    if(datasetEntry == NULL)
+    {
+        /* Create coordinates transform for raster */
+        createTransform();
+        if(!cacheable) return;
+
+        /* Share dataset through the dataset cache once it is fully set up */
+        datasetEntry = new dataset_entry_t;
+        datasetEntry->key       = StringLib::duplicate(key.c_str());
+        datasetEntry->dset      = dset;
+        datasetEntry->transf    = transf;
+        datasetEntry->polar     = polar;
+        datasetEntry->footprint = datasetFootprint();
+        datasetEntry->lruSeq    = 0;
+    }
 }
 
 /*----------------------------------------------------------------------------
@@ -154,7 +220,9 @@ void GdalRaster::samplePOI(const Point& _poi)
         double z = poi.z;
         // mlog(DEBUG, "Before transform x,y,z: (%.4lf, %.4lf, %.4lf)", poi.x, poi.y, poi.z);
 
-        if(!transf->Transform(1, &poi.x, &poi.y, &poi.z))
+        int success = FALSE;
+        transformPoints(1, &poi.x, &poi.y, &poi.z, &success);
+        if(!success)
             throw RunTimeException(CRITICAL, RTE_ERROR, "Coordinates Transform failed for x,y,z (%lf, %lf, %lf)", poi.x, poi.y, poi.z);
 
         // mlog(DEBUG, "After  transform x,y,z: (%.4lf, %.4lf, %.4lf)", poi.x, poi.y, poi.z);
@@ -186,6 +254,177 @@ void GdalRaster::samplePOI(const Point& _poi)
 }
 
 
+/*----------------------------------------------------------------------------
+ * samplePOIs
+ *
+ *  Samples a list of points in one pass: coordinates are transformed together,
+ *  points are visited in block order so each block is locked once, and
+ *  samples[i] is only meaningful when valid[i] is set.
+ *----------------------------------------------------------------------------*/
+void GdalRaster::samplePOIs(const std::vector<Point>& pois, std::vector<RasterSample>& samples, std::vector<bool>& valid)
+{
+    const size_t n = pois.size();
+    samples.assign(n, RasterSample());
+    valid.assign(n, false);
+    _sampled = false;
+    if(n == 0) return;
+
+    try
+    {
+        if(dset == NULL)
+            open();
+
+        /* Transform all points at once */
+        std::vector<double> x(n), y(n), z(n);
+        std::vector<int> success(n, FALSE);
+        for(size_t i = 0; i < n; i++)
+        {
+            x[i] = pois[i].x;
+            y[i] = pois[i].y;
+            z[i] = pois[i].z;
+        }
+        transformPoints(n, x.data(), y.data(), z.data(), success.data());
+
+        /* Find pixel and block of every point inside the raster */
+        std::vector<pixel_ref_t> pixels;
+        pixels.reserve(n);
+        for(size_t i = 0; i < n; i++)
+        {
+            if(!success[i])
+            {
+                mlog(ERROR, "Coordinates Transform failed for x,y,z (%lf, %lf, %lf)", pois[i].x, pois[i].y, pois[i].z);
+                continue;
+            }
+
+            if((x[i] >= bbox.lon_min) && (x[i] <= bbox.lon_max) &&
+               (y[i] >= bbox.lat_min) && (y[i] <= bbox.lat_max))
+            {
+                int col, row;
+                toPixel(Point(x[i], y[i], z[i]), col, row);
+                if(col < 0 || row < 0 || col >= static_cast<int>(cols) || row >= static_cast<int>(rows))
+                    continue;
+
+                pixel_ref_t pixel;
+                pixel.block = (static_cast<uint64_t>(row / yBlockSize) << 32) | static_cast<uint64_t>(col / xBlockSize);
+                pixel.index = static_cast<uint32_t>(i);
+                pixel.col   = col;
+                pixel.row   = row;
+                pixels.push_back(pixel);
+            }
+        }
+
+        /* Visit points block by block and pixel by pixel, so points sharing a window are resampled once */
+        std::sort(pixels.begin(), pixels.end(), [](const pixel_ref_t& a, const pixel_ref_t& b) {
+            if(a.block != b.block) return a.block < b.block;
+            if(a.row != b.row) return a.row < b.row;
+            if(a.col != b.col) return a.col < b.col;
+            return a.index < b.index;
+        });
+
+        /* Start fetching later blocks while the first ones are sampled */
+        prefetchBlocks(pixels);
+
+        const bool nearest = (parms->sampling_algo == GRIORA_NearestNeighbour);
+        size_t start = 0;
+        while(start < pixels.size())
+        {
+            /* Find points in this block */
+            size_t end = start;
+            while(end < pixels.size() && pixels[end].block == pixels[start].block) end++;
+
+            /* Lock block once for all of its points, zonal windows then read it from the block cache */
+            GDALRasterBlock* block = NULL;
+            void* data = NULL;
+            if(nearest || parms->zonal_stats)
+            {
+                try
+                {
+                    block = lockBlock(pixels[start].col / xBlockSize, pixels[start].row / yBlockSize);
+                    data = block->GetDataRef();
+                    if(data == NULL)
+                    {
+                        block->DropLock();
+                        block = NULL;
+                        CHECKPTR(data);
+                    }
+                }
+                catch (const RunTimeException &e)
+                {
+                    mlog(e.level(), "Error reading from raster: %s", e.what());
+                    if(nearest)
+                    {
+                        start = end;
+                        continue;
+                    }
+                }
+            }
+
+            /* Read the pixels around all points of the block once, each point is resampled from that copy */
+            if(!nearest)
+            {
+                try
+                {
+                    loadWindow(pixels, start, end);
+                }
+                catch (const RunTimeException &e)
+                {
+                    mlog(e.level(), "Error reading resampling window: %s", e.what());
+                    clearWindow();
+                }
+            }
+
+            for(size_t p = start; p < end; p++)
+            {
+                const pixel_ref_t& pixel = pixels[p];
+                const uint32_t i = pixel.index;
+                Point poi(x[i], y[i], z[i]);
+
+                sample.clear();
+                verticalShift = pois[i].z - z[i];
+
+                if(nearest)
+                {
+                    int offset = (pixel.row % yBlockSize) * xBlockSize + (pixel.col % xBlockSize);
+                    try
+                    {
+                        sample.value = readBlockValue(data, offset);
+                    }
+                    catch (const RunTimeException &e)
+                    {
+                        mlog(e.level(), "Error reading from raster: %s", e.what());
+                        continue;
+                    }
+                    if(nodataCheck() && dataIsElevation)
+                    {
+                        sample.value += verticalShift;
+                    }
+                }
+                else
+                {
+                    resamplePixel(poi);
+                }
+
+                if(parms->zonal_stats)
+                    computeZonalStats(poi);
+
+                sample.time = gpsTime;
+                samples[i]  = sample;
+                valid[i]    = true;
+                _sampled    = true;
+            }
+
+            if(block) block->DropLock();
+            start = end;
+        }
+    }
+    catch (const RunTimeException &e)
+    {
+        mlog(e.level(), "Error sampling raster: %s", e.what());
+    }
+
+    clearWindow();
+}
+
 /*----------------------------------------------------------------------------
  * setCRSfromWkt
  *----------------------------------------------------------------------------*/
@@ -220,12 +459,12 @@ void GdalRaster::initAwsAccess(GeoParms* _parms)
 #ifdef __aws__
         const char* path = _parms->asset->getPath();
         const char* identity = _parms->asset->getIdentity();
-        CredentialStore::Credential credentials = CredentialStore::get(identity);
-        if(credentials.provided)
+        CredentialStore::Handle credentials = CredentialStore::acquire(identity);
+        if(credentials->provided)
         {
-            VSISetPathSpecificOption(path, "AWS_ACCESS_KEY_ID", credentials.accessKeyId);
-            VSISetPathSpecificOption(path, "AWS_SECRET_ACCESS_KEY", credentials.secretAccessKey);
-            VSISetPathSpecificOption(path, "AWS_SESSION_TOKEN", credentials.sessionToken);
+            VSISetPathSpecificOption(path, "AWS_ACCESS_KEY_ID", credentials->accessKeyId);
+            VSISetPathSpecificOption(path, "AWS_SECRET_ACCESS_KEY", credentials->secretAccessKey);
+            VSISetPathSpecificOption(path, "AWS_SESSION_TOKEN", credentials->sessionToken);
         }
         else
         {
@@ -238,6 +477,115 @@ void GdalRaster::initAwsAccess(GeoParms* _parms)
 
 
 
+/*----------------------------------------------------------------------------
+ * init
+ *----------------------------------------------------------------------------*/
+void GdalRaster::init(void)
+{
+    /* Start Prefetch Thread Pool */
+    prefetchPub = new Publisher(NULL, Publisher::defaultFree, PREFETCH_QUEUE_DEPTH);
+    prefetchSub = new Subscriber(*prefetchPub);
+    prefetchActive = true;
+    prefetchPids = new Thread* [PREFETCH_THREADS];
+    for(int t = 0; t < PREFETCH_THREADS; t++)
+    {
+        prefetchPids[t] = new Thread(prefetchThread, NULL);
+    }
+}
+
+/*----------------------------------------------------------------------------
+ * deinit
+ *----------------------------------------------------------------------------*/
+void GdalRaster::deinit(void)
+{
+    /* Stop Prefetch Thread Pool */
+    prefetchActive = false;
+    if(prefetchPids)
+    {
+        for(int t = 0; t < PREFETCH_THREADS; t++)
+        {
+            delete prefetchPids[t];
+        }
+        delete [] prefetchPids;
+        prefetchPids = NULL;
+    }
+    if(prefetchSub)
+    {
+        /* Free paths of tasks never picked up */
+        prefetch_task_t task;
+        while(prefetchSub->receiveCopy(&task, sizeof(prefetch_task_t), IO_CHECK) > 0)
+        {
+            delete [] task.path;
+        }
+        delete prefetchSub;
+        prefetchSub = NULL;
+    }
+    if(prefetchPub)
+    {
+        delete prefetchPub;
+        prefetchPub = NULL;
+    }
+
+    datasetMut.lock();
+    {
+        datasetBudget = 0;
+        evictDatasets();
+    }
+    datasetMut.unlock();
+
+    transformMut.lock();
+    {
+        transform_entry_t* entry;
+        const char* key = transformCache.first(&entry);
+        while(key != NULL)
+        {
+            OGRCoordinateTransformation::DestroyCT(entry->transf);
+            delete entry;
+            key = transformCache.next(&entry);
+        }
+        transformCache.clear();
+    }
+    transformMut.unlock();
+}
+
+/*----------------------------------------------------------------------------
+ * luaDatasetCache - dscache([<budget in bytes>]) --> budget, bytes, datasets
+ *----------------------------------------------------------------------------*/
+int GdalRaster::luaDatasetCache(lua_State* L)
+{
+    bool status = false;
+    int num_ret = 1;
+
+    try
+    {
+        bool provided = false;
+        long budget = LuaObject::getLuaInteger(L, 1, true, 0, &provided);
+        if(provided && budget < 0) throw RunTimeException(CRITICAL, RTE_ERROR, "Invalid dataset cache budget: %ld", budget);
+
+        datasetMut.lock();
+        {
+            if(provided)
+            {
+                datasetBudget = budget;
+                evictDatasets();
+            }
+            lua_pushinteger(L, datasetBudget);
+            lua_pushinteger(L, datasetBytes);
+            lua_pushinteger(L, datasetCache.length());
+        }
+        datasetMut.unlock();
+        num_ret += 3;
+
+        status = true;
+    }
+    catch(const RunTimeException& e)
+    {
+        mlog(e.level(), "Error configuring dataset cache: %s", e.what());
+    }
+
+    return LuaObject::returnLuaStatus(L, status, num_ret);
+}
+
 /******************************************************************************
  * PROTECTED METHODS
  ******************************************************************************/
@@ -254,27 +602,16 @@ void GdalRaster::readPixel(const Point& poi)
     /* Use fast method recomended by GDAL docs to read individual pixel */
     try
     {
-        const int col = static_cast<int>(floor(invGeoTrnasform[0] + invGeoTrnasform[1] * poi.x + invGeoTrnasform[2] * poi.y));
-        const int row = static_cast<int>(floor(invGeoTrnasform[3] + invGeoTrnasform[4] * poi.y + invGeoTrnasform[5] * poi.y));
+        int col, row;
+        toPixel(poi, col, row);
 
         // mlog(DEBUG, "%dP, %dL\n", col, row);
 
-        int xBlockSize = 0;
-        int yBlockSize = 0;
-        band->GetBlockSize(&xBlockSize, &yBlockSize);
-
         /* Raster offsets to block of interest */
         int xblk = col / xBlockSize;
         int yblk = row / yBlockSize;
 
-        GDALRasterBlock *block = NULL;
-        int cnt = 2;
-        do
-        {
-            /* Retry read if error */
-            block = band->GetLockedBlockRef(xblk, yblk, false);
-        } while (block == NULL && cnt--);
-        CHECKPTR(block);
+        GDALRasterBlock *block = lockBlock(xblk, yblk);
 
         /* Get data block pointer, no memory copied but block is locked */
         void *data = block->GetDataRef();
@@ -290,78 +627,14 @@ void GdalRaster::readPixel(const Point& poi)
         int _row = row % yBlockSize;
         int offset = _row * xBlockSize + _col;
 
-        /* Be carefull using offset based on the pixel data type */
-        switch(band->GetRasterDataType())
+        try
         {
-            case GDT_Byte:
-            {
-                uint8_t* p   = static_cast<uint8_t*>(data);
-                sample.value = p[offset];
-            }
-            break;
-
-            case GDT_UInt16:
-            {
-                uint16_t* p  = static_cast<uint16_t*>(data);
-                sample.value = p[offset];
-            }
-            break;
-
-            case GDT_Int16:
-            {
-                int16_t* p   = static_cast<int16_t*>(data);
-                sample.value = p[offset];
-            }
-            break;
-
-            case GDT_UInt32:
-            {
-                uint32_t* p  = static_cast<uint32_t*>(data);
-                sample.value = p[offset];
-            }
-            break;
-
-            case GDT_Int32:
-            {
-                int32_t* p   = static_cast<int32_t*>(data);
-                sample.value = p[offset];
-            }
-            break;
-
-            case GDT_Int64:
-            {
-                int64_t* p   = static_cast<int64_t*>(data);
-                sample.value = p[offset];
-            }
-            break;
-
-            case GDT_UInt64:
-            {
-                uint64_t* p  = static_cast<uint64_t*>(data);
-                sample.value = p[offset];
-            }
-            break;
-
-            case GDT_Float32:
-            {
-                float* p     = static_cast<float*>(data);
-                sample.value = p[offset];
-            }
-            break;
-
-            case GDT_Float64:
-            {
-                double* p    = static_cast<double*>(data);
-                sample.value = p[offset];
-            }
-            break;
-
-            default:
-                /*
-                 * Complex numbers are supported but not needed at this point.
-                 */
-                block->DropLock();
-                throw RunTimeException(CRITICAL, RTE_ERROR, "Unsuported data type in raster: %s:", fileName.c_str());
+            sample.value = readBlockValue(data, offset);
+        }
+        catch (const RunTimeException&)
+        {
+            block->DropLock();
+            throw;
         }
 
         /* Done reading, release block lock */
@@ -380,6 +653,48 @@ void GdalRaster::readPixel(const Point& poi)
     }
 }
 
+/*----------------------------------------------------------------------------
+ * readBlockValue
+ *----------------------------------------------------------------------------*/
+double GdalRaster::readBlockValue(const void* data, int offset)
+{
+    /* Be carefull using offset based on the pixel data type */
+    switch(band->GetRasterDataType())
+    {
+        case GDT_Byte:      return static_cast<const uint8_t*>(data)[offset];
+        case GDT_UInt16:    return static_cast<const uint16_t*>(data)[offset];
+        case GDT_Int16:     return static_cast<const int16_t*>(data)[offset];
+        case GDT_UInt32:    return static_cast<const uint32_t*>(data)[offset];
+        case GDT_Int32:     return static_cast<const int32_t*>(data)[offset];
+        case GDT_Int64:     return static_cast<const int64_t*>(data)[offset];
+        case GDT_UInt64:    return static_cast<const uint64_t*>(data)[offset];
+        case GDT_Float32:   return static_cast<const float*>(data)[offset];
+        case GDT_Float64:   return static_cast<const double*>(data)[offset];
+        default:
+            /*
+             * Complex numbers are supported but not needed at this point.
+             */
+            throw RunTimeException(CRITICAL, RTE_ERROR, "Unsuported data type in raster: %s:", fileName.c_str());
+    }
+}
+
+/*----------------------------------------------------------------------------
+ * lockBlock
+ *----------------------------------------------------------------------------*/
+GDALRasterBlock* GdalRaster::lockBlock(int xblk, int yblk)
+{
+    GDALRasterBlock *block = NULL;
+    int cnt = 2;
+    do
+    {
+        /* Retry read if error */
+        block = band->GetLockedBlockRef(xblk, yblk, false);
+    } while (block == NULL && cnt--);
+    CHECKPTR(block);
+
+    return block;
+}
+
 /*----------------------------------------------------------------------------
  * resamplePixel
  *----------------------------------------------------------------------------*/
@@ -387,39 +702,11 @@ void GdalRaster::resamplePixel(const Point& poi)
 {
     try
     {
-        const int col = static_cast<int>(floor(invGeoTrnasform[0] + invGeoTrnasform[1] * poi.x + invGeoTrnasform[2] * poi.y));
-        const int row = static_cast<int>(floor(invGeoTrnasform[3] + invGeoTrnasform[4] * poi.y + invGeoTrnasform[5] * poi.y));
+        int col, row;
+        toPixel(poi, col, row);
 
         int windowSize, offset;
-
-        /* If zero radius provided, use defaul kernels for each sampling algorithm */
-        if (parms->sampling_radius == 0)
-        {
-            int kernel = 0;
-
-            if (parms->sampling_algo == GRIORA_Bilinear)
-                kernel = 2; /* 2x2 kernel */
-            else if (parms->sampling_algo == GRIORA_Cubic)
-                kernel = 4; /* 4x4 kernel */
-            else if (parms->sampling_algo == GRIORA_CubicSpline)
-                kernel = 4; /* 4x4 kernel */
-            else if (parms->sampling_algo == GRIORA_Lanczos)
-                kernel = 6; /* 6x6 kernel */
-            else if (parms->sampling_algo == GRIORA_Average)
-                kernel = 6; /* No default kernel, pick something */
-            else if (parms->sampling_algo == GRIORA_Mode)
-                kernel = 6; /* No default kernel, pick something */
-            else if (parms->sampling_algo == GRIORA_Gauss)
-                kernel = 6; /* No default kernel, pick something */
-
-            windowSize = kernel + 1;    // Odd window size around pixel
-            offset = (kernel / 2);
-        }
-        else
-        {
-            windowSize = radiusInPixels * 2 + 1;  // Odd window size around pixel
-            offset = radiusInPixels;
-        }
+        resampleKernel(windowSize, offset);
 
         int _col = col - offset;
         int _row = row - offset;
@@ -431,7 +718,22 @@ void GdalRaster::resamplePixel(const Point& poi)
         bool validWindow = containsWindow(_col, _row, cols, rows, windowSize);
         if (validWindow)
         {
-            readRasterWithRetry(_col, _row, windowSize, windowSize, &sample.value, 1, 1, &args);
+            /*
+             * The window is resampled down to one pixel, so the result depends only on
+             * the window and not on where the point falls inside its pixel.
+             * Points sharing a pixel reuse the last resampled value, and points
+             * sampled in a batch are resampled from the copy made by loadWindow.
+             */
+            const int64_t key = (static_cast<int64_t>(_row) << 32) | static_cast<uint32_t>(_col);
+            if(key != resampleKey)
+            {
+                if(!readWindow(_col, _row, windowSize, &args, &resampleValue))
+                {
+                    readRasterWithRetry(_col, _row, windowSize, windowSize, &resampleValue, 1, 1, &args);
+                }
+                resampleKey = key;
+            }
+            sample.value = resampleValue;
             if(nodataCheck() && dataIsElevation)
             {
                 sample.value += verticalShift;
@@ -449,17 +751,193 @@ void GdalRaster::resamplePixel(const Point& poi)
     }
 }
 
+/*----------------------------------------------------------------------------
+ * resampleKernel - size of the window resampled around a pixel and its offset
+ *----------------------------------------------------------------------------*/
+void GdalRaster::resampleKernel(int& windowSize, int& offset)
+{
+    /* If zero radius provided, use defaul kernels for each sampling algorithm */
+    if (parms->sampling_radius == 0)
+    {
+        int kernel = 0;
+
+        if (parms->sampling_algo == GRIORA_Bilinear)
+            kernel = 2; /* 2x2 kernel */
+        else if (parms->sampling_algo == GRIORA_Cubic)
+            kernel = 4; /* 4x4 kernel */
+        else if (parms->sampling_algo == GRIORA_CubicSpline)
+            kernel = 4; /* 4x4 kernel */
+        else if (parms->sampling_algo == GRIORA_Lanczos)
+            kernel = 6; /* 6x6 kernel */
+        else if (parms->sampling_algo == GRIORA_Average)
+            kernel = 6; /* No default kernel, pick something */
+        else if (parms->sampling_algo == GRIORA_Mode)
+            kernel = 6; /* No default kernel, pick something */
+        else if (parms->sampling_algo == GRIORA_Gauss)
+            kernel = 6; /* No default kernel, pick something */
+
+        windowSize = kernel + 1;    // Odd window size around pixel
+        offset = (kernel / 2);
+    }
+    else
+    {
+        windowSize = radiusInPixels * 2 + 1;  // Odd window size around pixel
+        offset = radiusInPixels;
+    }
+}
+
+/*----------------------------------------------------------------------------
+ * loadWindow
+ *
+ *  Reads the union of the resampling windows of a run of points (pixels from
+ *  start to end) in one RasterIO and wraps it in a MEM dataset. Windows are
+ *  mapped onto the overview RasterIO of the band would pick, and the copy is
+ *  padded by the reach of the resampling kernel so each point resampled from
+ *  it sees the same pixels it would see in the raster.
+ *----------------------------------------------------------------------------*/
+void GdalRaster::loadWindow(const std::vector<pixel_ref_t>& pixels, size_t start, size_t end)
+{
+    clearWindow();
+
+    /* A single point is read directly */
+    if(end - start < 2) return;
+
+    int windowSize, offset;
+    resampleKernel(windowSize, offset);
+
+    GDALRasterIOExtraArg args;
+    INIT_RASTERIO_EXTRA_ARG(args);
+    args.eResampleAlg = parms->sampling_algo;
+
+    /* Union of the windows, points whose window maps onto another overview are read directly */
+    const bool overviews = band->GetOverviewCount() > 0;
+    int overview = -2; /* Not known until the first window is mapped */
+    int col0 = INT_MAX, row0 = INT_MAX, col1 = INT_MIN, row1 = INT_MIN, span = 0;
+    for(size_t p = start; p < end; p++)
+    {
+        int xoff = pixels[p].col - offset;
+        int yoff = pixels[p].row - offset;
+        if(!containsWindow(xoff, yoff, cols, rows, windowSize)) continue;
+
+        int xsize = windowSize;
+        int ysize = windowSize;
+        GDALRasterIOExtraArg ovrArgs = args;
+        const int level = overviews ? GDALBandGetBestOverviewLevel2(band, xoff, yoff, xsize, ysize, 1, 1, &ovrArgs) : -1;
+        if(overview == -2) overview = level;
+        else if(level != overview) continue;
+
+        col0 = MIN(col0, xoff);
+        row0 = MIN(row0, yoff);
+        col1 = MAX(col1, xoff + xsize);
+        row1 = MAX(row1, yoff + ysize);
+        span = MAX(span, MAX(xsize, ysize));
+    }
+    if(col1 <= col0 || row1 <= row0) return;
+
+    GDALRasterBand* source = (overview >= 0) ? band->GetOverview(overview) : band;
+    CHECKPTR(source);
+
+    /* Kernel reaches past the window by its radius scaled to the window */
+    const int pad = RESAMPLE_KERNEL_RADIUS * span + 1;
+    col0 = MAX(col0 - pad, 0);
+    row0 = MAX(row0 - pad, 0);
+    col1 = MIN(col1 + pad, source->GetXSize());
+    row1 = MIN(row1 + pad, source->GetYSize());
+    const int colSize = col1 - col0;
+    const int rowSize = row1 - row0;
+
+    /* Read pixels in their own data type so resampling works on the same values */
+    const GDALDataType dataType = source->GetRasterDataType();
+    windowData.resize(static_cast<size_t>(colSize) * rowSize * GDALGetDataTypeSizeBytes(dataType));
+    int cnt = 2;
+    CPLErr err = CE_None;
+    do
+    {
+        err = source->RasterIO(GF_Read, col0, row0, colSize, rowSize, windowData.data(), colSize, rowSize, dataType, 0, 0, NULL);
+    } while (err != CE_None && cnt--);
+    if (err != CE_None) throw RunTimeException(CRITICAL, RTE_ERROR, "RasterIO call failed");
+
+    /* Wrap pixels in a MEM dataset, resampling reads them in place */
+    GDALDriver* memDriver = GetGDALDriverManager()->GetDriverByName("MEM");
+    CHECKPTR(memDriver);
+    windowDset = memDriver->Create("", colSize, rowSize, 0, dataType, NULL);
+    CHECKPTR(windowDset);
+
+    char pointer[MAX_STR_SIZE];
+    const int len = CPLPrintPointer(pointer, windowData.data(), MAX_STR_SIZE - 1);
+    pointer[len] = '\0';
+    char** options = CSLSetNameValue(NULL, "DATAPOINTER", pointer);
+    err = windowDset->AddBand(dataType, options);
+    CSLDestroy(options);
+    CHECK_GDALERR(err);
+
+    int hasNodata = FALSE;
+    const double nodata = source->GetNoDataValue(&hasNodata);
+    if(hasNodata) windowDset->GetRasterBand(1)->SetNoDataValue(nodata);
+
+    windowOverview = overview;
+    windowCol      = col0;
+    windowRow      = row0;
+    windowCols     = colSize;
+    windowRows     = rowSize;
+}
+
+/*----------------------------------------------------------------------------
+ * readWindow - resamples a window from the copy made by loadWindow
+ *
+ *  Returns false when there is no copy or it does not hold the window
+ *----------------------------------------------------------------------------*/
+bool GdalRaster::readWindow(int col, int row, int windowSize, const GDALRasterIOExtraArg* args, double* value)
+{
+    if(windowDset == NULL) return false;
+
+    /* Map window onto the overview RasterIO of the band would read */
+    int xoff = col;
+    int yoff = row;
+    int xsize = windowSize;
+    int ysize = windowSize;
+    GDALRasterIOExtraArg ovrArgs = *args;
+    const int level = (band->GetOverviewCount() > 0) ? GDALBandGetBestOverviewLevel2(band, xoff, yoff, xsize, ysize, 1, 1, &ovrArgs) : -1;
+    if(level != windowOverview) return false;
+
+    if(xoff < windowCol || yoff < windowRow ||
+       xoff + xsize > windowCol + windowCols || yoff + ysize > windowRow + windowRows)
+        return false;
+
+    /* Shift window to the origin of the copy */
+    xoff -= windowCol;
+    yoff -= windowRow;
+    if(ovrArgs.bFloatingPointWindowValidity)
+    {
+        ovrArgs.dfXOff -= windowCol;
+        ovrArgs.dfYOff -= windowRow;
+    }
+
+    GDALRasterBand* windowBand = windowDset->GetRasterBand(1);
+    return windowBand->RasterIO(GF_Read, xoff, yoff, xsize, ysize, value, 1, 1, GDT_Float64, 0, 0, &ovrArgs) == CE_None;
+}
+
+/*----------------------------------------------------------------------------
+ * clearWindow
+ *----------------------------------------------------------------------------*/
+void GdalRaster::clearWindow(void)
+{
+    if(windowDset)
+    {
+        GDALClose((GDALDatasetH)windowDset);
+        windowDset = NULL;
+    }
+}
+
 /*----------------------------------------------------------------------------
  * computeZonalStats
  *----------------------------------------------------------------------------*/
 void GdalRaster::computeZonalStats(const Point& poi)
 {
-    double *samplesArray = NULL;
-
     try
     {
-        const int col = static_cast<int>(floor(invGeoTrnasform[0] + invGeoTrnasform[1] * poi.x + invGeoTrnasform[2] * poi.y));
-        const int row = static_cast<int>(floor(invGeoTrnasform[3] + invGeoTrnasform[4] * poi.y + invGeoTrnasform[5] * poi.y));
+        int col, row;
+        toPixel(poi, col, row);
 
         int windowSize = radiusInPixels * 2 + 1; // Odd window size around pixel
 
@@ -469,90 +947,116 @@ void GdalRaster::computeZonalStats(const Point& poi)
         GDALRasterIOExtraArg args;
         INIT_RASTERIO_EXTRA_ARG(args);
         args.eResampleAlg = parms->sampling_algo;
-        samplesArray = new double[windowSize*windowSize];
 
         bool validWindow = containsWindow(_col, _row, cols, rows, windowSize);
         if (validWindow)
         {
-            readRasterWithRetry(_col, _row, windowSize, windowSize, samplesArray, windowSize, windowSize, &args);
+            if(zonalSpans.size() != static_cast<size_t>(windowSize))
+                buildZonalMask();
+
+            zonalWindow.resize(windowSize*windowSize);
+            readRasterWithRetry(_col, _row, windowSize, windowSize, zonalWindow.data(), windowSize, windowSize, &args);
 
-            /* One of the windows (raster or index data set) was valid. Compute zonal stats */
-            double min = std::numeric_limits<double>::max();
-            double max = std::numeric_limits<double>::min();
-            double sum = 0;
-            double nodata = band->GetNoDataValue();
-            std::vector<double> validSamples;
             /*
              * Only use pixels within radius from pixel containing point of interest.
              * Ignore nodata values.
+             * Each window row is read over the span of the circular mask.
              */
-            const double x1 = col; /* Pixel of interest */
-            const double y1 = row;
-
+            double nodata = band->GetNoDataValue();
+            zonalSamples.clear();
             for (int y = 0; y < windowSize; y++)
             {
-                for (int x = 0; x < windowSize; x++)
+                const int half = zonalSpans[y];
+                const double* span = &zonalWindow[y*windowSize + radiusInPixels - half];
+                for (int x = 0; x <= half * 2; x++)
                 {
-                    double value = samplesArray[y*windowSize + x];
-                    if (value == nodata) continue;
-
-                    if(dataIsElevation)
-                        value += verticalShift;
-
-                    double x2 = x + _col;  /* Current pixel in buffer */
-                    double y2 = y + _row;
-                    double xd = std::pow(x2 - x1, 2);
-                    double yd = std::pow(y2 - y1, 2);
-                    double d  = std::sqrt(xd + yd);
-
-                    if(std::islessequal(d, radiusInPixels))
-                    {
-                        if (value < min) min = value;
-                        if (value > max) max = value;
-                        sum += value;
-                        validSamples.push_back(value);
-                    }
+                    if (span[x] != nodata) zonalSamples.push_back(span[x]);
                 }
             }
 
-            int validSamplesCnt = validSamples.size();
+            /* One of the windows (raster or index data set) was valid. Compute zonal stats */
+            const int validSamplesCnt = zonalSamples.size();
             if(validSamplesCnt > 0)
             {
-                double stdev = 0;  /* Standard deviation */
-                double mad   = 0;  /* Median absolute deviation (MAD) */
-                double mean  = sum / validSamplesCnt;
-
-                for(int i = 0; i < validSamplesCnt; i++)
+                const double* values = zonalSamples.data();
+                const int laneCnt = validSamplesCnt - (validSamplesCnt % ZONAL_LANES);
+
+                /* Sum, min and max kept per lane so the loop has no carried dependency */
+                double sum[ZONAL_LANES];
+                double min[ZONAL_LANES];
+                double max[ZONAL_LANES];
+                for(int l = 0; l < ZONAL_LANES; l++)
                 {
-                    double value = validSamples[i];
-                    stdev += std::pow(value - mean, 2);
-                    mad   += std::fabs(value - mean);
+                    sum[l] = 0;
+                    min[l] = std::numeric_limits<double>::max();
+                    max[l] = std::numeric_limits<double>::lowest();
                 }
+                for(int i = 0; i < laneCnt; i += ZONAL_LANES)
+                {
+                    for(int l = 0; l < ZONAL_LANES; l++)
+                    {
+                        const double value = values[i + l];
+                        sum[l] += value;
+                        min[l] = value < min[l] ? value : min[l];
+                        max[l] = value > max[l] ? value : max[l];
+                    }
+                }
+                for(int i = laneCnt; i < validSamplesCnt; i++)
+                {
+                    sum[0] += values[i];
+                    min[0] = values[i] < min[0] ? values[i] : min[0];
+                    max[0] = values[i] > max[0] ? values[i] : max[0];
+                }
+                for(int l = 1; l < ZONAL_LANES; l++)
+                {
+                    sum[0] += sum[l];
+                    min[0] = std::min(min[0], min[l]);
+                    max[0] = std::max(max[0], max[l]);
+                }
+
+                const double mean = sum[0] / validSamplesCnt;
 
-                stdev = std::sqrt(stdev / validSamplesCnt);
-                mad   = mad / validSamplesCnt;
-
-                /*
-                 * Calculate median
-                 * For performance use nth_element algorithm from std library since it sorts only part of the vector
-                 * NOTE: (vector will be reordered by nth_element)
-                 */
-                std::size_t n = validSamplesCnt / 2;
-                std::nth_element(validSamples.begin(), validSamples.begin() + n, validSamples.end());
-                double median = validSamples[n];
-                if(!(validSamplesCnt & 0x1))
+                double var[ZONAL_LANES];  /* Sum of squared deviations */
+                double dev[ZONAL_LANES];  /* Sum of absolute deviations */
+                for(int l = 0; l < ZONAL_LANES; l++)
                 {
-                    /* Even number of samples, calculate average of two middle samples */
-                    std::nth_element(validSamples.begin(), validSamples.begin() + n-1, validSamples.end());
-                    median = (median + validSamples[n-1]) / 2;
+                    var[l] = 0;
+                    dev[l] = 0;
+                }
+                for(int i = 0; i < laneCnt; i += ZONAL_LANES)
+                {
+                    for(int l = 0; l < ZONAL_LANES; l++)
+                    {
+                        const double d = values[i + l] - mean;
+                        var[l] += d * d;
+                        dev[l] += std::fabs(d);
+                    }
+                }
+                for(int i = laneCnt; i < validSamplesCnt; i++)
+                {
+                    const double d = values[i] - mean;
+                    var[0] += d * d;
+                    dev[0] += std::fabs(d);
+                }
+                for(int l = 1; l < ZONAL_LANES; l++)
+                {
+                    var[0] += var[l];
+                    dev[0] += dev[l];
                 }
 
+                double stdev = std::sqrt(var[0] / validSamplesCnt);  /* Standard deviation */
+                double mad   = dev[0] / validSamplesCnt;             /* Median absolute deviation (MAD) */
+                double median = zonalMedian(min[0], max[0]);
+
+                /* Vertical shift moves location stats only */
+                double shift = dataIsElevation ? verticalShift : 0;
+
                 /* Store calculated zonal stats */
                 sample.stats.count  = validSamplesCnt;
-                sample.stats.min    = min;
-                sample.stats.max    = max;
-                sample.stats.mean   = mean;
-                sample.stats.median = median;
+                sample.stats.min    = min[0] + shift;
+                sample.stats.max    = max[0] + shift;
+                sample.stats.mean   = mean + shift;
+                sample.stats.median = median + shift;
                 sample.stats.stdev  = stdev;
                 sample.stats.mad    = mad;
             }
@@ -563,8 +1067,76 @@ void GdalRaster::computeZonalStats(const Point& poi)
     {
         mlog(e.level(), "Error computing zonal stats: %s", e.what());
     }
+}
 
-    if(samplesArray) delete[] samplesArray;
+/*----------------------------------------------------------------------------
+ * buildZonalMask
+ *
+ *  Circular mask of the sampling radius, stored as the half width of the
+ *  span of pixels within radius on each window row
+ *----------------------------------------------------------------------------*/
+void GdalRaster::buildZonalMask(void)
+{
+    const int radius = radiusInPixels;
+    zonalSpans.resize(radius * 2 + 1);
+    for(int dy = -radius; dy <= radius; dy++)
+    {
+        int half = 0;
+        while((half + 1) * (half + 1) + dy * dy <= radius * radius) half++;
+        zonalSpans[dy + radius] = half;
+    }
+}
+
+/*----------------------------------------------------------------------------
+ * zonalMedian
+ *
+ *  Integer rasters with a small value range use a counting histogram,
+ *  all others select the middle samples in place (zonalSamples is reordered)
+ *----------------------------------------------------------------------------*/
+double GdalRaster::zonalMedian(double min, double max)
+{
+    const std::size_t cnt = zonalSamples.size();
+    const std::size_t n = cnt / 2;
+
+    const GDALDataType dtype = band->GetRasterDataType();
+    const bool isInteger = (dtype == GDT_Byte  || dtype == GDT_UInt16 || dtype == GDT_Int16 ||
+                            dtype == GDT_UInt32 || dtype == GDT_Int32);
+
+    if(isInteger && (max - min) < MAX_ZONAL_HISTOGRAM_BINS)
+    {
+        const int bins = static_cast<int>(max - min) + 1;
+        zonalHistogram.assign(bins, 0);
+        for(double value: zonalSamples)
+        {
+            zonalHistogram[static_cast<int>(value - min)]++;
+        }
+
+        /* Walk cumulative counts to the middle sample(s) */
+        std::size_t seen = 0;
+        int lower = -1;
+        for(int b = 0; b < bins; b++)
+        {
+            seen += zonalHistogram[b];
+            if(lower < 0 && seen > n - (cnt & 0x1 ? 0 : 1)) lower = b;
+            if(seen > n)
+            {
+                return min + (lower + b) / 2.0;
+            }
+        }
+    }
+
+    /*
+     * For performance use nth_element algorithm from std library since it sorts only part of the vector
+     * NOTE: (vector will be reordered by nth_element)
+     */
+    std::nth_element(zonalSamples.begin(), zonalSamples.begin() + n, zonalSamples.end());
+    double median = zonalSamples[n];
+    if(!(cnt & 0x1))
+    {
+        /* Even number of samples, average of two middle samples; the lower one is the largest below n */
+        median = (median + *std::max_element(zonalSamples.begin(), zonalSamples.begin() + n)) / 2;
+    }
+    return median;
 }
 
 /*----------------------------------------------------------------------------
@@ -635,9 +1207,462 @@ void GdalRaster::createTransform(void)
     targetCRS.SetAxisMappingStrategy(OAMS_TRADITIONAL_GIS_ORDER);
     sourceCRS.SetAxisMappingStrategy(OAMS_TRADITIONAL_GIS_ORDER);
 
+    /*
+     * Rasters of a collection share their CRS, so finding the coordinate operation
+     * is done once per target CRS and transform options; later rasters get a clone
+     */
+    char* wkt = NULL;
+    targetCRS.exportToWkt(&wkt);
+    char bounds[MAX_STR_SIZE];
+    StringLib::format(bounds, MAX_STR_SIZE, "|%.9lf,%.9lf,%.9lf,%.9lf|%p",
+                      aoi->lon_min, aoi->lat_min, aoi->lon_max, aoi->lat_max,
+                      reinterpret_cast<void*>(overrideCRS));
+    const std::string key = std::string(wkt ? wkt : "") + "|" +
+                            (parms->proj_pipeline ? parms->proj_pipeline : "") + bounds;
+    CPLFree(wkt);
+
+    transformMut.lock();
+    {
+        transform_entry_t* entry;
+        if(transformCache.find(key.c_str(), &entry))
+        {
+            transf = entry->transf->Clone();
+            polar  = entry->polar;
+        }
+    }
+    transformMut.unlock();
+    if(transf) return;
+
     transf = OGRCreateCoordinateTransformation(&sourceCRS, &targetCRS, options);
     if(transf == NULL)
         throw RunTimeException(CRITICAL, RTE_ERROR, "Failed to create coordinates transform");
+
+    /* Closed form projection, only when no user pipeline picks the operation */
+    polar.enabled = (parms->proj_pipeline == NULL) && initPolarStereo();
+
+    transformMut.lock();
+    {
+        if(transformCache.length() < MAX_CACHED_TRANSFORMS && !transformCache.find(key.c_str()))
+        {
+            OGRCoordinateTransformation* clone = transf->Clone();
+            if(clone)
+            {
+                transform_entry_t* entry = new transform_entry_t;
+                entry->transf = clone;
+                entry->polar  = polar;
+                transformCache.add(key.c_str(), entry);
+            }
+        }
+    }
+    transformMut.unlock();
+}
+
+/*----------------------------------------------------------------------------
+ * initPolarStereo
+ *
+ *  PGC rasters project EPSG:7912 onto polar stereographic grids of the same
+ *  datum with ellipsoidal heights, a conversion simple enough to evaluate in
+ *  closed form (EPSG Guidance Note 7-2, variants A and B)
+ *----------------------------------------------------------------------------*/
+bool GdalRaster::initPolarStereo(void)
+{
+    polar = {};
+
+    if(!targetCRS.IsProjected() || targetCRS.IsCompound()) return false;
+    const char* projection = targetCRS.GetAttrValue("PROJECTION");
+    if(projection == NULL || strcmp(projection, SRS_PT_POLAR_STEREOGRAPHIC) != 0) return false;
+    if(!targetCRS.IsSameGeogCS(&sourceCRS) || targetCRS.GetLinearUnits() != 1.0) return false;
+
+    const double lat_ts = targetCRS.GetProjParm(SRS_PP_LATITUDE_OF_ORIGIN, 0.0) * M_PI / 180.0;
+    const double k0     = targetCRS.GetProjParm(SRS_PP_SCALE_FACTOR, 1.0);
+    const double a      = targetCRS.GetSemiMajor();
+    const double invf   = targetCRS.GetInvFlattening();
+    if(lat_ts == 0.0 || invf == 0.0) return false;
+
+    const double f = 1.0 / invf;
+    const double e = std::sqrt(2 * f - f * f);
+    const double lat_c = std::fabs(lat_ts);
+
+    polar.e             = e;
+    polar.south         = lat_ts < 0;
+    polar.lon0          = targetCRS.GetProjParm(SRS_PP_CENTRAL_MERIDIAN, 0.0) * M_PI / 180.0;
+    polar.falseEasting  = targetCRS.GetProjParm(SRS_PP_FALSE_EASTING, 0.0);
+    polar.falseNorthing = targetCRS.GetProjParm(SRS_PP_FALSE_NORTHING, 0.0);
+
+    if(std::fabs(lat_c - M_PI / 2) < 1e-10)
+    {
+        /* Variant A: scale factor at the pole */
+        polar.scale = 2 * a * k0 / std::sqrt(std::pow(1 + e, 1 + e) * std::pow(1 - e, 1 - e));
+    }
+    else
+    {
+        /* Variant B: true scale at standard parallel */
+        const double sin_c = std::sin(lat_c);
+        const double m_c   = std::cos(lat_c) / std::sqrt(1 - e * e * sin_c * sin_c);
+        const double t_c   = std::tan(M_PI / 4 - lat_c / 2) / std::pow((1 - e * sin_c) / (1 + e * sin_c), e / 2);
+        polar.scale = a * m_c / t_c;
+    }
+
+    /* Only trust the closed form where it agrees with PROJ */
+    double lat_check = polar.south ? -75.0 : 75.0;
+    double x[2] = {polar.lon0 * 180.0 / M_PI + 10.0, polar.lon0 * 180.0 / M_PI - 100.0};
+    double y[2] = {lat_check, lat_check + (polar.south ? -10.0 : 10.0)};
+    double z[2] = {100.0, 1000.0};
+    double px[2] = {x[0], x[1]};
+    double py[2] = {y[0], y[1]};
+    double pz[2] = {z[0], z[1]};
+    int success[2] = {FALSE, FALSE};
+    polar.enabled = true;
+    transformPoints(2, x, y, z, success);
+    polar.enabled = false;
+    if(!transf->Transform(2, px, py, pz) || !success[0] || !success[1]) return false;
+    for(int i = 0; i < 2; i++)
+    {
+        if(std::fabs(px[i] - x[i]) > 0.001 || std::fabs(py[i] - y[i]) > 0.001 || std::fabs(pz[i] - z[i]) > 0.001)
+        {
+            mlog(DEBUG, "Polar stereographic closed form disagrees with PROJ, not used for %s", fileName.c_str());
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*----------------------------------------------------------------------------
+ * transformPoints
+ *----------------------------------------------------------------------------*/
+void GdalRaster::transformPoints(int n, double* x, double* y, double* z, int* success)
+{
+    if(!polar.enabled)
+    {
+        transf->Transform(n, x, y, z, success);
+        return;
+    }
+
+    /* Heights are ellipsoidal on both sides and pass through */
+    std::ignore = z;
+    const double e = polar.e;
+    for(int i = 0; i < n; i++)
+    {
+        double lat = y[i] * M_PI / 180.0;
+        if(polar.south) lat = -lat;
+
+        const double sin_lat = std::sin(lat);
+        const double t = std::tan(M_PI / 4 - lat / 2) / std::pow((1 - e * sin_lat) / (1 + e * sin_lat), e / 2);
+        const double rho = polar.scale * t;
+        const double dlon = x[i] * M_PI / 180.0 - polar.lon0;
+
+        success[i] = std::isfinite(rho) && (std::fabs(y[i]) <= 90.0);
+        x[i] = polar.falseEasting + rho * std::sin(dlon);
+        y[i] = polar.south ? polar.falseNorthing + rho * std::cos(dlon)
+                           : polar.falseNorthing - rho * std::cos(dlon);
+    }
+}
+
+/*----------------------------------------------------------------------------
+ * datasetKey
+ *
+ *  A cached transform is only valid for rasters built with the same
+ *  transform options, so they are part of the key along with the file name
+ *----------------------------------------------------------------------------*/
+std::string GdalRaster::datasetKey(void)
+{
+    /* Pipelines can be arbitrarily long, only the fixed size fields are formatted */
+    char bounds[MAX_STR_SIZE];
+    const bbox_t& aoi = parms->aoi_bbox;
+    StringLib::format(bounds, MAX_STR_SIZE, "|%.9lf,%.9lf,%.9lf,%.9lf|%p",
+                      aoi.lon_min, aoi.lat_min, aoi.lon_max, aoi.lat_max,
+                      reinterpret_cast<void*>(overrideCRS));
+    return fileName + "|" + (parms->proj_pipeline ? parms->proj_pipeline : "") + bounds;
+}
+
+/*----------------------------------------------------------------------------
+ * datasetFootprint - estimated bytes held by the dataset while it is open
+ *
+ *  A tiff loads the offset and size of every block, a vrt only describes its
+ *  sources and opens them on demand, other drivers hold little beyond the base
+ *----------------------------------------------------------------------------*/
+int64_t GdalRaster::datasetFootprint(void)
+{
+    int64_t footprint = DATASET_BASE_FOOTPRINT;
+
+    if(driverIs("GTiff"))
+    {
+        int64_t blocks = static_cast<int64_t>((cols + xBlockSize - 1) / xBlockSize) * ((rows + yBlockSize - 1) / yBlockSize);
+        footprint += blocks * TILE_INDEX_BYTES * dset->GetRasterCount();
+    }
+    else if(driverIs("VRT"))
+    {
+        char** files = dset->GetFileList();
+        footprint += MIN(static_cast<int64_t>(CSLCount(files)) * VRT_SOURCE_BYTES, MAX_VRT_FOOTPRINT);
+        CSLDestroy(files);
+    }
+
+    return footprint;
+}
+
+/*----------------------------------------------------------------------------
+ * driverIs
+ *----------------------------------------------------------------------------*/
+bool GdalRaster::driverIs(const char* name)
+{
+    GDALDriver* driver = dset->GetDriver();
+    return driver && StringLib::match(driver->GetDescription(), name);
+}
+
+/*----------------------------------------------------------------------------
+ * checkoutDataset - takes an idle dataset out of the cache for exclusive use
+ *----------------------------------------------------------------------------*/
+GdalRaster::dataset_entry_t* GdalRaster::checkoutDataset(const std::string& key)
+{
+    dataset_entry_t* entry = NULL;
+
+    datasetMut.lock();
+    {
+        if(datasetCache.find(key.c_str(), &entry))
+        {
+            datasetCache.remove(key.c_str());
+            datasetLru.remove(entry->lruSeq);
+            datasetBytes -= entry->footprint;
+        }
+    }
+    datasetMut.unlock();
+
+    return entry;
+}
+
+/*----------------------------------------------------------------------------
+ * checkinDataset - returns a dataset to the cache, evicting the oldest
+ *----------------------------------------------------------------------------*/
+void GdalRaster::checkinDataset(dataset_entry_t* entry)
+{
+    bool cached = false;
+
+    datasetMut.lock();
+    {
+        /* One idle copy per key is enough, extra copies come from concurrent readers */
+        if(entry->footprint <= datasetBudget && !datasetCache.find(entry->key))
+        {
+            entry->lruSeq = datasetSeq++;
+            datasetCache.add(entry->key, entry);
+            datasetLru.add(entry->lruSeq, entry);
+            datasetBytes += entry->footprint;
+            evictDatasets();
+            cached = true;
+        }
+    }
+    datasetMut.unlock();
+
+    if(!cached) closeDataset(entry);
+}
+
+/*----------------------------------------------------------------------------
+ * closeDataset
+ *----------------------------------------------------------------------------*/
+void GdalRaster::closeDataset(dataset_entry_t* entry)
+{
+    GDALClose((GDALDatasetH)entry->dset);
+    if(entry->transf) OGRCoordinateTransformation::DestroyCT(entry->transf);
+    delete [] entry->key;
+    delete entry;
+}
+
+/*----------------------------------------------------------------------------
+ * evictDatasets - closes least recently used datasets until within budget
+ *
+ *  Idle datasets of local and /vsi files hold file descriptors, so their
+ *  number is capped as well as their estimated memory
+ *
+ *  NOTE: must be called with datasetMut locked
+ *----------------------------------------------------------------------------*/
+void GdalRaster::evictDatasets(void)
+{
+    dataset_entry_t* entry;
+    while((datasetBytes > datasetBudget || datasetCache.length() > MAX_CACHED_DATASETS) &&
+          datasetLru.first(&entry) != (unsigned long)INVALID_KEY)
+    {
+        datasetLru.remove(entry->lruSeq);
+        datasetCache.remove(entry->key);
+        datasetBytes -= entry->footprint;
+        mlog(DEBUG, "Evicted %s from dataset cache", entry->key);
+        closeDataset(entry);
+    }
+}
+
+/*----------------------------------------------------------------------------
+ * prefetchBlocks
+ *
+ *  Posts the file ranges of the blocks a batch of points is about to read to
+ *  the prefetch pool; the pool reads them through its own file handles so the
+ *  bytes land in GDAL's shared /vsicurl cache. Pixels are in block order.
+ *----------------------------------------------------------------------------*/
+void GdalRaster::prefetchBlocks(const std::vector<pixel_ref_t>& pixels)
+{
+    /* Only remote files benefit, in-memory and local files are read directly */
+    if(!prefetchActive || pixels.empty()) return;
+    if(fileName.compare(0, 4, "/vsi") != 0 || fileName.compare(0, 8, "/vsimem/") == 0) return;
+
+    /* Block location is only known for tiff based rasters, other drivers (VRT mosaics) are advised */
+    if(!driverIs("GTiff"))
+    {
+        adviseBlocks(pixels);
+        return;
+    }
+
+    int blocks = 0;
+    int64_t bytes = 0;
+    uint64_t lastBlock = pixels[0].block; /* First block is read right away */
+    for(const pixel_ref_t& pixel: pixels)
+    {
+        if(pixel.block == lastBlock) continue;
+        lastBlock = pixel.block;
+
+        const int xblk = pixel.col / xBlockSize;
+        const int yblk = pixel.row / yBlockSize;
+
+        /* Skip blocks already decoded in the block cache */
+        GDALRasterBlock* cached = band->TryGetLockedBlockRef(xblk, yblk);
+        if(cached)
+        {
+            cached->DropLock();
+            continue;
+        }
+
+        /* Sparse blocks have no location and nothing to fetch */
+        char item[MAX_STR_SIZE];
+        const char* offset = band->GetMetadataItem(StringLib::format(item, MAX_STR_SIZE, "BLOCK_OFFSET_%d_%d", xblk, yblk), "TIFF");
+        if(offset == NULL) continue;
+        const uint64_t _offset = strtoull(offset, NULL, 10);
+        const char* size = band->GetMetadataItem(StringLib::format(item, MAX_STR_SIZE, "BLOCK_SIZE_%d_%d", xblk, yblk), "TIFF");
+        if(size == NULL) continue;
+        const uint64_t _size = strtoull(size, NULL, 10);
+        if(_size == 0) continue;
+
+        bytes += _size;
+        if(bytes > MAX_PREFETCH_BYTES || blocks >= MAX_PREFETCH_BLOCKS) break;
+
+        prefetch_task_t task = {
+            .path = StringLib::duplicate(fileName.c_str()),
+            .offset = _offset,
+            .size = _size
+        };
+        if(prefetchPub->postCopy(&task, sizeof(prefetch_task_t), IO_CHECK) <= 0)
+        {
+            /* Pool is backed up, the remaining blocks are read on demand */
+            delete [] task.path;
+            break;
+        }
+        blocks++;
+    }
+}
+
+/*----------------------------------------------------------------------------
+ * adviseBlocks
+ *
+ *  A VRT has no block locations of its own, its sources are only known to the
+ *  driver; the blocks of the batch are merged into windows of nearby blocks
+ *  and each window is advised so the driver fetches the ranges of all the
+ *  sources it covers together instead of one block at a time.
+ *----------------------------------------------------------------------------*/
+void GdalRaster::adviseBlocks(const std::vector<pixel_ref_t>& pixels)
+{
+    const GDALDataType dataType = band->GetRasterDataType();
+    int x0 = 0, y0 = 0, x1 = -1, y1 = -1; /* Block extent of current window, empty when x1 < x0 */
+    int blocks = 0;
+    uint64_t lastBlock = UINT64_MAX;
+
+    for(size_t p = 0; p <= pixels.size(); p++)
+    {
+        int xblk = 0, yblk = 0;
+        bool flush = (p == pixels.size());
+        if(!flush)
+        {
+            if(pixels[p].block == lastBlock) continue;
+            lastBlock = pixels[p].block;
+
+            xblk = pixels[p].col / xBlockSize;
+            yblk = pixels[p].row / yBlockSize;
+
+            /* Skip blocks already decoded in the block cache */
+            GDALRasterBlock* cached = band->TryGetLockedBlockRef(xblk, yblk);
+            if(cached)
+            {
+                cached->DropLock();
+                continue;
+            }
+
+            /* Window keeps growing while its area stays within the prefetch limit */
+            if(x1 < x0)
+            {
+                x0 = x1 = xblk;
+                y0 = y1 = yblk;
+                continue;
+            }
+            const int nx0 = MIN(x0, xblk), nx1 = MAX(x1, xblk);
+            const int ny0 = MIN(y0, yblk), ny1 = MAX(y1, yblk);
+            if(static_cast<int64_t>(nx1 - nx0 + 1) * (ny1 - ny0 + 1) <= MAX_PREFETCH_BLOCKS)
+            {
+                x0 = nx0; x1 = nx1;
+                y0 = ny0; y1 = ny1;
+                continue;
+            }
+        }
+
+        /* Advise current window and start the next one at this block */
+        if(x1 >= x0)
+        {
+            const int col = x0 * xBlockSize;
+            const int row = y0 * yBlockSize;
+            const int colSize = MIN((x1 + 1) * xBlockSize, static_cast<int>(cols)) - col;
+            const int rowSize = MIN((y1 + 1) * yBlockSize, static_cast<int>(rows)) - row;
+            if(band->AdviseRead(col, row, colSize, rowSize, colSize, rowSize, dataType, NULL) != CE_None)
+            {
+                return; /* Blocks are read on demand */
+            }
+            blocks += (x1 - x0 + 1) * (y1 - y0 + 1);
+        }
+        x0 = x1 = xblk;
+        y0 = y1 = yblk;
+
+        /* Advised ranges must still be in the /vsicurl cache when their blocks are read */
+        if(blocks >= MAX_PREFETCH_BLOCKS) return;
+    }
+}
+
+/*----------------------------------------------------------------------------
+ * prefetchThread
+ *----------------------------------------------------------------------------*/
+void* GdalRaster::prefetchThread(void* param)
+{
+    std::ignore = param;
+
+    std::vector<uint8_t> buffer;
+    while(prefetchActive)
+    {
+        prefetch_task_t task;
+        int recv_status = prefetchSub->receiveCopy(&task, sizeof(prefetch_task_t), SYS_TIMEOUT);
+        if(recv_status > 0)
+        {
+            VSILFILE* fp = VSIFOpenL(task.path, "rb");
+            if(fp)
+            {
+                buffer.resize(task.size);
+                if(VSIFSeekL(fp, task.offset, SEEK_SET) == 0)
+                {
+                    VSIFReadL(buffer.data(), 1, task.size, fp);
+                }
+                VSIFCloseL(fp);
+            }
+            delete [] task.path;
+        }
+        else if(recv_status != MsgQ::STATE_TIMEOUT)
+        {
+            mlog(CRITICAL, "Failed to receive block prefetch task: %d", recv_status);
+            break;
+        }
+    }
+
+    return NULL;
 }
 
 /*----------------------------------------------------------------------------
@@ -671,6 +1696,15 @@ bool GdalRaster::containsWindow(int col, int row, int maxCol, int maxRow, int wi
     return true;
 }
 
+/*----------------------------------------------------------------------------
+ * toPixel
+ *----------------------------------------------------------------------------*/
+void GdalRaster::toPixel(const Point& poi, int& col, int& row)
+{
+    col = static_cast<int>(floor(invGeoTrnasform[0] + invGeoTrnasform[1] * poi.x + invGeoTrnasform[2] * poi.y));
+    row = static_cast<int>(floor(invGeoTrnasform[3] + invGeoTrnasform[4] * poi.x + invGeoTrnasform[5] * poi.y));
+}
+
 /*----------------------------------------------------------------------------
  * RasterIoWithRetry
  *----------------------------------------------------------------------------*/
@@ -38,7 +38,11 @@
 
 #include "GeoParms.h"
 #include "RasterSample.h"
+#include "Dictionary.h"
+#include "Ordering.h"
+#include "MsgQ.h"
 #include <ogrsf_frmts.h>
+#include <vector>
 
 /******************************************************************************
  * Typedef and macros used by GDAL class
@@ -79,8 +83,26 @@ class GdalRaster
          *--------------------------------------------------------------------*/
 
         static const int MAX_SAMPLING_RADIUS_IN_PIXELS = 50;
+        static const int ZONAL_LANES                   = 4;       // independent accumulators in zonal stats loops
+        static const int MAX_ZONAL_HISTOGRAM_BINS      = 0x10000; // integer value range for histogram median
         static const int SLIDERULE_EPSG                = 7912;
 
+        static const int64_t DEFAULT_DATASET_CACHE_SIZE = 0x10000000; // 256MB of open datasets kept across requests
+        static const int64_t DATASET_BASE_FOOTPRINT     = 0x10000;    // estimated memory of an open dataset and its transform
+        static const int     MAX_CACHED_DATASETS        = 256;        // idle datasets kept open, well under the default descriptor limit
+        static const int     TILE_INDEX_BYTES           = 16;         // tiff offset and byte count held per block
+        static const int     VRT_SOURCE_BYTES           = 1024;       // description of one source held by a vrt
+        static const int64_t MAX_VRT_FOOTPRINT          = 0x1000000;  // 16MB, vrt sources are opened and closed on demand
+
+        static const int     PREFETCH_THREADS           = 8;
+        static const int     MAX_PREFETCH_BLOCKS        = 64;         // blocks prefetched ahead of one batch of points
+        static const int64_t MAX_PREFETCH_BYTES         = 0x400000;   // stays well within CPL_VSIL_CURL_CACHE_SIZE
+        static const int     PREFETCH_QUEUE_DEPTH       = 2 * MAX_PREFETCH_BLOCKS; // batches post no more once the pool falls behind
+
+        static const int     MAX_CACHED_TRANSFORMS      = 64;
+
+        static const int     RESAMPLE_KERNEL_RADIUS     = 3;          // widest GDAL resampling kernel (Lanczos), in output pixels
+
         /*--------------------------------------------------------------------
          * Typedefs
          *--------------------------------------------------------------------*/
@@ -123,8 +145,10 @@ class GdalRaster
         virtual           ~GdalRaster     (void);
         void               open           (void);
         void               samplePOI      (const Point& poi);
+        void               samplePOIs     (const std::vector<Point>& pois, std::vector<RasterSample>& samples, std::vector<bool>& valid);
         const std::string& getFileName    (void) { return fileName;}
         RasterSample&      getSample      (void) { return sample; }
+        void               setSample      (const RasterSample& _sample, bool valid) { sample = _sample; _sampled = valid; } /* Presents one point of a batch as the last sample */
         bool               sampled        (void) { return _sampled; }
         int                getRows        (void) { return rows; }
         int                getCols        (void) { return cols; }
@@ -138,6 +162,9 @@ class GdalRaster
         static void        setCRSfromWkt  (OGRSpatialReference& sref, const char* wkt);
         static std::string getUUID        (void);
         static void        initAwsAccess  (GeoParms* _parms);
+        static void        init           (void);
+        static void        deinit         (void);
+        static int         luaDatasetCache(lua_State* L);
 
     private:
 
@@ -145,10 +172,67 @@ class GdalRaster
         * Constants
         *--------------------------------------------------------------------*/
 
+        /*--------------------------------------------------------------------
+        * Typedefs
+        *--------------------------------------------------------------------*/
+
+        /* Closed form of a polar stereographic projection on the source datum */
+        typedef struct {
+            bool        enabled;
+            bool        south;
+            double      e;          /* Ellipsoid eccentricity */
+            double      scale;      /* Radius per unit of conformal colatitude */
+            double      lon0;       /* Radians */
+            double      falseEasting;
+            double      falseNorthing;
+        } polar_stereo_t;
+
+        typedef struct {
+            OGRCoordinateTransformation* transf;    /* Template cloned for each raster */
+            polar_stereo_t               polar;
+        } transform_entry_t;
+
+        typedef struct {
+            const char*                  key;       /* File name and transform options */
+            GDALDataset*                 dset;
+            OGRCoordinateTransformation* transf;
+            polar_stereo_t               polar;
+            int64_t                      footprint; /* Estimated bytes held while open */
+            unsigned long                lruSeq;    /* Position in least recently used order */
+        } dataset_entry_t;
+
+        typedef struct {
+            char*       path;   /* Allocated by poster, freed by prefetch thread */
+            uint64_t    offset;
+            uint64_t    size;
+        } prefetch_task_t;
+
+        typedef struct {
+            uint64_t    block;  /* Block row in upper 32 bits, block column in lower */
+            uint32_t    index;  /* Index of point in caller's list */
+            int         col;
+            int         row;
+        } pixel_ref_t;
+
         /*--------------------------------------------------------------------
         * Data
         *--------------------------------------------------------------------*/
 
+        static Mutex                        datasetMut;
+        static Dictionary<dataset_entry_t*> datasetCache;   /* Idle datasets by key */
+        static Ordering<dataset_entry_t*>   datasetLru;     /* Idle datasets, oldest first */
+        static int64_t                      datasetBytes;
+        static int64_t                      datasetBudget;
+        static unsigned long                datasetSeq;
+
+        static Mutex                        transformMut;
+        static Dictionary<transform_entry_t*> transformCache; /* By target CRS and transform options */
+
+        static Publisher*                   prefetchPub;
+        static Subscriber*                  prefetchSub;
+        static bool                         prefetchActive;
+        static Thread**                     prefetchPids;
+
         GeoParms*      parms;
         bool          _sampled;
         double         gpsTime;  /* Time the raster data was collected and/or generated */
@@ -158,12 +242,14 @@ class GdalRaster
         double         verticalShift;  /* Calculated for last POI transformed to target CRS */
 
         OGRCoordinateTransformation* transf;
+        polar_stereo_t      polar;
         OGRSpatialReference sourceCRS;
         OGRSpatialReference targetCRS;
         overrideCRS_t       overrideCRS;
 
         std::string     fileName;
         GDALDataset    *dset;
+        dataset_entry_t* datasetEntry;  /* Set once dset is shared through the dataset cache */
         GDALRasterBand* band;
         bool            dataIsElevation;
         uint32_t        rows;
@@ -172,18 +258,54 @@ class GdalRaster
         bbox_t          bbox;
         uint32_t        radiusInPixels;
         double          invGeoTrnasform[6];
+        int             xBlockSize;
+        int             yBlockSize;
+        int64_t         resampleKey;    /* Window origin of last resampled value, -1 if none */
+        double          resampleValue;  /* Resampled value of that window, before vertical shift */
+        GDALDataset*    windowDset;     /* In-memory copy of the pixels around a run of points, NULL if none */
+        int             windowOverview; /* Overview the copy was read from, -1 for full resolution */
+        int             windowCol;      /* Origin and size of the copy in pixels of that overview */
+        int             windowRow;
+        int             windowCols;
+        int             windowRows;
+        std::vector<uint8_t>  windowData;
+        std::vector<uint32_t> zonalSpans;     /* Half width of circular mask for each window row */
+        std::vector<double>   zonalWindow;
+        std::vector<double>   zonalSamples;
+        std::vector<uint32_t> zonalHistogram;
 
         /*--------------------------------------------------------------------
         * Methods
         *--------------------------------------------------------------------*/
 
         void        readPixel           (const Point& poi);
+        double      readBlockValue      (const void* data, int offset);
+        GDALRasterBlock* lockBlock      (int xblk, int yblk);
         void        resamplePixel       (const Point& poi);
+        void        resampleKernel      (int& windowSize, int& offset);
+        void        loadWindow          (const std::vector<pixel_ref_t>& pixels, size_t start, size_t end);
+        bool        readWindow          (int col, int row, int windowSize, const GDALRasterIOExtraArg* args, double* value);
+        void        clearWindow         (void);
         void        computeZonalStats   (const Point& poi);
+        void        buildZonalMask      (void);
+        double      zonalMedian         (double min, double max);
         inline bool nodataCheck         (void);
         void        createTransform     (void);
+        bool        initPolarStereo     (void);
+        void        transformPoints     (int n, double* x, double* y, double* z, int* success);
+        std::string datasetKey          (void);
+        int64_t     datasetFootprint    (void);
+        bool        driverIs            (const char* name);
+        static dataset_entry_t* checkoutDataset (const std::string& key);
+        static void checkinDataset      (dataset_entry_t* entry);
+        static void closeDataset        (dataset_entry_t* entry);
+        static void evictDatasets       (void);
+        void        prefetchBlocks      (const std::vector<pixel_ref_t>& pixels);
+        void        adviseBlocks        (const std::vector<pixel_ref_t>& pixels);
+        static void* prefetchThread     (void* param);
         int         radius2pixels       (int _radius);
         inline bool containsWindow      (int col, int row, int maxCol, int maxRow, int windowSize);
+        inline void toPixel             (const Point& poi, int& col, int& row);
         inline void readRasterWithRetry (int col, int row, int colSize, int rowSize,
                                          void* data, int dataColSize, int dataRowSize, GDALRasterIOExtraArg *args);
 };
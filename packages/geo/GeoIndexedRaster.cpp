@@ -36,6 +36,7 @@
 #include "GeoIndexedRaster.h"
 
 #include <algorithm>
+#include <cmath>
 #include <gdal.h>
 #include <gdalwarper.h>
 #include <gdal_priv.h>
@@ -50,6 +51,15 @@
 const char* GeoIndexedRaster::FLAGS_TAG = "Fmask";
 const char* GeoIndexedRaster::VALUE_TAG = "Value";
 
+Publisher*  GeoIndexedRaster::readerPub = NULL;
+Subscriber* GeoIndexedRaster::readerSub = NULL;
+bool        GeoIndexedRaster::readerActive = false;
+Thread**    GeoIndexedRaster::readerPids = NULL;
+int         GeoIndexedRaster::readerPoolSize = 0;
+
+Mutex                                       GeoIndexedRaster::indexMut;
+Dictionary<GeoIndexedRaster::geo_index_t*>  GeoIndexedRaster::indexCache;
+
 /******************************************************************************
  * PUBLIC METHODS
  ******************************************************************************/
@@ -59,6 +69,16 @@ const char* GeoIndexedRaster::VALUE_TAG = "Value";
  *----------------------------------------------------------------------------*/
 void GeoIndexedRaster::init (void)
 {
+    /* Start Reader Thread Pool */
+    readerPub = new Publisher(NULL);
+    readerSub = new Subscriber(*readerPub);
+    readerActive = true;
+    readerPoolSize = MIN(MAX(OsApi::nproc(), 1) * READERS_PER_CPU, MAX_READER_THREADS);
+    readerPids = new Thread* [readerPoolSize];
+    for(int t = 0; t < readerPoolSize; t++)
+    {
+        readerPids[t] = new Thread(readingThread, NULL);
+    }
 }
 
 /*----------------------------------------------------------------------------
@@ -66,6 +86,43 @@ void GeoIndexedRaster::init (void)
  *----------------------------------------------------------------------------*/
 void GeoIndexedRaster::deinit (void)
 {
+    readerActive = false;
+    for(int t = 0; t < readerPoolSize; t++)
+    {
+        delete readerPids[t];
+    }
+    if(readerPids) delete [] readerPids;
+
+    /* Run tasks still queued so samplers waiting on them complete */
+    if(readerSub)
+    {
+        read_task_t task;
+        while(readerSub->receiveCopy(&task, sizeof(read_task_t), IO_CHECK) > 0)
+        {
+            readRasterTask(task);
+        }
+    }
+
+    if(readerSub) delete readerSub;
+    if(readerPub) delete readerPub;
+    readerPids = NULL;
+    readerSub = NULL;
+    readerPub = NULL;
+    readerPoolSize = 0;
+
+    /* Free cached index files */
+    indexMut.lock();
+    {
+        geo_index_t* index;
+        const char* key = indexCache.first(&index);
+        while(key != NULL)
+        {
+            deleteGeoIndex(index);
+            key = indexCache.next(&index);
+        }
+        indexCache.clear();
+    }
+    indexMut.unlock();
 }
 
 
@@ -110,30 +167,183 @@ void GeoIndexedRaster::getSamples(double lon, double lat, double height, int64_t
 
 
 /*----------------------------------------------------------------------------
- * Destructor
+ * getSamples - batch of points
+ *
+ *  Raster groups are found for every point first, then each raster samples
+ *  all of the points that fall on it with one samplePOIs call on the reader
+ *  pool, and finally the samples of each point are assembled group by group
+ *  as they are for a single point
  *----------------------------------------------------------------------------*/
-GeoIndexedRaster::~GeoIndexedRaster(void)
+void GeoIndexedRaster::getSamples(const std::vector<point_t>& points, std::vector<RasterSample>& slist, std::vector<uint32_t>& counts, void* param)
 {
-    /* Terminate all reader threads */
-    List<reader_t*>::Iterator reader_iter(readers);
-    for(int i = 0; i < reader_iter.length; i++)
+    std::ignore = param;
+
+    const size_t n = points.size();
+    counts.assign(n, 0);
+
+    std::vector<std::vector<rasters_group_t*>> pointGroups(n);
+    Dictionary<batch_raster_t*> batches(MAX_READER_THREADS);
+
+    samplingMutex.lock();
+    try
     {
-        reader_t* reader = readers[i];
-        if(reader->thread != NULL)
+        invalidateCache();
+        emptyGroupsList();
+
+        /* Find raster groups of every point and the points of every raster */
+        for(size_t i = 0; i < n; i++)
+        {
+            const point_t& point = points[i];
+            GdalRaster::Point poi(point.lon, point.lat, point.height);
+
+            if(geoIndex == NULL)
+                openGeoIndex(point.lon, point.lat);
+
+            if(!withinExtent(poi))
+            {
+                openGeoIndex(point.lon, point.lat);
+                if(!withinExtent(poi))
+                    continue;
+            }
+
+            if(findRasters(poi) && filterRasters(point.gps))
+            {
+                /* Rasters are created while the index of this point is open */
+                enableRasters();
+
+                Ordering<rasters_group_t*>::Iterator group_iter(groupList);
+                for(int g = 0; g < group_iter.length; g++)
+                {
+                    rasters_group_t* rgroup = group_iter[g].value;
+                    for(const auto& rinfo: rgroup->infovect)
+                    {
+                        batch_raster_t* batch;
+                        if(!batches.find(rinfo.fileName.c_str(), &batch))
+                        {
+                            batch = new batch_raster_t;
+                            batches.add(rinfo.fileName.c_str(), batch);
+                        }
+                        if(batch->indices.empty() || batch->indices.back() != i)
+                        {
+                            batch->indices.push_back(static_cast<uint32_t>(i));
+                            batch->pois.push_back(GdalRaster::Point(point.lon, point.lat, point.height));
+                        }
+                    }
+                    pointGroups[i].push_back(rgroup);
+                }
+            }
+
+            /* Groups now belong to the point */
+            groupList.clear();
+        }
+
+        /* Drop rasters of earlier sample runs not needed by this batch */
+        pruneCache();
+
+        /* Give each raster its points on the reader pool */
+        read_job_t job;
+        job.remaining = 0;
+        job.sampled = 0;
+
+        cacheitem_t* item;
+        const char* key = cache.first(&item);
+        while(key != NULL)
+        {
+            if(item->enabled) job.remaining++;
+            key = cache.next(&item);
+        }
+
+        key = cache.first(&item);
+        while(key != NULL)
         {
-            reader->sync->lock();
+            if(item->enabled)
             {
-                reader->raster = NULL;  /* No raster to read     */
-                reader->run    = false; /* Set run flag to false */
-                reader->sync->signal(DATA_TO_SAMPLE, Cond::NOTIFY_ONE);
+                batch_raster_t* batch = NULL;
+                batches.find(key, &batch);
+                read_task_t task = {
+                    .job = &job,
+                    .raster = item->raster,
+                    .poi = NULL,
+                    .batch = batch
+                };
+
+                /* Read Locally if Pool is Unavailable */
+                if(!readerActive || readerPub->postCopy(&task, sizeof(read_task_t), IO_CHECK) <= 0)
+                {
+                    readRasterTask(task);
+                }
             }
-            reader->sync->unlock();
+            key = cache.next(&item);
+        }
 
-            delete reader->thread; /* delete thread waits on thread to join */
-            delete reader->sync;
+        job.complete.lock();
+        {
+            while(job.remaining > 0)
+                job.complete.wait(0, SYS_TIMEOUT);
         }
+        job.complete.unlock();
+
+        /* Assemble samples point by point, each raster presents the point's sample as its last one */
+        for(size_t i = 0; i < n; i++)
+        {
+            if(pointGroups[i].empty()) continue;
+
+            for(const rasters_group_t* rgroup: pointGroups[i])
+            {
+                for(const auto& rinfo: rgroup->infovect)
+                {
+                    batch_raster_t* batch;
+                    if(!cache.find(rinfo.fileName.c_str(), &item) || !batches.find(rinfo.fileName.c_str(), &batch))
+                        continue;
+
+                    auto entry = std::lower_bound(batch->indices.begin(), batch->indices.end(), static_cast<uint32_t>(i));
+                    if(entry == batch->indices.end() || *entry != i)
+                        continue;
+
+                    const size_t k = entry - batch->indices.begin();
+                    item->raster->setSample(batch->samples[k], batch->valid[k]);
+                }
+            }
+
+            const size_t before = slist.size();
+            for(const rasters_group_t* rgroup: pointGroups[i])
+            {
+                uint32_t flags = 0;
+
+                /* Get flags value for this group of rasters */
+                if(parms->flags_file)
+                    flags = getGroupFlags(rgroup);
+
+                getGroupSamples(rgroup, slist, flags);
+            }
+            counts[i] = slist.size() - before;
+        }
+    }
+    catch (const RunTimeException &e)
+    {
+        mlog(e.level(), "Error getting samples: %s", e.what());
+    }
+    samplingMutex.unlock();
+
+    /* Clean Up */
+    for(std::vector<rasters_group_t*>& groups: pointGroups)
+    {
+        for(rasters_group_t* rgroup: groups) delete rgroup;
     }
+    batch_raster_t* batch;
+    const char* key = batches.first(&batch);
+    while(key != NULL)
+    {
+        delete batch;
+        key = batches.next(&batch);
+    }
+}
 
+/*----------------------------------------------------------------------------
+ * Destructor
+ *----------------------------------------------------------------------------*/
+GeoIndexedRaster::~GeoIndexedRaster(void)
+{
     /* Close all rasters */
     cacheitem_t* item;
     const char* key  = cache.first(&item);
@@ -146,7 +356,7 @@ GeoIndexedRaster::~GeoIndexedRaster(void)
     }
 
     emptyGroupsList();
-    emptyFeaturesList();
+    if(geoIndex) releaseGeoIndex(geoIndex);
 }
 
 /******************************************************************************
@@ -159,6 +369,7 @@ GeoIndexedRaster::~GeoIndexedRaster(void)
 GeoIndexedRaster::GeoIndexedRaster(lua_State *L, GeoParms* _parms, GdalRaster::overrideCRS_t cb):
     RasterObject (L, _parms),
     cache        (MAX_READER_THREADS),
+    geoIndex     (NULL),
     crscb        (cb)
 {
     /* Add Lua Functions */
@@ -259,6 +470,94 @@ double GeoIndexedRaster::getGmtDate(const OGRFeature* feature, const char* field
     return static_cast<double>(TimeLib::gmt2gpstime(gmtDate));
 }
 
+/*----------------------------------------------------------------------------
+ * getFeatureTime
+ *----------------------------------------------------------------------------*/
+double GeoIndexedRaster::getFeatureTime(const OGRFeature* feature)
+{
+    TimeLib::gmt_time_t gmtDate;
+    return getGmtDate(feature, "datetime", gmtDate);
+}
+
+/*----------------------------------------------------------------------------
+ * findFeatures
+ *
+ *  Returns features whose envelope contains the point, in index file order;
+ *  callers still test the feature geometry itself
+ *----------------------------------------------------------------------------*/
+void GeoIndexedRaster::findFeatures(const GdalRaster::Point& poi, std::vector<const OGRFeature*>& features)
+{
+    if(geoIndex == NULL || geoIndex->nodes.empty()) return;
+
+    const geo_index_t* index = geoIndex;
+    std::vector<uint32_t> ids;
+
+    auto contains = [&poi](const OGREnvelope& env) {
+        return (poi.x >= env.MinX) && (poi.x <= env.MaxX) && (poi.y >= env.MinY) && (poi.y <= env.MaxY);
+    };
+
+    /* Temporal filter is applied again to raster groups, only drop features clearly out of range */
+    bool timeFilter = parms->filter_time;
+    int64_t startGps = 0;
+    int64_t stopGps  = 0;
+    if(timeFilter)
+    {
+        startGps = TimeLib::gmt2gpstime(parms->start_time) - 1000;
+        stopGps  = TimeLib::gmt2gpstime(parms->stop_time) + 1000;
+
+        auto earlier = [index](uint32_t id, int64_t gps) { return index->gpsTimes[id] < gps; };
+        auto later   = [index](int64_t gps, uint32_t id) { return gps < index->gpsTimes[id]; };
+        auto lo = std::lower_bound(index->byTime.begin(), index->byTime.end(), startGps, earlier);
+        auto hi = std::upper_bound(lo, index->byTime.end(), stopGps, later);
+
+        /* Narrow time window, scan it instead of the tree */
+        if(static_cast<size_t>(hi - lo) * INDEX_TIME_SCAN_RATIO < index->features.size())
+        {
+            for(auto it = lo; it != hi; it++)
+            {
+                if(contains(index->envelopes[*it])) ids.push_back(*it);
+            }
+            timeFilter = false;
+            index = NULL;
+        }
+    }
+
+    /* Walk the tree down from the root */
+    if(index)
+    {
+        std::vector<uint32_t> stack;
+        stack.push_back(index->nodes.size() - 1);
+        while(!stack.empty())
+        {
+            const index_node_t& node = index->nodes[stack.back()];
+            stack.pop_back();
+            if(!contains(node.env)) continue;
+
+            for(uint32_t i = node.first; i < node.first + node.count; i++)
+            {
+                if(!node.leaf)
+                {
+                    stack.push_back(i);
+                    continue;
+                }
+
+                const uint32_t id = index->slots[i];
+                if(!contains(index->envelopes[id])) continue;
+                if(timeFilter && (index->gpsTimes[id] < startGps || index->gpsTimes[id] > stopGps)) continue;
+                ids.push_back(id);
+            }
+        }
+    }
+
+    /* Keep raster groups in the order of the index file */
+    std::sort(ids.begin(), ids.end());
+    features.reserve(features.size() + ids.size());
+    for(uint32_t id: ids)
+    {
+        features.push_back(geoIndex->features[id]);
+    }
+}
+
 /*----------------------------------------------------------------------------
  * openGeoIndex
  *----------------------------------------------------------------------------*/
@@ -268,58 +567,50 @@ void GeoIndexedRaster::openGeoIndex(double lon, double lat)
     getIndexFile(newFile, lon, lat);
 
     /* Trying to open the same file? */
-    if(featuresList.isempty() && newFile == indexFile)
+    if(geoIndex && newFile == geoIndex->file)
         return;
 
-    GDALDataset* dset = NULL;
-    try
-    {
-        emptyFeaturesList();
+    if(geoIndex) releaseGeoIndex(geoIndex);
+    geoIndex = NULL;
 
-        /* Open new vector data set*/
-        dset = (GDALDataset *)GDALOpenEx(newFile.c_str(), GDAL_OF_VECTOR | GDAL_OF_READONLY, NULL, NULL, NULL);
-        if (dset == NULL)
-            throw RunTimeException(ERROR, RTE_ERROR, "Failed to open vector index file (%.2lf, %.2lf), file: %s:", lon, lat, newFile.c_str());
-
-        indexFile = newFile;
-        OGRLayer* layer = dset->GetLayer(0);
-        CHECKPTR(layer);
-
-        /*
-         * Clone all features and store them for performance/speed of feature lookup
-         */
-        layer->ResetReading();
-        while(OGRFeature* feature = layer->GetNextFeature())
+    /* Use index already loaded by another raster object */
+    indexMut.lock();
+    {
+        if(indexCache.find(newFile.c_str(), &geoIndex))
         {
-            OGRFeature* fp = feature->Clone();
-            featuresList.add(fp);
-            OGRFeature::DestroyFeature(feature);
+            geoIndex->refs++;
+            geoIndex->useTime = TimeLib::latchtime();
         }
+    }
+    indexMut.unlock();
 
-        cols = dset->GetRasterXSize();
-        rows = dset->GetRasterYSize();
-
+    if(geoIndex == NULL)
+    {
+        geo_index_t* index = loadGeoIndex(newFile);
 
-        OGREnvelope env;
-        OGRErr err = layer->GetExtent(&env);
-        if(err == OGRERR_NONE )
+        indexMut.lock();
         {
-            bbox.lon_min = env.MinX;
-            bbox.lat_min = env.MinY;
-            bbox.lon_max = env.MaxX;
-            bbox.lat_max = env.MaxY;
-            mlog(DEBUG, "Layer extent/bbox: (%.6lf, %.6lf), (%.6lf, %.6lf)", bbox.lon_min, bbox.lat_min, bbox.lon_max, bbox.lat_max);
+            /* Another raster object may have loaded the same file meanwhile */
+            if(indexCache.find(newFile.c_str(), &geoIndex))
+            {
+                geoIndex->refs++;
+                geoIndex->useTime = TimeLib::latchtime();
+            }
+            else
+            {
+                geoIndex = index;
+                indexCache.add(newFile.c_str(), geoIndex);
+                index = NULL;
+            }
         }
+        indexMut.unlock();
 
-        GDALClose((GDALDatasetH)dset);
-        mlog(DEBUG, "Loaded index file features from: %s", newFile.c_str());
-    }
-    catch (const RunTimeException &e)
-    {
-        if(dset) GDALClose((GDALDatasetH)dset);
-        emptyFeaturesList();
-        throw;
+        if(index) deleteGeoIndex(index);
     }
+
+    bbox = geoIndex->bbox;
+    rows = geoIndex->rows;
+    cols = geoIndex->cols;
 }
 
 
@@ -328,43 +619,50 @@ void GeoIndexedRaster::openGeoIndex(double lon, double lat)
  *----------------------------------------------------------------------------*/
 void GeoIndexedRaster::sampleRasters(GdalRaster::Point& poi)
 {
-    /* Create additional reader threads if needed */
-    createThreads();
+    read_job_t job;
+    job.remaining = 0;
+    job.sampled = 0;
 
-    /* For each raster which is marked to be sampled, give it to the reader thread */
-    int signaledReaders = 0;
-    int i = 0;
+    /* Count rasters marked to be sampled before any task can complete */
     cacheitem_t* item;
-
     const char* key = cache.first(&item);
     while(key != NULL)
+    {
+        if(item->enabled) job.remaining++;
+        key = cache.next(&item);
+    }
+
+    /* Give each raster to the reader pool */
+    key = cache.first(&item);
+    while(key != NULL)
     {
         if(item->enabled)
         {
-            reader_t* reader = readers[i++];
-            reader->sync->lock();
+            read_task_t task = {
+                .job = &job,
+                .raster = item->raster,
+                .poi = &poi,
+                .batch = NULL
+            };
+
+            /* Read Locally if Pool is Unavailable */
+            if(!readerActive || readerPub->postCopy(&task, sizeof(read_task_t), IO_CHECK) <= 0)
             {
-                reader->raster = item->raster;
-                reader->poi = poi;
-                reader->sync->signal(DATA_TO_SAMPLE, Cond::NOTIFY_ONE);
-                signaledReaders++;
+                readRasterTask(task);
             }
-            reader->sync->unlock();
         }
         key = cache.next(&item);
     }
 
     /* Wait for readers to finish sampling */
-    for(int j = 0; j < signaledReaders; j++)
+    job.complete.lock();
     {
-        reader_t* reader = readers[j];
-        reader->sync->lock();
-        {
-            while(reader->raster != NULL)
-                reader->sync->wait(DATA_SAMPLED, SYS_TIMEOUT);
-        }
-        reader->sync->unlock();
+        while(job.remaining > 0)
+            job.complete.wait(0, SYS_TIMEOUT);
     }
+    job.complete.unlock();
+
+    sampledRastersCnt = job.sampled;
 }
 
 /*----------------------------------------------------------------------------
@@ -375,11 +673,11 @@ int GeoIndexedRaster::sample(double lon, double lat, double height, int64_t gps)
     invalidateCache();
     emptyGroupsList();
 
-    /* Clear atomic counter - incremented later by reader threads on sucessful sample */
-    sampledRastersCnt.store(0);
+    /* Clear counter - set once reader threads finish sampling */
+    sampledRastersCnt = 0;
 
     /* Initial call, open index file if not already opened */
-    if(featuresList.isempty())
+    if(geoIndex == NULL)
         openGeoIndex(lon, lat);
 
     GdalRaster::Point poi(lon, lat, height);
@@ -502,71 +800,64 @@ int GeoIndexedRaster::luaCellSize(lua_State *L)
  *----------------------------------------------------------------------------*/
 void* GeoIndexedRaster::readingThread(void *param)
 {
-    reader_t *reader = (reader_t*)param;
-    bool run = true;
+    std::ignore = param;
 
-    while(run)
+    while(readerActive)
     {
-        reader->sync->lock();
+        read_task_t task;
+        int recv_status = readerSub->receiveCopy(&task, sizeof(read_task_t), SYS_TIMEOUT);
+        if(recv_status > 0)
         {
-            /* Wait for raster to work on */
-            while((reader->raster == NULL) && reader->run)
-                reader->sync->wait(DATA_TO_SAMPLE, SYS_TIMEOUT);
+            readRasterTask(task);
         }
-        reader->sync->unlock();
-
-        if(reader->raster != NULL)
+        else if(recv_status != MsgQ::STATE_TIMEOUT)
         {
-            reader->raster->samplePOI(reader->poi);
-            if(reader->raster->sampled())
-            {
-                reader->obj->sampledRastersCnt.fetch_add(1, std::memory_order_relaxed);
-            }
-
-            reader->sync->lock();
-            {
-                reader->raster = NULL; /* Done with this raster */
-                reader->sync->signal(DATA_SAMPLED, Cond::NOTIFY_ONE);
-            }
-            reader->sync->unlock();
+            mlog(CRITICAL, "Failed to receive raster read task: %d", recv_status);
+            break;
         }
-
-        run = reader->run;
     }
 
     return NULL;
 }
 
 /*----------------------------------------------------------------------------
- * createThreads
+ * readRasterTask
  *----------------------------------------------------------------------------*/
-void GeoIndexedRaster::createThreads(void)
+void GeoIndexedRaster::readRasterTask(read_task_t& task)
 {
-    int threadsNeeded = cache.length();
-    int threadsNow    = readers.length();
-    int newThreadsCnt = threadsNeeded - threadsNow;
-
-    if(threadsNeeded <= threadsNow)
-        return;
+    if(task.batch)
+    {
+        task.raster->samplePOIs(task.batch->pois, task.batch->samples, task.batch->valid);
+    }
+    else
+    {
+        task.raster->samplePOI(*task.poi);
+    }
+    bool sampled = task.raster->sampled();
 
-    for(int i = 0; i < newThreadsCnt; i++)
+    read_job_t* job = task.job;
+    job->complete.lock();
     {
-        reader_t* r = new reader_t;
-        r->obj    = this;
-        r->poi.clear();
-        r->raster = NULL;
-        r->run    = true;
-        r->sync   = new Cond(NUM_SYNC_SIGNALS);
-        r->thread = new Thread(readingThread, r);
-        readers.add(r);
+        if(sampled) job->sampled++;
+        job->remaining--;
+        if(job->remaining == 0) job->complete.signal();
     }
-    assert(readers.length() == threadsNeeded);
+    job->complete.unlock();
 }
 
 /*----------------------------------------------------------------------------
  * updateCache
  *----------------------------------------------------------------------------*/
 void GeoIndexedRaster::updateCache(void)
+{
+    enableRasters();
+    pruneCache();
+}
+
+/*----------------------------------------------------------------------------
+ * enableRasters - marks rasters of the groups found to be sampled
+ *----------------------------------------------------------------------------*/
+void GeoIndexedRaster::enableRasters(void)
 {
     /* Cache contains items/rasters from previous sample run */
 
@@ -600,7 +891,13 @@ void GeoIndexedRaster::updateCache(void)
             }
         }
     }
+}
 
+/*----------------------------------------------------------------------------
+ * pruneCache
+ *----------------------------------------------------------------------------*/
+void GeoIndexedRaster::pruneCache(void)
+{
     /*
      * Maintain cache from getting too big.
      * Remove all cache items not needed for this sample run.
@@ -620,14 +917,6 @@ void GeoIndexedRaster::updateCache(void)
             key = cache.next(&item);
         }
     }
-
-    /* Check for max limit of concurent reading raster threads */
-    if(cache.length() > MAX_READER_THREADS)
-    {
-        throw RunTimeException(CRITICAL, RTE_ERROR,
-                               "Too many rasters to read: %d, max allowed: %d, limit your AOI or termporal range or use filters\n",
-                               cache.length(), MAX_READER_THREADS);
-    }
 }
 
 /*----------------------------------------------------------------------------
@@ -737,18 +1026,213 @@ bool GeoIndexedRaster::filterRasters(int64_t gps)
 }
 
 /*----------------------------------------------------------------------------
- * emptyFeaturesList
+ * loadGeoIndex
+ *----------------------------------------------------------------------------*/
+GeoIndexedRaster::geo_index_t* GeoIndexedRaster::loadGeoIndex(const std::string& file)
+{
+    GDALDataset* dset = NULL;
+    geo_index_t* index = new geo_index_t;
+    index->file = file;
+    index->bbox = {0, 0, 0, 0};
+    index->refs = 1;
+    index->useTime = TimeLib::latchtime();
+
+    try
+    {
+        /* Open new vector data set*/
+        dset = (GDALDataset *)GDALOpenEx(file.c_str(), GDAL_OF_VECTOR | GDAL_OF_READONLY, NULL, NULL, NULL);
+        if (dset == NULL)
+            throw RunTimeException(ERROR, RTE_ERROR, "Failed to open vector index file: %s:", file.c_str());
+
+        OGRLayer* layer = dset->GetLayer(0);
+        CHECKPTR(layer);
+
+        /*
+         * Clone all features and store them for performance/speed of feature lookup,
+         * features without a geometry can never contain a point
+         */
+        layer->ResetReading();
+        while(OGRFeature* feature = layer->GetNextFeature())
+        {
+            const OGRGeometry* geo = feature->GetGeometryRef();
+            if(geo)
+            {
+                OGREnvelope env;
+                geo->getEnvelope(&env);
+                index->features.push_back(feature->Clone());
+                index->envelopes.push_back(env);
+                index->gpsTimes.push_back(static_cast<int64_t>(getFeatureTime(feature)));
+            }
+            OGRFeature::DestroyFeature(feature);
+        }
+
+        index->cols = dset->GetRasterXSize();
+        index->rows = dset->GetRasterYSize();
+
+        OGREnvelope env;
+        OGRErr err = layer->GetExtent(&env);
+        if(err == OGRERR_NONE )
+        {
+            index->bbox.lon_min = env.MinX;
+            index->bbox.lat_min = env.MinY;
+            index->bbox.lon_max = env.MaxX;
+            index->bbox.lat_max = env.MaxY;
+            mlog(DEBUG, "Layer extent/bbox: (%.6lf, %.6lf), (%.6lf, %.6lf)", env.MinX, env.MinY, env.MaxX, env.MaxY);
+        }
+
+        GDALClose((GDALDatasetH)dset);
+        dset = NULL;
+
+        buildIndexTree(index);
+        mlog(DEBUG, "Loaded %ld index file features from: %s", index->features.size(), file.c_str());
+    }
+    catch (const RunTimeException &e)
+    {
+        if(dset) GDALClose((GDALDatasetH)dset);
+        deleteGeoIndex(index);
+        throw;
+    }
+
+    return index;
+}
+
+/*----------------------------------------------------------------------------
+ * buildIndexTree
+ *
+ *  Sort-Tile-Recursive packing: every level is sorted into tiles and packed
+ *  into full nodes, children of a node are contiguous in the nodes vector
  *----------------------------------------------------------------------------*/
-void GeoIndexedRaster::emptyFeaturesList(void)
+void GeoIndexedRaster::buildIndexTree(geo_index_t* index)
 {
-    if(featuresList.isempty()) return;
+    const uint32_t num_features = index->features.size();
+
+    /* Time ordering */
+    index->byTime.resize(num_features);
+    for(uint32_t id = 0; id < num_features; id++) index->byTime[id] = id;
+    std::stable_sort(index->byTime.begin(), index->byTime.end(), [index](uint32_t a, uint32_t b) {
+        return index->gpsTimes[a] < index->gpsTimes[b];
+    });
+
+    if(num_features == 0) return;
+
+    /* Pack features into leaf slots */
+    std::vector<index_node_t> level(num_features);
+    for(uint32_t id = 0; id < num_features; id++)
+    {
+        level[id] = {index->envelopes[id], id, 1, true};
+    }
+    strSort(level);
 
-    for(int i = 0; i < featuresList.length(); i++)
+    index->slots.resize(num_features);
+    for(uint32_t i = 0; i < num_features; i++)
+    {
+        index->slots[i] = level[i].first;
+    }
+
+    /* Build levels bottom up until a single root is left */
+    bool leaf = true;
+    uint32_t base = 0;
+    while(true)
+    {
+        std::vector<index_node_t> parents;
+        parents.reserve((level.size() + INDEX_NODE_CAPACITY - 1) / INDEX_NODE_CAPACITY);
+        for(uint32_t i = 0; i < level.size(); i += INDEX_NODE_CAPACITY)
+        {
+            index_node_t node = {level[i].env, base + i, MIN(static_cast<uint32_t>(INDEX_NODE_CAPACITY), static_cast<uint32_t>(level.size()) - i), leaf};
+            for(uint32_t j = i + 1; j < i + node.count; j++)
+            {
+                node.env.Merge(level[j].env);
+            }
+            parents.push_back(node);
+        }
+
+        level = std::move(parents);
+        strSort(level);
+        base = index->nodes.size();
+        index->nodes.insert(index->nodes.end(), level.begin(), level.end());
+        leaf = false;
+
+        if(level.size() == 1) break;
+    }
+}
+
+/*----------------------------------------------------------------------------
+ * strSort
+ *----------------------------------------------------------------------------*/
+void GeoIndexedRaster::strSort(std::vector<index_node_t>& level)
+{
+    const size_t num_nodes = (level.size() + INDEX_NODE_CAPACITY - 1) / INDEX_NODE_CAPACITY;
+    const size_t num_slices = static_cast<size_t>(ceil(sqrt(static_cast<double>(num_nodes))));
+    const size_t slice_size = num_slices * INDEX_NODE_CAPACITY;
+
+    /* Vertical slices by center x, then tiles by center y within each slice */
+    std::sort(level.begin(), level.end(), [](const index_node_t& a, const index_node_t& b) {
+        return (a.env.MinX + a.env.MaxX) < (b.env.MinX + b.env.MaxX);
+    });
+    for(size_t i = 0; i < level.size(); i += slice_size)
+    {
+        auto end = level.begin() + MIN(i + slice_size, level.size());
+        std::sort(level.begin() + i, end, [](const index_node_t& a, const index_node_t& b) {
+            return (a.env.MinY + a.env.MaxY) < (b.env.MinY + b.env.MaxY);
+        });
+    }
+}
+
+/*----------------------------------------------------------------------------
+ * releaseGeoIndex
+ *
+ *  Index files stay loaded for later requests, in-memory catalogs are unique
+ *  to their raster object and are freed as soon as it lets go of them
+ *----------------------------------------------------------------------------*/
+void GeoIndexedRaster::releaseGeoIndex(geo_index_t* index)
+{
+    std::vector<geo_index_t*> freed;
+
+    indexMut.lock();
+    {
+        index->refs--;
+        index->useTime = TimeLib::latchtime();
+        if(index->refs == 0 && index->file.compare(0, 8, "/vsimem/") == 0)
+        {
+            indexCache.remove(index->file.c_str());
+            freed.push_back(index);
+        }
+
+        /* Drop least recently used idle indexes */
+        int idle = 0;
+        geo_index_t* oldest = NULL;
+        geo_index_t* entry;
+        const char* key = indexCache.first(&entry);
+        while(key != NULL)
+        {
+            if(entry->refs == 0)
+            {
+                idle++;
+                if(!oldest || entry->useTime < oldest->useTime) oldest = entry;
+            }
+            key = indexCache.next(&entry);
+        }
+        if(idle > MAX_IDLE_GEO_INDEXES)
+        {
+            indexCache.remove(oldest->file.c_str());
+            freed.push_back(oldest);
+        }
+    }
+    indexMut.unlock();
+
+    for(geo_index_t* f: freed) deleteGeoIndex(f);
+}
+
+/*----------------------------------------------------------------------------
+ * deleteGeoIndex
+ *----------------------------------------------------------------------------*/
+void GeoIndexedRaster::deleteGeoIndex(geo_index_t* index)
+{
+    for(OGRFeature* feature: index->features)
     {
-        OGRFeature* feature = featuresList[i];
         OGRFeature::DestroyFeature(feature);
     }
-    featuresList.clear();
+    delete index;
 }
 
 /*----------------------------------------------------------------------------
@@ -39,6 +39,7 @@
 #include "GdalRaster.h"
 #include "RasterObject.h"
 #include "Ordering.h"
+#include "MsgQ.h"
 
 
 /******************************************************************************
@@ -54,6 +55,10 @@ class GeoIndexedRaster: public RasterObject
          *--------------------------------------------------------------------*/
 
         static const int   MAX_READER_THREADS = 200;
+        static const int   READERS_PER_CPU    = 4; // reads mostly wait on S3, so the pool oversubscribes cpus
+        static const int   INDEX_NODE_CAPACITY = 16;
+        static const int   INDEX_TIME_SCAN_RATIO = 8; // scan time index when window holds under 1/8 of features
+        static const int   MAX_IDLE_GEO_INDEXES = 16;
 
         static const char* FLAGS_TAG;
         static const char* VALUE_TAG;
@@ -76,13 +81,24 @@ class GeoIndexedRaster: public RasterObject
         } rasters_group_t;
 
         typedef struct {
-            GeoIndexedRaster* obj;
-            GdalRaster::Point poi;
-            Thread*     thread;
-            GdalRaster* raster;
-            Cond*       sync;
-            bool        run;
-        } reader_t;
+            Cond        complete;
+            int         remaining;  /* Rasters of this sample run still being read */
+            int         sampled;    /* Rasters that returned a sample */
+        } read_job_t;
+
+        typedef struct {
+            std::vector<uint32_t>          indices;  /* Points of the batch that fall on the raster, ascending */
+            std::vector<GdalRaster::Point> pois;
+            std::vector<RasterSample>      samples;  /* Per entry of pois */
+            std::vector<bool>              valid;
+        } batch_raster_t;
+
+        typedef struct {
+            read_job_t*              job;
+            GdalRaster*              raster;
+            const GdalRaster::Point* poi;
+            batch_raster_t*          batch;  /* Points of a batch, NULL to sample poi */
+        } read_task_t;
 
         typedef struct {
             bool        enabled;
@@ -90,6 +106,30 @@ class GeoIndexedRaster: public RasterObject
             GdalRaster* raster;
         } cacheitem_t;
 
+        typedef struct {
+            OGREnvelope env;
+            uint32_t    first;  /* First child node, or first slot for leaf nodes */
+            uint32_t    count;
+            bool        leaf;
+        } index_node_t;
+
+        /* Features of an index file with a packed STR-tree over their
+         * envelopes and a time ordering, shared by all rasters using the file */
+        typedef struct {
+            std::string                 file;
+            std::vector<OGRFeature*>    features;   /* index file order */
+            std::vector<OGREnvelope>    envelopes;  /* per feature */
+            std::vector<int64_t>        gpsTimes;   /* per feature */
+            std::vector<uint32_t>       slots;      /* feature ids in leaf order */
+            std::vector<index_node_t>   nodes;      /* root is last */
+            std::vector<uint32_t>       byTime;     /* feature ids sorted by gps time */
+            GdalRaster::bbox_t          bbox;
+            uint32_t                    rows;
+            uint32_t                    cols;
+            int                         refs;
+            double                      useTime;
+        } geo_index_t;
+
 
         /*--------------------------------------------------------------------
          * Methods
@@ -98,6 +138,7 @@ class GeoIndexedRaster: public RasterObject
         static void     init              (void);
         static void     deinit            (void);
         void            getSamples        (double lon, double lat, double height, int64_t gps, std::vector<RasterSample>& slist, void* param=NULL) final;
+        void            getSamples        (const std::vector<point_t>& points, std::vector<RasterSample>& slist, std::vector<uint32_t>& counts, void* param=NULL) final;
         virtual        ~GeoIndexedRaster  (void);
 
     protected:
@@ -110,6 +151,8 @@ class GeoIndexedRaster: public RasterObject
         virtual void    getGroupSamples       (const rasters_group_t* rgroup, std::vector<RasterSample>& slist, uint32_t flags);
         uint32_t        getGroupFlags         (const rasters_group_t* rgroup);
         double          getGmtDate            (const OGRFeature* feature, const char* field,  TimeLib::gmt_time_t& gmtDate);
+        virtual double  getFeatureTime        (const OGRFeature* feature);
+        void            findFeatures          (const GdalRaster::Point& poi, std::vector<const OGRFeature*>& features);
         void            openGeoIndex          (double lon = 0, double lat = 0);
         virtual void    getIndexFile          (std::string& file, double lon, double lat) = 0;
         virtual bool    findRasters           (GdalRaster::Point& poi) = 0;
@@ -119,7 +162,7 @@ class GeoIndexedRaster: public RasterObject
         /* Inline for performance */
         bool withinExtent(GdalRaster::Point& poi)
         {
-            return ((featuresList.length() > 0) &&
+            return ((geoIndex != NULL) && !geoIndex->features.empty() &&
                     (poi.x >= bbox.lon_min) && (poi.x <= bbox.lon_max) &&
                     (poi.y >= bbox.lat_min) && (poi.y <= bbox.lat_max));
         }
@@ -132,7 +175,6 @@ class GeoIndexedRaster: public RasterObject
         Mutex                       samplingMutex;
         Ordering<rasters_group_t*>  groupList;
         Dictionary<cacheitem_t*>    cache;
-        List<OGRFeature*>           featuresList;
         bool                        forceNotElevation;
 
     private:
@@ -141,22 +183,27 @@ class GeoIndexedRaster: public RasterObject
          * Constants
          *--------------------------------------------------------------------*/
 
-        static const int DATA_TO_SAMPLE   = 0;
-        static const int DATA_SAMPLED     = 1;
-        static const int NUM_SYNC_SIGNALS = 2;
-
         /*--------------------------------------------------------------------
          * Data
          *--------------------------------------------------------------------*/
 
-        List<reader_t*>           readers;
+        static Publisher*         readerPub;
+        static Subscriber*        readerSub;
+        static bool               readerActive;
+        static Thread**           readerPids; // thread pool
+        static int                readerPoolSize;
+
+        static Mutex                     indexMut;
+        static Dictionary<geo_index_t*>  indexCache;
+
+        geo_index_t*              geoIndex;
+
         GdalRaster::overrideCRS_t crscb;
 
-        std::string               indexFile;
         GdalRaster::bbox_t        bbox;
         uint32_t                  rows;
         uint32_t                  cols;
-        std::atomic_int           sampledRastersCnt;
+        int                       sampledRastersCnt;
 
         /*--------------------------------------------------------------------
          * Methods
@@ -167,12 +214,19 @@ class GeoIndexedRaster: public RasterObject
         static int luaCellSize(lua_State* L);
 
         static void* readingThread (void *param);
+        static void  readRasterTask(read_task_t& task);
 
-        void       createThreads           (void);
         void       updateCache             (void);
+        void       enableRasters           (void);
+        void       pruneCache              (void);
         void       invalidateCache         (void);
         bool       filterRasters           (int64_t gps);
-        void       emptyFeaturesList       (void);
+
+        geo_index_t*    loadGeoIndex       (const std::string& file);
+        static void     buildIndexTree     (geo_index_t* index);
+        static void     strSort            (std::vector<index_node_t>& level);
+        static void     releaseGeoIndex    (geo_index_t* index);
+        static void     deleteGeoIndex     (geo_index_t* index);
         void       emptyGroupsList         (void);
 };
 
@@ -45,6 +45,9 @@ const char* GeoJsonRaster::FILEDATA_KEY   = "data";
 const char* GeoJsonRaster::FILELENGTH_KEY = "length";
 const char* GeoJsonRaster::CELLSIZE_KEY   = "cellsize";
 
+Mutex                                   GeoJsonRaster::maskMut;
+Dictionary<GeoJsonRaster::mask_t*>      GeoJsonRaster::maskCache;
+
 /******************************************************************************
  * PUBLIC METHODS
  ******************************************************************************/
@@ -101,11 +104,32 @@ GeoJsonRaster* GeoJsonRaster::create (lua_State* L, int index)
 }
 
 
+/*----------------------------------------------------------------------------
+ * deinit
+ *----------------------------------------------------------------------------*/
+void GeoJsonRaster::deinit (void)
+{
+    maskMut.lock();
+    {
+        mask_t* entry;
+        const char* key = maskCache.first(&entry);
+        while(key != NULL)
+        {
+            delete entry;
+            key = maskCache.next(&entry);
+        }
+        maskCache.clear();
+    }
+    maskMut.unlock();
+}
+
 /*----------------------------------------------------------------------------
  * includes
  *----------------------------------------------------------------------------*/
 bool GeoJsonRaster::includes(double lon, double lat, double height)
 {
+    if(useMask) return maskIncludes(lon, lat);
+
     std::vector<RasterSample> slist;
     int sampleCnt = 0;
 
@@ -126,12 +150,34 @@ bool GeoJsonRaster::includes(double lon, double lat, double height)
     return (static_cast<int>(slist[0].value) == RASTER_PIXEL_ON);
 }
 
+/*----------------------------------------------------------------------------
+ * includes - inclusion of each coordinate in arrays of n coordinates
+ *----------------------------------------------------------------------------*/
+void GeoJsonRaster::includes(const double* lon, const double* lat, long n, bool* inclusion)
+{
+    if(useMask)
+    {
+        for(long i = 0; i < n; i++)
+        {
+            inclusion[i] = maskIncludes(lon[i], lat[i]);
+        }
+    }
+    else
+    {
+        for(long i = 0; i < n; i++)
+        {
+            inclusion[i] = includes(lon[i], lat[i]);
+        }
+    }
+}
+
 /*----------------------------------------------------------------------------
  * Destructor
  *----------------------------------------------------------------------------*/
 GeoJsonRaster::~GeoJsonRaster(void)
 {
     VSIUnlink(rasterFileName.c_str());
+    if(mask) releaseMask(mask);
 }
 
 /******************************************************************************
@@ -156,7 +202,9 @@ static void validatedParams(const char *file, long filelength, double _cellsize)
  * Constructor
  *----------------------------------------------------------------------------*/
 GeoJsonRaster::GeoJsonRaster(lua_State *L, GeoParms* _parms, const char *file, long filelength, double _cellsize):
-    GeoRaster(L, _parms, std::string("/vsimem/" + GdalRaster::getUUID() + ".tif"), TimeLib::gpstime(), false /* not elevation*/ )
+    GeoRaster(L, _parms, std::string("/vsimem/" + GdalRaster::getUUID() + ".tif"), TimeLib::gpstime(), false /* not elevation*/ ),
+    mask(NULL),
+    useMask(false)
 {
     bool rasterCreated = false;
     GDALDataset* rasterDset = NULL;
@@ -164,76 +212,172 @@ GeoJsonRaster::GeoJsonRaster(lua_State *L, GeoParms* _parms, const char *file, l
     const std::string jsonFile = "/vsimem/" + GdalRaster::getUUID() + ".geojson";
     rasterFileName = getFileName();
 
+    /* Add Lua Functions */
+    LuaEngine::setAttrFunc(L, "includes", luaIncludes);
+
     validatedParams(file, filelength, _cellsize);
 
-    try
+    /* Same geojson and cellsize rasterize the same, key on a hash of both */
+    uint64_t hash = 0xcbf29ce484222325ULL; /* FNV-1a */
+    for(long i = 0; i < filelength; i++)
     {
-        /* Create raster from json file */
-        VSILFILE *fp = VSIFileFromMemBuffer(jsonFile.c_str(), (GByte *)file, (vsi_l_offset)filelength, FALSE);
-        CHECKPTR(fp);
-        VSIFCloseL(fp);
-
-        jsonDset = (GDALDataset *)GDALOpenEx(jsonFile.c_str(), GDAL_OF_VECTOR | GDAL_OF_READONLY, NULL, NULL, NULL);
-        CHECKPTR(jsonDset);
-        OGRLayer *srcLayer = jsonDset->GetLayer(0);
-        CHECKPTR(srcLayer);
-
-        OGREnvelope e;
-        OGRErr ogrerr = srcLayer->GetExtent(&e);
-        CHECK_GDALERR(ogrerr);
-
-        double cellsize = _cellsize;
-        int cols = int((e.MaxX - e.MinX) / cellsize);
-        int rows = int((e.MaxY - e.MinY) / cellsize);
-
-        char **options = NULL;
-        options = CSLSetNameValue(options, "COMPRESS", "DEFLATE");
+        hash = (hash ^ static_cast<uint8_t>(file[i])) * 0x100000001b3ULL;
+    }
+    char keybuf[MAX_STR_SIZE];
+    const std::string key = StringLib::format(keybuf, MAX_STR_SIZE, "%016lx:%ld:%.9lf", (unsigned long)hash, filelength, _cellsize);
 
+    try
+    {
         GDALDriver *driver = GetGDALDriverManager()->GetDriverByName("GTiff");
         CHECKPTR(driver);
-        rasterDset = (GDALDataset *)driver->Create(rasterFileName.c_str(), cols, rows, 1, GDT_Byte, options);
-        CSLDestroy(options);
-        CHECKPTR(rasterDset);
-        double geot[6] = {e.MinX, cellsize, 0, e.MaxY, 0, -cellsize};
-        rasterDset->SetGeoTransform(geot);
 
-        OGRSpatialReference *srcSrs = srcLayer->GetSpatialRef();
-        CHECKPTR(srcSrs);
-
-        char *wkt;
-        ogrerr = srcSrs->exportToWkt(&wkt);
-        CHECK_GDALERR(ogrerr);
-        rasterDset->SetProjection(wkt);
-        CPLFree(wkt);
+        char **options = NULL;
+        options = CSLSetNameValue(options, "COMPRESS", "DEFLATE");
 
         int bandInx = 1; /* Band index starts at 1, not 0 */
-        GDALRasterBand *rb = rasterDset->GetRasterBand(bandInx);
-        CHECKPTR(rb);
-        rb->SetNoDataValue(RASTER_NODATA_VALUE);
-
-        /*
-         * Build params for GDALRasterizeLayers
-         * Raster with 1 band, using first layer from json vector
-         */
-        const int BANDCNT = 1;
-
-        int bandlist[BANDCNT];
-        bandlist[0] = bandInx;
-
-        OGRLayer *layers[BANDCNT];
-        layers[0] = srcLayer;
-
-        double burnValues[BANDCNT];
-        burnValues[0] = RASTER_PIXEL_ON;
-
-        CPLErr cplerr = GDALRasterizeLayers(rasterDset, 1, bandlist, 1, (OGRLayerH *)&layers[0], NULL, NULL, burnValues, NULL, NULL, NULL);
-        CHECK_GDALERR(cplerr);
-        mlog(DEBUG, "Rasterized geojson into raster %s", rasterFileName.c_str());
+        mask = acquireMask(key, file, filelength);
+        if(mask)
+        {
+            /* Write raster from cached mask instead of rasterizing geojson again */
+            rasterDset = (GDALDataset *)driver->Create(rasterFileName.c_str(), mask->cols, mask->rows, 1, GDT_Byte, options);
+            CSLDestroy(options);
+            CHECKPTR(rasterDset);
+            double geot[6] = {mask->minX, mask->cellsize, 0, mask->maxY, 0, -mask->cellsize};
+            rasterDset->SetGeoTransform(geot);
+            rasterDset->SetProjection(mask->wkt.c_str());
+
+            GDALRasterBand *rb = rasterDset->GetRasterBand(bandInx);
+            CHECKPTR(rb);
+            rb->SetNoDataValue(RASTER_NODATA_VALUE);
+
+            const long rowbytes = (mask->cols + 7) / 8;
+            std::vector<uint8_t> line(mask->cols);
+            for(long row = 0; row < mask->rows; row++)
+            {
+                const uint8_t* bits = &mask->bits[row * rowbytes];
+                for(long col = 0; col < mask->cols; col++)
+                {
+                    line[col] = ((bits[col >> 3] >> (col & 0x7)) & 0x1) ? RASTER_PIXEL_ON : RASTER_NODATA_VALUE;
+                }
+                CPLErr cplerr = rb->RasterIO(GF_Write, 0, row, mask->cols, 1, line.data(), mask->cols, 1, GDT_Byte, 0, 0, NULL);
+                CHECK_GDALERR(cplerr);
+            }
+            mlog(DEBUG, "Wrote cached geojson mask into raster %s", rasterFileName.c_str());
+        }
+        else
+        {
+            /* Create raster from json file */
+            VSILFILE *fp = VSIFileFromMemBuffer(jsonFile.c_str(), (GByte *)file, (vsi_l_offset)filelength, FALSE);
+            CHECKPTR(fp);
+            VSIFCloseL(fp);
+
+            jsonDset = (GDALDataset *)GDALOpenEx(jsonFile.c_str(), GDAL_OF_VECTOR | GDAL_OF_READONLY, NULL, NULL, NULL);
+            CHECKPTR(jsonDset);
+            OGRLayer *srcLayer = jsonDset->GetLayer(0);
+            CHECKPTR(srcLayer);
+
+            OGREnvelope e;
+            OGRErr ogrerr = srcLayer->GetExtent(&e);
+            CHECK_GDALERR(ogrerr);
+
+            double cellsize = _cellsize;
+            int cols = int((e.MaxX - e.MinX) / cellsize);
+            int rows = int((e.MaxY - e.MinY) / cellsize);
+
+            rasterDset = (GDALDataset *)driver->Create(rasterFileName.c_str(), cols, rows, 1, GDT_Byte, options);
+            CSLDestroy(options);
+            CHECKPTR(rasterDset);
+            double geot[6] = {e.MinX, cellsize, 0, e.MaxY, 0, -cellsize};
+            rasterDset->SetGeoTransform(geot);
+
+            OGRSpatialReference *srcSrs = srcLayer->GetSpatialRef();
+            CHECKPTR(srcSrs);
+
+            char *wkt;
+            ogrerr = srcSrs->exportToWkt(&wkt);
+            CHECK_GDALERR(ogrerr);
+            rasterDset->SetProjection(wkt);
+            std::string srcWkt(wkt);
+            CPLFree(wkt);
+
+            GDALRasterBand *rb = rasterDset->GetRasterBand(bandInx);
+            CHECKPTR(rb);
+            rb->SetNoDataValue(RASTER_NODATA_VALUE);
+
+            /*
+             * Build params for GDALRasterizeLayers
+             * Raster with 1 band, using first layer from json vector
+             */
+            const int BANDCNT = 1;
+
+            int bandlist[BANDCNT];
+            bandlist[0] = bandInx;
+
+            OGRLayer *layers[BANDCNT];
+            layers[0] = srcLayer;
+
+            double burnValues[BANDCNT];
+            burnValues[0] = RASTER_PIXEL_ON;
+
+            CPLErr cplerr = GDALRasterizeLayers(rasterDset, 1, bandlist, 1, (OGRLayerH *)&layers[0], NULL, NULL, burnValues, NULL, NULL, NULL);
+            CHECK_GDALERR(cplerr);
+            mlog(DEBUG, "Rasterized geojson into raster %s", rasterFileName.c_str());
+
+            /* Keep rasterized pixels as a bitmap for inclusion tests */
+            const long rowbytes = (static_cast<long>(cols) + 7) / 8;
+            if(rowbytes * rows <= MAX_MASK_BYTES)
+            {
+                mask_t* newmask = new mask_t;
+                newmask->key        = key;
+                newmask->geojson.assign(file, filelength);
+                newmask->wkt        = srcWkt;
+                newmask->bits.assign(rowbytes * rows, 0);
+                newmask->minX       = e.MinX;
+                newmask->maxY       = e.MaxY;
+                newmask->cellsize   = cellsize;
+                newmask->cols       = cols;
+                newmask->rows       = rows;
+                newmask->geographic = srcSrs->IsGeographic();
+                newmask->refs       = 1;
+                newmask->useTime    = TimeLib::latchtime();
+
+                std::vector<uint8_t> line(cols);
+                for(long row = 0; row < rows; row++)
+                {
+                    cplerr = rb->RasterIO(GF_Read, 0, row, cols, 1, line.data(), cols, 1, GDT_Byte, 0, 0, NULL);
+                    if(cplerr != CE_None)
+                    {
+                        delete newmask;
+                        newmask = NULL;
+                        break;
+                    }
+                    uint8_t* bits = &newmask->bits[row * rowbytes];
+                    for(long col = 0; col < cols; col++)
+                    {
+                        if(line[col] == RASTER_PIXEL_ON) bits[col >> 3] |= (1 << (col & 0x7));
+                    }
+                }
+
+                if(newmask)
+                {
+                    maskMut.lock();
+                    {
+                        if(!maskCache.find(key.c_str())) maskCache.add(key.c_str(), newmask);
+                        else newmask->key.clear(); /* Another raster cached it first, keep private copy */
+                    }
+                    maskMut.unlock();
+                    mask = newmask;
+                }
+            }
+        }
 
         /* Must close raster to flush it into file in vsimem */
         GDALClose((GDALDatasetH)rasterDset);
         rasterDset = NULL;
         rasterCreated = true;
+
+        /* Bitmap lookups assume lon/lat pixels and the nearest pixel */
+        useMask = mask && mask->geographic && (_parms->sampling_algo == GRIORA_NearestNeighbour);
     }
     catch(const RunTimeException& e)
     {
@@ -246,5 +390,141 @@ GeoJsonRaster::GeoJsonRaster(lua_State *L, GeoParms* _parms, const char *file, l
    if(rasterDset) GDALClose((GDALDatasetH)rasterDset);
 
    if(!rasterCreated)
+   {
+       if(mask) releaseMask(mask);
+       mask = NULL;
        throw RunTimeException(CRITICAL, RTE_ERROR, "GeoJsonRaster failed");
-}
\ No newline at end of file
+   }
+}
+
+/******************************************************************************
+ * PRIVATE METHODS
+ ******************************************************************************/
+
+/*----------------------------------------------------------------------------
+ * luaIncludes - :includes({lons}, {lats}) --> {true|false per coordinate}
+ *----------------------------------------------------------------------------*/
+int GeoJsonRaster::luaIncludes(lua_State *L)
+{
+    bool status = false;
+    int num_ret = 1;
+
+    try
+    {
+        /* Get Self */
+        GeoJsonRaster *lua_obj = (GeoJsonRaster *)getLuaSelf(L, 1);
+
+        /* Get Coordinates */
+        if(!lua_istable(L, 2) || !lua_istable(L, 3))
+        {
+            throw RunTimeException(CRITICAL, RTE_ERROR, "Longitudes and latitudes must be provided as tables");
+        }
+        const long n = lua_rawlen(L, 2);
+        if(lua_rawlen(L, 3) != (size_t)n)
+        {
+            throw RunTimeException(CRITICAL, RTE_ERROR, "Coordinate tables must be the same length");
+        }
+
+        std::vector<double> lon(n);
+        std::vector<double> lat(n);
+        for(long i = 0; i < n; i++)
+        {
+            lua_rawgeti(L, 2, i+1);
+            lon[i] = getLuaFloat(L, -1);
+            lua_pop(L, 1);
+            lua_rawgeti(L, 3, i+1);
+            lat[i] = getLuaFloat(L, -1);
+            lua_pop(L, 1);
+        }
+
+        /* Test All Coordinates at Once */
+        bool* inclusion = new bool[n > 0 ? n : 1];
+        lua_obj->includes(lon.data(), lat.data(), n, inclusion);
+
+        /* Set Return Values */
+        lua_createtable(L, n, 0);
+        for(long i = 0; i < n; i++)
+        {
+            lua_pushboolean(L, inclusion[i]);
+            lua_rawseti(L, -2, i+1);
+        }
+        delete [] inclusion;
+        num_ret++;
+
+        /* Set Return Status */
+        status = true;
+    }
+    catch (const RunTimeException &e)
+    {
+        mlog(e.level(), "Error testing inclusion: %s", e.what());
+    }
+
+    /* Return Status */
+    return returnLuaStatus(L, status, num_ret);
+}
+
+/*----------------------------------------------------------------------------
+ * acquireMask
+ *----------------------------------------------------------------------------*/
+GeoJsonRaster::mask_t* GeoJsonRaster::acquireMask(const std::string& key, const char* file, long filelength)
+{
+    mask_t* entry = NULL;
+
+    maskMut.lock();
+    {
+        if(maskCache.find(key.c_str(), &entry) &&
+           entry->geojson.size() == static_cast<size_t>(filelength) &&
+           memcmp(entry->geojson.data(), file, filelength) == 0)
+        {
+            entry->refs++;
+            entry->useTime = TimeLib::latchtime();
+        }
+        else
+        {
+            entry = NULL;
+        }
+    }
+    maskMut.unlock();
+
+    return entry;
+}
+
+/*----------------------------------------------------------------------------
+ * releaseMask
+ *----------------------------------------------------------------------------*/
+void GeoJsonRaster::releaseMask(mask_t* _mask)
+{
+    /* Masks that lost the race to the cache are private */
+    if(_mask->key.empty())
+    {
+        delete _mask;
+        return;
+    }
+
+    mask_t* oldest = NULL;
+
+    maskMut.lock();
+    {
+        _mask->refs--;
+        _mask->useTime = TimeLib::latchtime();
+
+        /* Drop least recently used idle mask */
+        int idle = 0;
+        mask_t* entry;
+        const char* key = maskCache.first(&entry);
+        while(key != NULL)
+        {
+            if(entry->refs == 0)
+            {
+                idle++;
+                if(!oldest || entry->useTime < oldest->useTime) oldest = entry;
+            }
+            key = maskCache.next(&entry);
+        }
+        if(idle > MAX_IDLE_MASKS) maskCache.remove(oldest->key.c_str());
+        else oldest = NULL;
+    }
+    maskMut.unlock();
+
+    if(oldest) delete oldest;
+}
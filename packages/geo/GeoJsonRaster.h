@@ -53,6 +53,8 @@ class GeoJsonRaster: public GeoRaster
 
         static const int   RASTER_NODATA_VALUE = 200;
         static const int   RASTER_PIXEL_ON = 1;
+        static const long  MAX_MASK_BYTES = 0x2000000;  // 32MB, larger rasters are sampled through GDAL
+        static const int   MAX_IDLE_MASKS = 8;
 
         static const char* FILEDATA_KEY;
         static const char* FILELENGTH_KEY;
@@ -66,7 +68,10 @@ class GeoJsonRaster: public GeoRaster
         static int            luaCreate      (lua_State* L);
         static GeoJsonRaster* create         (lua_State* L, int index);
 
+        static void           deinit         (void);
+
         bool                  includes       (double lon, double lat, double height=0);
+        void                  includes       (const double* lon, const double* lat, long n, bool* inclusion);
         virtual              ~GeoJsonRaster  (void);
 
     protected:
@@ -79,11 +84,54 @@ class GeoJsonRaster: public GeoRaster
 
     private:
 
+        /*--------------------------------------------------------------------
+         * Typedefs
+         *--------------------------------------------------------------------*/
+
+        /* Rasterized geojson, one bit per pixel, shared by rasters of the same geojson */
+        typedef struct {
+            std::string             key;
+            std::string             geojson;    /* Guards against hash collisions */
+            std::string             wkt;
+            std::vector<uint8_t>    bits;       /* Rows of (cols + 7) / 8 bytes */
+            double                  minX;
+            double                  maxY;
+            double                  cellsize;
+            long                    cols;
+            long                    rows;
+            bool                    geographic; /* Pixels can be indexed by lon/lat directly */
+            int                     refs;
+            double                  useTime;
+        } mask_t;
+
         /*--------------------------------------------------------------------
          * Data
          *--------------------------------------------------------------------*/
 
+         static Mutex               maskMut;
+         static Dictionary<mask_t*> maskCache;
+
          std::string rasterFileName;
+         mask_t*     mask;
+         bool        useMask;
+
+        /*--------------------------------------------------------------------
+         * Methods
+         *--------------------------------------------------------------------*/
+
+         bool           maskIncludes    (double lon, double lat) const
+         {
+             const double x = (lon - mask->minX) / mask->cellsize;
+             const double y = (mask->maxY - lat) / mask->cellsize;
+             if(!(x >= 0 && y >= 0 && x < mask->cols && y < mask->rows)) return false;
+             const long col = static_cast<long>(x);
+             const long row = static_cast<long>(y);
+             return (mask->bits[row * ((mask->cols + 7) / 8) + (col >> 3)] >> (col & 0x7)) & 0x1;
+         }
+
+         static int     luaIncludes     (lua_State* L);
+         static mask_t* acquireMask     (const std::string& key, const char* file, long filelength);
+         static void    releaseMask     (mask_t* _mask);
 };
 
 #endif  /* __geojson_raster__ */
@@ -73,6 +73,48 @@ void GeoRaster::getSamples(double lon, double lat, double height, int64_t gps, s
     samplingMutex.unlock();
 }
 
+/*----------------------------------------------------------------------------
+ * getSamples - batch of points
+ *----------------------------------------------------------------------------*/
+void GeoRaster::getSamples(const std::vector<point_t>& points, std::vector<RasterSample>& slist, std::vector<uint32_t>& counts, void* param)
+{
+    std::ignore = param;
+
+    std::vector<GdalRaster::Point> pois;
+    pois.reserve(points.size());
+    for(const point_t& point: points)
+    {
+        pois.push_back(GdalRaster::Point(point.lon, point.lat, point.height));
+    }
+
+    std::vector<RasterSample> samples;
+    std::vector<bool> valid;
+
+    samplingMutex.lock();
+    try
+    {
+        raster.samplePOIs(pois, samples, valid);
+    }
+    catch (const RunTimeException &e)
+    {
+        mlog(e.level(), "Error getting samples: %s", e.what());
+        samplingMutex.unlock();
+        throw;  // rethrow exception
+    }
+    samplingMutex.unlock();
+
+    counts.assign(points.size(), 0);
+    for(size_t i = 0; i < samples.size(); i++)
+    {
+        if(valid[i])
+        {
+            samples[i].fileId = fileId;
+            slist.push_back(samples[i]);
+            counts[i] = 1;
+        }
+    }
+}
+
 /*----------------------------------------------------------------------------
  * Destructor
  *----------------------------------------------------------------------------*/
@@ -63,6 +63,7 @@ class GeoRaster: public RasterObject
 
         virtual         ~GeoRaster  (void);
         virtual void    getSamples  (double lon, double lat, double height, int64_t gps, std::vector<RasterSample>& slist, void* param=NULL) final;
+        virtual void    getSamples  (const std::vector<point_t>& points, std::vector<RasterSample>& slist, std::vector<uint32_t>& counts, void* param=NULL) final;
 
     protected:
 
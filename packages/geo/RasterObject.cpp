@@ -127,6 +127,25 @@ bool RasterObject::registerRaster (const char* _name, factory_t create)
     return status;
 }
 
+/*----------------------------------------------------------------------------
+ * getSamples - batch of points
+ *
+ *  samples of all points are appended to slist in point order, counts[i] is
+ *  the number of samples that belong to points[i]; rasters that can do better
+ *  than sampling one point at a time override this
+ *----------------------------------------------------------------------------*/
+void RasterObject::getSamples(const std::vector<point_t>& points, std::vector<RasterSample>& slist, std::vector<uint32_t>& counts, void* param)
+{
+    counts.assign(points.size(), 0);
+    for(size_t i = 0; i < points.size(); i++)
+    {
+        const point_t& point = points[i];
+        size_t before = slist.size();
+        getSamples(point.lon, point.lat, point.height, point.gps, slist, param);
+        counts[i] = slist.size() - before;
+    }
+}
+
 /*----------------------------------------------------------------------------
  * Destructor
  *----------------------------------------------------------------------------*/
@@ -149,6 +168,7 @@ RasterObject::RasterObject(lua_State *L, GeoParms* _parms):
 {
     /* Add Lua Functions */
     LuaEngine::setAttrFunc(L, "sample", luaSamples);
+    LuaEngine::setAttrFunc(L, "batchsample", luaBatchSamples);
 }
 
 /*----------------------------------------------------------------------------
@@ -206,43 +226,7 @@ int RasterObject::luaSamples(lua_State *L)
 
             for(uint32_t i = 0; i < slist.size(); i++)
             {
-                const RasterSample& sample = slist[i];
-                const char* fileName = "";
-
-                /* Find fileName from fileId */
-                Dictionary<uint64_t>::Iterator iterator(lua_obj->fileDictGet());
-                for(int j = 0; j < iterator.length; j++)
-                {
-                    if(iterator[j].value == sample.fileId)
-                    {
-                        fileName = iterator[j].key;
-                        break;
-                    }
-                }
-
-                lua_createtable(L, 0, 2);
-                LuaEngine::setAttrStr(L, "file", fileName);
-
-
-                if(lua_obj->parms->zonal_stats) /* Include all zonal stats */
-                {
-                    LuaEngine::setAttrNum(L, "mad", sample.stats.mad);
-                    LuaEngine::setAttrNum(L, "stdev", sample.stats.stdev);
-                    LuaEngine::setAttrNum(L, "median", sample.stats.median);
-                    LuaEngine::setAttrNum(L, "mean", sample.stats.mean);
-                    LuaEngine::setAttrNum(L, "max", sample.stats.max);
-                    LuaEngine::setAttrNum(L, "min", sample.stats.min);
-                    LuaEngine::setAttrNum(L, "count", sample.stats.count);
-                }
-
-                if(lua_obj->parms->flags_file) /* Include flags */
-                {
-                    LuaEngine::setAttrNum(L, "flags", sample.flags);
-                }
-
-                LuaEngine::setAttrInt(L, "fileid", sample.fileId);
-                LuaEngine::setAttrNum(L, "time", sample.time);
-                LuaEngine::setAttrNum(L, "value", sample.value);
+                pushSample(L, lua_obj, slist[i]);
                 lua_rawseti(L, -2, i+1);
             }
             num_ret++;
@@ -257,3 +241,123 @@ int RasterObject::luaSamples(lua_State *L)
     /* Return Status */
     return returnLuaStatus(L, status, num_ret);
 }
+
+/*----------------------------------------------------------------------------
+ * luaBatchSamples - :batchsample({lons}, {lats}, [{heights}]) --> {{samples of point 1}, ...}|out
+ *----------------------------------------------------------------------------*/
+int RasterObject::luaBatchSamples(lua_State *L)
+{
+    bool status = false;
+    int num_ret = 1;
+
+    RasterObject *lua_obj = NULL;
+
+    try
+    {
+        /* Get Self */
+        lua_obj = (RasterObject*)getLuaSelf(L, 1);
+
+        /* Get Coordinates */
+        if(!lua_istable(L, 2) || !lua_istable(L, 3))
+        {
+            throw RunTimeException(CRITICAL, RTE_ERROR, "Longitudes and latitudes must be provided as tables");
+        }
+        const bool heights = lua_istable(L, 4);
+        const int num_points = lua_rawlen(L, 2);
+        if(lua_rawlen(L, 3) != (size_t)num_points || (heights && lua_rawlen(L, 4) != (size_t)num_points))
+        {
+            throw RunTimeException(CRITICAL, RTE_ERROR, "Coordinate tables must be the same length");
+        }
+
+        std::vector<point_t> points(num_points);
+        for(int i = 0; i < num_points; i++)
+        {
+            point_t& point = points[i];
+            lua_rawgeti(L, 2, i+1);
+            point.lon = getLuaFloat(L, -1);
+            lua_pop(L, 1);
+            lua_rawgeti(L, 3, i+1);
+            point.lat = getLuaFloat(L, -1);
+            lua_pop(L, 1);
+            point.height = 0.0;
+            if(heights)
+            {
+                lua_rawgeti(L, 4, i+1);
+                point.height = getLuaFloat(L, -1);
+                lua_pop(L, 1);
+            }
+            point.gps = 0;
+        }
+
+        /* Get samples */
+        std::vector<RasterSample> slist;
+        std::vector<uint32_t> counts;
+        lua_obj->getSamples(points, slist, counts, NULL);
+
+        /* Create return table, one list of samples per point */
+        lua_createtable(L, num_points, 0);
+        size_t s = 0;
+        for(int i = 0; i < num_points; i++)
+        {
+            lua_createtable(L, counts[i], 0);
+            for(uint32_t j = 0; j < counts[i]; j++)
+            {
+                pushSample(L, lua_obj, slist[s++]);
+                lua_rawseti(L, -2, j+1);
+            }
+            lua_rawseti(L, -2, i+1);
+        }
+        num_ret++;
+        status = true;
+    }
+    catch (const RunTimeException &e)
+    {
+        mlog(e.level(), "Failed to read samples: %s", e.what());
+    }
+
+    /* Return Status */
+    return returnLuaStatus(L, status, num_ret);
+}
+
+/*----------------------------------------------------------------------------
+ * pushSample - pushes table describing sample onto lua stack
+ *----------------------------------------------------------------------------*/
+void RasterObject::pushSample(lua_State *L, RasterObject* lua_obj, const RasterSample& sample)
+{
+    const char* fileName = "";
+
+    /* Find fileName from fileId */
+    Dictionary<uint64_t>::Iterator iterator(lua_obj->fileDictGet());
+    for(int j = 0; j < iterator.length; j++)
+    {
+        if(iterator[j].value == sample.fileId)
+        {
+            fileName = iterator[j].key;
+            break;
+        }
+    }
+
+    lua_createtable(L, 0, 2);
+    LuaEngine::setAttrStr(L, "file", fileName);
+
+
+    if(lua_obj->parms->zonal_stats) /* Include all zonal stats */
+    {
+        LuaEngine::setAttrNum(L, "mad", sample.stats.mad);
+        LuaEngine::setAttrNum(L, "stdev", sample.stats.stdev);
+        LuaEngine::setAttrNum(L, "median", sample.stats.median);
+        LuaEngine::setAttrNum(L, "mean", sample.stats.mean);
+        LuaEngine::setAttrNum(L, "max", sample.stats.max);
+        LuaEngine::setAttrNum(L, "min", sample.stats.min);
+        LuaEngine::setAttrNum(L, "count", sample.stats.count);
+    }
+
+    if(lua_obj->parms->flags_file) /* Include flags */
+    {
+        LuaEngine::setAttrNum(L, "flags", sample.flags);
+    }
+
+    LuaEngine::setAttrInt(L, "fileid", sample.fileId);
+    LuaEngine::setAttrNum(L, "time", sample.time);
+    LuaEngine::setAttrNum(L, "value", sample.value);
+}
@@ -63,6 +63,13 @@ class RasterObject: public LuaObject
 
         typedef RasterObject* (*factory_t) (lua_State* L, GeoParms* _parms);
 
+        typedef struct {
+            double      lon;
+            double      lat;
+            double      height;
+            int64_t     gps;
+        } point_t;
+
         /*--------------------------------------------------------------------
          * Methods
          *--------------------------------------------------------------------*/
@@ -72,6 +79,7 @@ class RasterObject: public LuaObject
         static int      luaCreate       (lua_State* L);
         static bool     registerRaster  (const char* _name, factory_t create);
         virtual void    getSamples      (double lon, double lat, double height, int64_t gps, std::vector<RasterSample>& slist, void* param=NULL) = 0;
+        virtual void    getSamples      (const std::vector<point_t>& points, std::vector<RasterSample>& slist, std::vector<uint32_t>& counts, void* param=NULL);
         virtual         ~RasterObject   (void);
 
         inline bool hasZonalStats (void)
@@ -93,6 +101,8 @@ class RasterObject: public LuaObject
                     RasterObject    (lua_State* L, GeoParms* _parms);
         uint64_t    fileDictAdd     (const std::string& fileName);
         static int  luaSamples      (lua_State* L);
+        static int  luaBatchSamples (lua_State* L);
+        static void pushSample      (lua_State* L, RasterObject* lua_obj, const RasterSample& sample);
 
         /*--------------------------------------------------------------------
          * Data
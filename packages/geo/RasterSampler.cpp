@@ -229,6 +229,7 @@ RasterSampler::~RasterSampler(void)
  *  INPUT:  batch of atl06 extents
  *          each extent (up to 256 per record) will produce a single output record with one point
  *          that one point may have multiple samples associated with it
+ *          all points of the batch are handed to the raster together
  *----------------------------------------------------------------------------*/
 bool RasterSampler::processRecord (RecordObject* record, okey_t key)
 {
@@ -253,52 +254,80 @@ bool RasterSampler::processRecord (RecordObject* record, okey_t key)
     RecordObject::field_t time_field = timeField;
     RecordObject::field_t height_field = heightField;
 
-    /* Loop Through Each Record in Batch */
+    /* Collect Points of Every Extent in Batch */
+    std::vector<uint64_t> indexes(num_extents);
+    std::vector<RasterObject::point_t> points(num_extents);
     for(int extent = 0; extent < num_extents; extent++)
     {
+        RasterObject::point_t& point = points[extent];
+
         /* Get Extent Id */
-        uint64_t index = (uint64_t)record->getValueInteger(index_field);
+        indexes[extent] = (uint64_t)record->getValueInteger(index_field);
         index_field.offset += (recordSizeBytes * 8);
 
         /* Get Longitude */
-        double lon_val = record->getValueReal(lon_field);
+        point.lon = record->getValueReal(lon_field);
         lon_field.offset += (recordSizeBytes * 8);
 
         /* Get Latitude */
-        double lat_val = record->getValueReal(lat_field);
+        point.lat = record->getValueReal(lat_field);
         lat_field.offset += (recordSizeBytes * 8);
 
         /* Get Time */
-        long gps = 0;
+        point.gps = 0;
         if(time_field.type != RecordObject::INVALID_FIELD)
         {
             long time_val = record->getValueInteger(time_field);
             time_field.offset += (recordSizeBytes * 8);
-            gps = TimeLib::sysex2gpstime(time_val);
+            point.gps = TimeLib::sysex2gpstime(time_val);
         }
 
         /* Get Height */
-        double height_val = 0.0;
+        point.height = 0.0;
         if(height_field.type != RecordObject::INVALID_FIELD)
         {
-            height_val = record->getValueReal(height_field);
+            point.height = record->getValueReal(height_field);
             height_field.offset += (recordSizeBytes * 8);
         }
+    }
 
-        /* Sample Raster */
-        std::vector<RasterSample> slist;
-        int num_samples = 0;
-        try
-        {
-            raster->getSamples(lon_val, lat_val, height_val, gps, slist);
-            num_samples = slist.size();
-        }
-        catch(const RunTimeException& e)
+    /* Sample Raster at All Points */
+    std::vector<RasterSample> slist;
+    std::vector<uint32_t> counts;
+    try
+    {
+        raster->getSamples(points, slist, counts);
+    }
+    catch(const RunTimeException& e)
+    {
+        /* Resample One Point at a Time to Report the Failing Points */
+        mlog(DEBUG, "Batch sampling of %s failed, sampling points individually: %s", rasterKey, e.what());
+        slist.clear();
+        counts.assign(num_extents, 0);
+        for(int extent = 0; extent < num_extents; extent++)
         {
-            LuaEndpoint::generateExceptionStatus(RTE_ERROR, e.level(), outQ, NULL,
-                                                "Exception caught when sampling %s at %.3lf,%.3lf,%3lf: %s",
-                                                rasterKey, lon_val, lat_val, height_val, e.what());
+            const RasterObject::point_t& point = points[extent];
+            size_t before = slist.size();
+            try
+            {
+                raster->getSamples(point.lon, point.lat, point.height, point.gps, slist);
+            }
+            catch(const RunTimeException& pe)
+            {
+                slist.resize(before);
+                LuaEndpoint::generateExceptionStatus(RTE_ERROR, pe.level(), outQ, NULL,
+                                                    "Exception caught when sampling %s at %.3lf,%.3lf,%3lf: %s",
+                                                    rasterKey, point.lon, point.lat, point.height, pe.what());
+            }
+            counts[extent] = slist.size() - before;
         }
+    }
+
+    /* Post One Record per Extent */
+    const RasterSample* samples = slist.data();
+    for(int extent = 0; extent < num_extents; extent++)
+    {
+        int num_samples = counts[extent];
 
         if(raster->hasZonalStats())
         {
@@ -306,12 +335,12 @@ bool RasterSampler::processRecord (RecordObject* record, okey_t key)
             int size_of_record = offsetof(zs_geo_t, samples) + (sizeof(RasterSample) * num_samples);
             RecordObject stats_rec(zsGeoRecType, size_of_record);
             zs_geo_t* data = (zs_geo_t*)stats_rec.getRecordData();
-            data->index = index;
+            data->index = indexes[extent];
             StringLib::copy(data->raster_key, rasterKey, RASTER_KEY_MAX_LEN);
             data->num_samples = num_samples;
             for(int i = 0; i < num_samples; i++)
             {
-                data->samples[i] = slist[i];
+                data->samples[i] = samples[i];
             }
             if(!stats_rec.post(outQ))
             {
@@ -324,21 +353,23 @@ bool RasterSampler::processRecord (RecordObject* record, okey_t key)
             int size_of_record = offsetof(rs_geo_t, samples) + (sizeof(sample_t) * num_samples);
             RecordObject sample_rec(rsGeoRecType, size_of_record);
             rs_geo_t* data = (rs_geo_t*)sample_rec.getRecordData();
-            data->index = index;
+            data->index = indexes[extent];
             StringLib::copy(data->raster_key, rasterKey, RASTER_KEY_MAX_LEN);
             data->num_samples = num_samples;
             for(int i = 0; i < num_samples; i++)
             {
-                data->samples[i].value = slist[i].value;
-                data->samples[i].time = slist[i].time;
-                data->samples[i].file_id = slist[i].fileId;
-                data->samples[i].flags = slist[i].flags;
+                data->samples[i].value = samples[i].value;
+                data->samples[i].time = samples[i].time;
+                data->samples[i].file_id = samples[i].fileId;
+                data->samples[i].flags = samples[i].flags;
             }
             if(!sample_rec.post(outQ))
             {
                 status = false;
             }
         }
+
+        samples += num_samples;
     }
 
     /* Return Status */
@@ -209,6 +209,7 @@ int geo_open (lua_State* L)
         {"raster",      RasterObject::luaCreate},
         {"sampler",     RasterSampler::luaCreate},
         {"parms",       GeoParms::luaCreate},
+        {"dscache",     GdalRaster::luaDatasetCache},
         {NULL,          NULL}
     };
 
@@ -254,6 +255,7 @@ void initgeo (void)
     test_projlib();
 
     /* Initialize Modules */
+    GdalRaster::init();
     GeoIndexedRaster::init();
     RasterSampler::init();
 
@@ -275,6 +277,8 @@ void deinitgeo (void)
 {
     GeoIndexedRaster::deinit();
     RasterSampler::deinit();
+    GeoJsonRaster::deinit();
+    GdalRaster::deinit();
     GDALDestroy();
 }
 }
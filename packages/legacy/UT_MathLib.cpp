@@ -0,0 +1,218 @@
+/*
+ * Copyright (c) 2021, University of Washington
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the University of Washington nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY OF WASHINGTON AND CONTRIBUTORS
+ * “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE UNIVERSITY OF WASHINGTON OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/******************************************************************************
+ * INCLUDES
+ ******************************************************************************/
+
+#include "UT_MathLib.h"
+#include "core.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+/******************************************************************************
+ * STATIC DATA
+ ******************************************************************************/
+
+const char* UT_MathLib::TYPE = "UT_MathLib";
+
+/******************************************************************************
+ * PUBLIC METHODS
+ ******************************************************************************/
+
+/*----------------------------------------------------------------------------
+ * createObject  -
+ *----------------------------------------------------------------------------*/
+CommandableObject* UT_MathLib::createObject(CommandProcessor* cmd_proc, const char* name, int argc, char argv[][MAX_CMD_SIZE])
+{
+    (void)argc;
+    (void)argv;
+
+    /* Create Math Library Unit Test */
+    return new UT_MathLib(cmd_proc, name);
+}
+
+/*----------------------------------------------------------------------------
+ * Constructor  -
+ *----------------------------------------------------------------------------*/
+UT_MathLib::UT_MathLib(CommandProcessor* cmd_proc, const char* obj_name):
+    CommandableObject(cmd_proc, obj_name, TYPE)
+{
+    /* Register Commands */
+    registerCommand("CHECK_INPOLY", (cmdFunc_t)&UT_MathLib::CheckInPolyCmd, 0, "");
+}
+
+/*----------------------------------------------------------------------------
+ * Destructor  -
+ *----------------------------------------------------------------------------*/
+UT_MathLib::~UT_MathLib(void)
+{
+}
+
+/*----------------------------------------------------------------------------
+ * CheckInPolyCmd
+ *
+ *  Checks that the prepared polygon includes the same points as the plain
+ *  inclusion test, for random points and for points on the vertices, on
+ *  horizontal edges, and on the edges of the bounding box
+ *----------------------------------------------------------------------------*/
+int UT_MathLib::CheckInPolyCmd(int argc, char argv[][MAX_CMD_SIZE])
+{
+    (void)argc;
+    (void)argv;
+
+    srand(1);
+
+    for(int p = 0; p < NUM_POLYGONS; p++)
+    {
+        /* Star shaped polygon, every other one with y snapped to a grid so it has horizontal edges */
+        const int len = 3 + (rand() % MAX_VERTICES);
+        const bool snapped = (p % 2) == 1;
+        std::vector<MathLib::point_t> poly(len);
+        for(int i = 0; i < len; i++)
+        {
+            const double a = 2.0 * M_PI * i / len;
+            const double r = 1.0 + 0.5 * (rand() / (double)RAND_MAX);
+            poly[i].x = r * cos(a);
+            poly[i].y = r * sin(a);
+            if(snapped)
+            {
+                poly[i].x = floor(poly[i].x * 10.0) / 10.0;
+                poly[i].y = floor(poly[i].y * 10.0) / 10.0;
+            }
+        }
+
+        /* Bounding Box */
+        double min_x = poly[0].x, max_x = poly[0].x;
+        double min_y = poly[0].y, max_y = poly[0].y;
+        for(int i = 1; i < len; i++)
+        {
+            min_x = MIN(min_x, poly[i].x); max_x = MAX(max_x, poly[i].x);
+            min_y = MIN(min_y, poly[i].y); max_y = MAX(max_y, poly[i].y);
+        }
+
+        std::vector<MathLib::point_t> points;
+
+        /* Random Points Over and Around the Bounding Box */
+        for(int k = 0; k < NUM_RANDOM_POINTS; k++)
+        {
+            MathLib::point_t point;
+            point.x = min_x - 0.5 + (max_x - min_x + 1.0) * (rand() / (double)RAND_MAX);
+            point.y = min_y - 0.5 + (max_y - min_y + 1.0) * (rand() / (double)RAND_MAX);
+            points.push_back(point);
+        }
+
+        /* Vertices, and Points Along Horizontal Edges */
+        for(int i = 0, j = len - 1; i < len; j = i++)
+        {
+            points.push_back(poly[i]);
+            if(poly[i].y == poly[j].y)
+            {
+                MathLib::point_t point;
+                point.y = poly[i].y;
+                point.x = (poly[i].x + poly[j].x) / 2.0;
+                points.push_back(point);
+                point.x = MIN(poly[i].x, poly[j].x) - 0.01;
+                points.push_back(point);
+                point.x = MAX(poly[i].x, poly[j].x) + 0.01;
+                points.push_back(point);
+            }
+        }
+
+        /* Edges and Corners of the Bounding Box */
+        for(int k = 0; k <= 100; k++)
+        {
+            MathLib::point_t point;
+            point.x = min_x + (max_x - min_x) * k / 100.0;
+            point.y = min_y; points.push_back(point);
+            point.y = max_y; points.push_back(point);
+            point.y = min_y + (max_y - min_y) * k / 100.0;
+            point.x = min_x; points.push_back(point);
+            point.x = max_x; points.push_back(point);
+        }
+
+        if(comparePoly(&poly[0], len, &points[0], points.size()) != 0)
+        {
+            print2term("Polygon %d of %d vertices (%s) failed\n", p, len, snapped ? "snapped" : "random");
+            return -1;
+        }
+    }
+
+    /* Axis Aligned Square, All Edges on the Bounding Box */
+    MathLib::point_t square[4] = {{0.0, 0.0}, {1.0, 0.0}, {1.0, 1.0}, {0.0, 1.0}};
+    MathLib::point_t square_points[] = {
+        {0.0, 0.0}, {1.0, 0.0}, {1.0, 1.0}, {0.0, 1.0},     // corners
+        {0.5, 0.0}, {0.5, 1.0}, {0.0, 0.5}, {1.0, 0.5},     // edges
+        {0.5, 0.5}, {-0.5, 0.5}, {1.5, 0.5}, {0.5, -0.5}, {0.5, 1.5}
+    };
+    if(comparePoly(square, 4, square_points, sizeof(square_points) / sizeof(MathLib::point_t)) != 0)
+    {
+        print2term("Square failed\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------
+ * comparePoly
+ *
+ *  Returns the number of points the prepared tests (batch and single) do
+ *  not agree with the plain test on
+ *----------------------------------------------------------------------------*/
+int UT_MathLib::comparePoly(MathLib::point_t* poly, int len, const MathLib::point_t* points, long n)
+{
+    int mismatches = 0;
+
+    MathLib::poly_t prep;
+    MathLib::initpoly(&prep, poly, len);
+
+    bool* inclusion = new bool[n];
+    MathLib::inpoly(&prep, points, n, inclusion);
+
+    for(long k = 0; k < n; k++)
+    {
+        const bool expected = MathLib::inpoly(poly, len, points[k]);
+        const bool single = MathLib::inpoly(&prep, points[k]);
+        if(inclusion[k] != expected || single != expected)
+        {
+            print2term("Point (%.17lf, %.17lf) prepared: %d/%d, plain: %d\n", points[k].x, points[k].y, (int)inclusion[k], (int)single, (int)expected);
+            mismatches++;
+        }
+    }
+
+    delete [] inclusion;
+    MathLib::freepoly(&prep);
+
+    return mismatches;
+}
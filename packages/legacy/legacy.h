@@ -54,6 +54,7 @@
 #include "StatisticRecord.h"
 #include "UT_Dictionary.h"
 #include "UT_List.h"
+#include "UT_MathLib.h"
 #include "UT_MsgQ.h"
 #include "UT_Ordering.h"
 #include "UT_Table.h"
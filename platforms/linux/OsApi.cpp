@@ -216,6 +216,14 @@ int OsApi::nproc (void)
     return get_nprocs();
 }
 
+/*----------------------------------------------------------------------------
+ * memtotal - bytes of physical memory on the system
+ *----------------------------------------------------------------------------*/
+int64_t OsApi::memtotal (void)
+{
+    return (int64_t)get_phys_pages() * (int64_t)sysconf(_SC_PAGESIZE);
+}
+
 /*----------------------------------------------------------------------------
  * memusage
  *----------------------------------------------------------------------------*/
@@ -204,6 +204,7 @@ class OsApi
         static float        swapf               (float val);
         static double       swaplf              (double val);
         static int          nproc               (void);
+        static int64_t      memtotal            (void);
         static double       memusage            (void);
         static void         print               (const char* file_name, unsigned int line_number, const char* format_string, ...)  __attribute__((format(printf, 3, 4)));
         static bool         setIOMaxsize        (int maxsize);
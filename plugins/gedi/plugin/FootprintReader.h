@@ -375,32 +375,41 @@ void FootprintReader<footprint_t>::Region::polyregion (info_t* info)
     if(lat[0] > 70.0) projection = MathLib::NORTH_POLAR;
     else if(lat[0] < -70.0) projection = MathLib::SOUTH_POLAR;
 
-    /* Project Polygon */
+    /* Project and Prepare Polygon */
     List<MathLib::coord_t>::Iterator poly_iterator(info->reader->parms->polygon);
     MathLib::point_t* projected_poly = new MathLib::point_t [points_in_polygon];
     for(int i = 0; i < points_in_polygon; i++)
     {
         projected_poly[i] = MathLib::coord2point(poly_iterator[i], projection);
     }
+    MathLib::poly_t prepared_poly;
+    MathLib::initpoly(&prepared_poly, projected_poly, points_in_polygon);
+    delete [] projected_poly;
+
+    /* Batch of Projected Footprints */
+    MathLib::point_t batch_points[MathLib::POLY_BATCH_SIZE];
+    bool batch_inclusion[MathLib::POLY_BATCH_SIZE];
 
     /* Find First and Last Footprints in Polygon */
     bool first_footprint_found = false;
     bool last_footprint_found = false;
+    int batch_start = 0;
+    int batch_end = 0;
     int footprint = 0;
     while(footprint < lat.size)
     {
-        bool inclusion = false;
-
-        /* Project Segment Coordinate */
-        MathLib::coord_t footprint_coord = {lon[footprint], lat[footprint]};
-        MathLib::point_t footprint_point = MathLib::coord2point(footprint_coord, projection);
-
-        /* Test Inclusion */
-        if(MathLib::inpoly(projected_poly, points_in_polygon, footprint_point))
+        /* Project and Test Next Batch of Footprints */
+        if(footprint >= batch_end)
         {
-            inclusion = true;
+            batch_start = footprint;
+            batch_end = MIN(footprint + MathLib::POLY_BATCH_SIZE, lat.size);
+            MathLib::coord2point(&lon[batch_start], &lat[batch_start], batch_end - batch_start, projection, batch_points);
+            MathLib::inpoly(&prepared_poly, batch_points, batch_end - batch_start, batch_inclusion);
         }
 
+        /* Test Inclusion */
+        bool inclusion = batch_inclusion[footprint - batch_start];
+
         /* Find First Footprint */
         if(!first_footprint_found && inclusion)
         {
@@ -425,8 +434,8 @@ void FootprintReader<footprint_t>::Region::polyregion (info_t* info)
         num_footprints = footprint - first_footprint;
     }
 
-    /* Delete Projected Polygon */
-    delete [] projected_poly;
+    /* Free Prepared Polygon */
+    MathLib::freepoly(&prepared_poly);
 }
 
 /*----------------------------------------------------------------------------
@@ -440,15 +449,16 @@ void FootprintReader<footprint_t>::Region::rasterregion (info_t* info)
     inclusion_mask = new bool [lat.size];
     inclusion_ptr = inclusion_mask;
 
+    /* Check Inclusion of All Footprints */
+    info->reader->parms->raster->includes(&lon[0], &lat[0], lat.size, inclusion_mask);
+
     /* Loop Throuh Segments */
     bool first_footprint_found = false;
     long last_footprint = 0;
     int footprint = 0;
     while(footprint < lat.size)
     {
-        /* Check Inclusion */
-        bool inclusion = info->reader->parms->raster->includes(lon[footprint], lat[footprint]);
-        inclusion_mask[footprint] = inclusion;
+        bool inclusion = inclusion_mask[footprint];
 
         /* If Coordinate Is In Raster */
         if(inclusion)
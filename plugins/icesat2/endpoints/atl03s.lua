@@ -28,7 +28,7 @@ if proc then
     local flatten = false
     if parms[arrow.PARMS] then
         local output_parms = arrow.parms(parms[arrow.PARMS])
-        if output_parms:isparquet() then
+        if output_parms:isparquet() or output_parms:isarrowipc() then
             flatten = true
         end
     end
@@ -367,34 +367,43 @@ void Atl03Reader::Region::polyregion (info_t* info)
     if(segment_lat[Icesat2Parms::RPT_L][0] > 70.0) projection = MathLib::NORTH_POLAR;
     else if(segment_lat[Icesat2Parms::RPT_L][0] < -70.0) projection = MathLib::SOUTH_POLAR;
 
-    /* Project Polygon */
+    /* Project and Prepare Polygon */
     List<MathLib::coord_t>::Iterator poly_iterator(info->reader->parms->polygon);
     MathLib::point_t* projected_poly = new MathLib::point_t [points_in_polygon];
     for(int i = 0; i < points_in_polygon; i++)
     {
         projected_poly[i] = MathLib::coord2point(poly_iterator[i], projection);
     }
+    MathLib::poly_t prepared_poly;
+    MathLib::initpoly(&prepared_poly, projected_poly, points_in_polygon);
+    delete [] projected_poly;
+
+    /* Batch of Projected Segments */
+    MathLib::point_t batch_points[MathLib::POLY_BATCH_SIZE];
+    bool batch_inclusion[MathLib::POLY_BATCH_SIZE];
 
     /* Find First Segment In Polygon */
     bool first_segment_found[Icesat2Parms::NUM_PAIR_TRACKS] = {false, false};
     bool last_segment_found[Icesat2Parms::NUM_PAIR_TRACKS] = {false, false};
     for(int t = 0; t < Icesat2Parms::NUM_PAIR_TRACKS; t++)
     {
+        int batch_start = 0;
+        int batch_end = 0;
         int segment = 0;
         while(segment < segment_ph_cnt[t].size)
         {
-            bool inclusion = false;
-
-            /* Project Segment Coordinate */
-            MathLib::coord_t segment_coord = {segment_lon[t][segment], segment_lat[t][segment]};
-            MathLib::point_t segment_point = MathLib::coord2point(segment_coord, projection);
-
-            /* Test Inclusion */
-            if(MathLib::inpoly(projected_poly, points_in_polygon, segment_point))
+            /* Project and Test Next Batch of Segments */
+            if(segment >= batch_end)
             {
-                inclusion = true;
+                batch_start = segment;
+                batch_end = MIN(segment + MathLib::POLY_BATCH_SIZE, segment_ph_cnt[t].size);
+                MathLib::coord2point(&segment_lon[t][batch_start], &segment_lat[t][batch_start], batch_end - batch_start, projection, batch_points);
+                MathLib::inpoly(&prepared_poly, batch_points, batch_end - batch_start, batch_inclusion);
             }
 
+            /* Test Inclusion */
+            bool inclusion = batch_inclusion[segment - batch_start];
+
             /* Check First Segment */
             if(!first_segment_found[t])
             {
@@ -441,8 +450,8 @@ void Atl03Reader::Region::polyregion (info_t* info)
         }
     }
 
-    /* Delete Projected Polygon */
-    delete [] projected_poly;
+    /* Free Prepared Polygon */
+    MathLib::freepoly(&prepared_poly);
 }
 
 /*----------------------------------------------------------------------------
@@ -464,6 +473,9 @@ void Atl03Reader::Region::rasterregion (info_t* info)
         inclusion_mask[t] = new bool [segment_ph_cnt[t].size];
         inclusion_ptr[t] = inclusion_mask[t];
 
+        /* Check Inclusion of All Segments */
+        info->reader->parms->raster->includes(&segment_lon[t][0], &segment_lat[t][0], segment_ph_cnt[t].size, inclusion_mask[t]);
+
         /* Loop Throuh Segments */
         long curr_num_photons = 0;
         long last_segment = 0;
@@ -472,9 +484,7 @@ void Atl03Reader::Region::rasterregion (info_t* info)
         {
             if(segment_ph_cnt[t][segment] != 0)
             {
-                /* Check Inclusion */
-                bool inclusion = info->reader->parms->raster->includes(segment_lon[t][segment], segment_lat[t][segment]);
-                inclusion_mask[t][segment] = inclusion;
+                bool inclusion = inclusion_mask[t][segment];
 
                 /* Check For First Segment */
                 if(!first_segment_found[t])
@@ -107,15 +107,32 @@ void PgcDemStripsRaster::getIndexFile(std::string& file, double lon, double lat)
 }
 
 
+/*----------------------------------------------------------------------------
+ * getFeatureTime
+ *
+ *  geojson index file contains two dates: 'start_date' and 'end_date'
+ *  the raster date is the mid point between start and end dates
+ *----------------------------------------------------------------------------*/
+double PgcDemStripsRaster::getFeatureTime(const OGRFeature* feature)
+{
+    std::vector<const char*> dates = {"start_datetime", "end_datetime"};
+
+    double gps = 0;
+    for(auto& s: dates)
+    {
+        TimeLib::gmt_time_t gmt;
+        gps += getGmtDate(feature, s, gmt);
+    }
+    return gps/dates.size();
+}
+
 /*----------------------------------------------------------------------------
  * findRasters
  *----------------------------------------------------------------------------*/
 bool PgcDemStripsRaster::findRasters(GdalRaster::Point& p)
 {
     /*
-     * Find rasters and their dates.
-     * geojson index file contains two dates: 'start_date' and 'end_date'
-     * Calculate the rster date as mid point between start and end dates.
+     * Find rasters and their dates, see getFeatureTime.
      *
      * The file name/path contains a date in it.
      * We cannot use it because it is the date of the earliest image of the stereo pair.
@@ -124,15 +141,16 @@ bool PgcDemStripsRaster::findRasters(GdalRaster::Point& p)
      * the two images can be up to 30 days apart.
      *
      */
-    std::vector<const char*> dates = {"start_datetime", "end_datetime"};
     try
     {
         OGRPoint point(p.x, p.y, p.z);
 
-        for(int i = 0; i < featuresList.length(); i++)
+        std::vector<const OGRFeature*> features;
+        findFeatures(p, features);
+
+        for(const OGRFeature* feature: features)
         {
-            OGRFeature* feature = featuresList[i];
-            OGRGeometry* geo = feature->GetGeometryRef();
+            const OGRGeometry* geo = feature->GetGeometryRef();
             CHECKPTR(geo);
 
             if(!geo->Contains(&point)) continue;
@@ -170,13 +188,7 @@ bool PgcDemStripsRaster::findRasters(GdalRaster::Point& p)
                 flagsRinfo.tag = FLAGS_TAG;
                 flagsRinfo.fileName = fileName;
 
-                double gps = 0;
-                for(auto& s: dates)
-                {
-                    TimeLib::gmt_time_t gmt;
-                    gps += getGmtDate(feature, s, gmt);
-                }
-                gps = gps/dates.size();
+                double gps = getFeatureTime(feature);
 
                 /* Set raster group time and group id */
                 rgroup->gmtDate = TimeLib::gps2gmttime(static_cast<int64_t>(gps));
@@ -54,6 +54,7 @@ class PgcDemStripsRaster: public GeoIndexedRaster
         virtual ~PgcDemStripsRaster (void);
         void     getIndexFile       (std::string& file, double lon=0, double lat=0 ) final;
         bool     findRasters        (GdalRaster::Point& p) final;
+        double   getFeatureTime     (const OGRFeature* feature) final;
 
     private:
 
@@ -0,0 +1,64 @@
+local runner = require("test_executive")
+console = require("console")
+asset = require("asset")
+
+-- console.monitor:config(core.LOG, core.DEBUG)
+-- sys.setlvl(core.LOG, core.DEBUG)
+
+local assets = asset.loaddir()
+
+-- Unit Test --
+
+local lon = -150.0
+local lat =   70.0
+local height = 0
+
+local vrtFootprintLimit = 0x10000 + 0x1000000 -- base footprint plus the most charged for vrt sources
+
+-- start from an empty cache with the default budget
+local budget = geo.dscache()
+geo.dscache(0)
+geo.dscache(budget)
+
+local _, bytes, datasets = geo.dscache()
+runner.check(bytes == 0, string.format("cache not empty: %d bytes", bytes))
+runner.check(datasets == 0, string.format("cache not empty: %d datasets", datasets))
+
+print(string.format("\n--------------------------------\nTest: Mosaic VRT is Cached\n--------------------------------"))
+
+local dem = geo.raster(geo.parms({asset="arcticdem-mosaic", algorithm="NearestNeighbour", radius=0}))
+runner.check(dem ~= nil)
+local tbl, status = dem:sample(lon, lat, height)
+runner.check(status == true)
+runner.check(tbl ~= nil and #tbl > 0)
+local firstValue = tbl[1]["value"]
+dem:destroy()
+
+local firstBytes
+_, firstBytes, datasets = geo.dscache()
+print(string.format("datasets: %d, bytes: %d", datasets, firstBytes))
+runner.check(datasets == 1, string.format("mosaic vrt not cached: %d datasets", datasets))
+runner.check(firstBytes > 0 and firstBytes <= vrtFootprintLimit, string.format("unexpected vrt footprint: %d bytes", firstBytes))
+
+print(string.format("\n--------------------------------\nTest: Mosaic VRT is Reused\n--------------------------------"))
+
+dem = geo.raster(geo.parms({asset="arcticdem-mosaic", algorithm="NearestNeighbour", radius=0}))
+runner.check(dem ~= nil)
+tbl, status = dem:sample(lon, lat, height)
+runner.check(status == true)
+runner.check(tbl ~= nil and #tbl > 0)
+runner.check(tbl[1]["value"] == firstValue, string.format("reused dataset sampled %f, expected %f", tbl[1]["value"], firstValue))
+dem:destroy()
+
+_, bytes, datasets = geo.dscache()
+print(string.format("datasets: %d, bytes: %d", datasets, bytes))
+runner.check(datasets == 1, string.format("mosaic vrt cached more than once: %d datasets", datasets))
+runner.check(bytes == firstBytes, string.format("cache grew on reuse: %d bytes, expected %d", bytes, firstBytes))
+
+-- leave an empty cache behind
+geo.dscache(0)
+geo.dscache(budget)
+
+-- Report Results --
+
+runner.report()
@@ -48,6 +48,57 @@ do
     print('\n-------------------------------------------------')
 end
 
+-- Batch of points along a short track, most of them share a raster block
+
+local numPoints = 500
+local lons = {}
+local lats = {}
+for i = 1, numPoints do
+    lons[i] = lon + (i - 1) * 0.00002
+    lats[i] = lat + (i - 1) * 0.00001
+end
+
+-- points sampled one at a time may resample from overviews of the mosaic's sources
+local batchTolerance = 0.5
+
+for radius = 0, 100, 50
+do
+    print(string.format("\n-------------------------------------------------\nTest %s: Batch resampling %d points with radius %d meters\n-------------------------------------------------", demType, numPoints, radius))
+    for i = 1, #samplingAlgs do
+        local dem = geo.raster(geo.parms({asset=demType, algorithm=samplingAlgs[i], radius=radius}))
+
+        local tstart = time.latch()
+        local singles = {}
+        for j = 1, numPoints do
+            local tbl, status = dem:sample(lons[j], lats[j], height)
+            if status == true and #tbl > 0 then
+                singles[j] = tbl[1]["value"]
+            end
+        end
+        local singleTime = time.latch() - tstart
+
+        tstart = time.latch()
+        local batch, status = dem:batchsample(lons, lats)
+        local batchTime = time.latch() - tstart
+
+        runner.check(status == true, "failed to batch sample")
+        if status == true then
+            runner.check(#batch == numPoints, string.format("unexpected number of points: %d", #batch))
+            local mismatches = 0
+            for j = 1, numPoints do
+                local samples = batch[j]
+                if (singles[j] == nil) ~= (#samples == 0) then
+                    mismatches = mismatches + 1
+                elseif singles[j] ~= nil and math.abs(samples[1]["value"] - singles[j]) > batchTolerance then
+                    mismatches = mismatches + 1
+                end
+            end
+            runner.check(mismatches == 0, string.format("%s: %d batch samples differ from single samples", samplingAlgs[i], mismatches))
+        end
+        print(string.format("%16s single: %8.3fs  batch: %8.3fs", samplingAlgs[i], singleTime, batchTime))
+    end
+    print('\n-------------------------------------------------')
+end
 
 -- Report Results --
 
@@ -276,32 +276,48 @@ void SwotL2Reader::Region::polyregion (SwotParms* parms)
     if(lat[0] > 70.0) projection = MathLib::NORTH_POLAR;
     else if(lat[0] < -70.0) projection = MathLib::SOUTH_POLAR;
 
-    /* Project Polygon */
+    /* Project and Prepare Polygon */
     List<MathLib::coord_t>::Iterator poly_iterator(parms->polygon);
     MathLib::point_t* projected_poly = new MathLib::point_t [points_in_polygon];
     for(int i = 0; i < points_in_polygon; i++)
     {
         projected_poly[i] = MathLib::coord2point(poly_iterator[i], projection);
     }
+    MathLib::poly_t prepared_poly;
+    MathLib::initpoly(&prepared_poly, projected_poly, points_in_polygon);
+    delete [] projected_poly;
+
+    /* Batch of Projected Lines */
+    double batch_lon[MathLib::POLY_BATCH_SIZE];
+    double batch_lat[MathLib::POLY_BATCH_SIZE];
+    MathLib::point_t batch_points[MathLib::POLY_BATCH_SIZE];
+    bool batch_inclusion[MathLib::POLY_BATCH_SIZE];
 
     /* Find First and Last Lines in Polygon */
     bool first_line_found = false;
     bool last_line_found = false;
+    int batch_start = 0;
+    int batch_end = 0;
     int line = 0;
     while(line < lat.size)
     {
-        bool inclusion = false;
-
-        /* Project Line Coordinate */
-        MathLib::coord_t line_coord = {CONVERT_LON(lon[line]), CONVERT_LAT(lat[line])};
-        MathLib::point_t line_point = MathLib::coord2point(line_coord, projection);
-
-        /* Test Inclusion */
-        if(MathLib::inpoly(projected_poly, points_in_polygon, line_point))
+        /* Project and Test Next Batch of Lines */
+        if(line >= batch_end)
         {
-            inclusion = true;
+            batch_start = line;
+            batch_end = MIN(line + MathLib::POLY_BATCH_SIZE, lat.size);
+            for(int i = batch_start; i < batch_end; i++)
+            {
+                batch_lon[i - batch_start] = CONVERT_LON(lon[i]);
+                batch_lat[i - batch_start] = CONVERT_LAT(lat[i]);
+            }
+            MathLib::coord2point(batch_lon, batch_lat, batch_end - batch_start, projection, batch_points);
+            MathLib::inpoly(&prepared_poly, batch_points, batch_end - batch_start, batch_inclusion);
         }
 
+        /* Test Inclusion */
+        bool inclusion = batch_inclusion[line - batch_start];
+
         /* Find First Line */
         if(!first_line_found && inclusion)
         {
@@ -326,8 +342,8 @@ void SwotL2Reader::Region::polyregion (SwotParms* parms)
         num_lines = line - first_line;
     }
 
-    /* Delete Projected Polygon */
-    delete [] projected_poly;
+    /* Free Prepared Polygon */
+    MathLib::freepoly(&prepared_poly);
 }
 
 /*----------------------------------------------------------------------------
@@ -100,10 +100,12 @@ bool Usgs3dep1meterDemRaster::findRasters(GdalRaster::Point& p)
     {
         OGRPoint point(p.x, p.y, p.z);
 
-        for(int i = 0; i < featuresList.length(); i++)
+        std::vector<const OGRFeature*> features;
+        findFeatures(p, features);
+
+        for(const OGRFeature* feature: features)
         {
-            OGRFeature* feature = featuresList[i];
-            OGRGeometry *geo = feature->GetGeometryRef();
+            const OGRGeometry *geo = feature->GetGeometryRef();
             CHECKPTR(geo);
 
             if(!geo->Contains(&point)) continue;
@@ -32,8 +32,8 @@ local function proxy(resources, parms, endpoint, rec, batch, lon, lat)
     local parquet_builder = nil
     if parms[arrow.PARMS] then
         local output_parms = arrow.parms(parms[arrow.PARMS])
-        -- Parquet Writer --
-        if output_parms:isparquet() then
+        -- Parquet / Arrow IPC Writer --
+        if output_parms:isparquet() or output_parms:isarrowipc() then
             rsps_from_nodes = rspq .. "-parquet"
             terminate_proxy_stream = true
             parquet_builder = arrow.parquet(output_parms, rspq, rsps_from_nodes, rec, batch, rqstid, lon, lat, "time")
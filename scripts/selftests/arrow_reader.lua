@@ -0,0 +1,113 @@
+local runner = require("test_executive")
+local console = require("console")
+
+-- Setup --
+
+local parquet_file = "arrow_reader_test.parquet"
+local num_rows = 1000
+local rows_per_group = 100
+
+runner.command("DEFINE arrowtest.rec id 20")
+runner.command("ADD_FIELD arrowtest.rec id INT32 0 1 NATIVE")
+runner.command("ADD_FIELD arrowtest.rec counter INT64 4 1 NATIVE")
+runner.command("ADD_FIELD arrowtest.rec value DOUBLE 12 1 NATIVE")
+
+-- returns rows of a serialized arrowtest.rec record as {id, counter, value} tables
+local function unpackrows(rec)
+    local raw = rec:serialize()
+    local pos = 8 + string.len("arrowtest.rec") + 2
+    local rows = {}
+    while pos + 20 <= string.len(raw) + 1 do
+        local id, counter, value
+        id, counter, value, pos = string.unpack("<i4<i8<d", raw, pos)
+        table.insert(rows, {id=id, counter=counter, value=value})
+    end
+    return rows
+end
+
+-- Unit Test --
+
+print('\n------------------\nTest01: Write Parquet File\n------------------')
+
+local writeq = msg.publish("arrowtest_inq")
+local fileq = msg.subscribe("arrowtest_fileq")
+local wparms = arrow.parms({path=parquet_file, format="parquet", rows_per_group=rows_per_group})
+local builder = arrow.parquet(wparms, "arrowtest_fileq", "arrowtest_inq", "arrowtest.rec", "arrowtest.rec", "arrowtest")
+
+for i=1,num_rows do
+    writeq:sendrecord(string.format("arrowtest.rec id=%d counter=%d value=%f", i, i * 1000, i * 0.5))
+end
+writeq:sendstring("")
+runner.check(builder:waiton(10000), "failed to build parquet file")
+
+-- client receives file as data records after the arrowrec.data type and filename
+local f = assert(io.open(parquet_file, "wb"))
+local data_offset = 8 + string.len("arrowrec.data") + 1 + 128 + 1
+local rec = fileq:recvrecord(1000)
+while rec do
+    if rec:gettype() == "arrowrec.data" then
+        f:write(string.sub(rec:serialize(), data_offset))
+    end
+    rec = fileq:recvrecord(1000)
+end
+f:close()
+
+builder:destroy()
+fileq:destroy()
+writeq:destroy()
+
+print('\n------------------\nTest02: Read Back All Rows\n------------------')
+
+local readq = msg.subscribe("arrowtest_readq")
+local rparms = arrow.parms({path=parquet_file, format="parquet"})
+local reader = arrow.reader(rparms, "arrowtest_readq", "arrowtest.rec")
+
+local rows = {}
+rec = readq:recvrecord(3000)
+while rec do
+    for _,row in ipairs(unpackrows(rec)) do table.insert(rows, row) end
+    rec = readq:recvrecord(3000)
+end
+runner.check(reader:waiton(10000), "failed to read parquet file")
+
+runner.check(#rows == num_rows, string.format("unexpected number of rows: %d", #rows))
+for i,row in ipairs(rows) do
+    if not runner.check(row.id == i and row.counter == i * 1000 and row.value == i * 0.5, string.format("row %d mismatch: %d, %d, %f", i, row.id, row.counter, row.value)) then
+        break
+    end
+end
+
+reader:destroy()
+readq:destroy()
+
+print('\n------------------\nTest03: Skip Row Groups Outside Filter\n------------------')
+
+readq = msg.subscribe("arrowtest_filterq")
+rparms = arrow.parms({path=parquet_file, format="parquet"})
+reader = arrow.reader(rparms, "arrowtest_filterq", "arrowtest.rec", nil, nil, {counter={250000, 349000}})
+
+rows = {}
+rec = readq:recvrecord(3000)
+while rec do
+    for _,row in ipairs(unpackrows(rec)) do table.insert(rows, row) end
+    rec = readq:recvrecord(3000)
+end
+runner.check(reader:waiton(10000), "failed to read parquet file")
+
+-- rows 250 through 349 span the row groups holding 201-300 and 301-400
+local stats = reader:stats()
+runner.check(stats.read == 2, string.format("unexpected row groups read: %d", stats.read))
+runner.check(stats.skipped == (num_rows / rows_per_group) - 2, string.format("unexpected row groups skipped: %d", stats.skipped))
+runner.check(#rows == 2 * rows_per_group, string.format("unexpected number of rows: %d", #rows))
+runner.check(#rows > 0 and rows[1].id == 201, "unexpected first row")
+
+reader:destroy()
+readq:destroy()
+
+-- Clean Up --
+
+os.remove(parquet_file)
+
+-- Report Results --
+
+runner.report()
@@ -89,8 +89,78 @@ runner.check(status == nil)
 runner.check(tbl == nil)
 
 
+-- Same geojson again, mask comes from the cache
+print('\n------------------\nTest07: cached geojson\n------------------')
+local robj2 = geo.geojson(params)
+runner.check(robj2 ~= nil)
+
+local rows2, cols2 = robj2:dim()
+runner.check(rows2 == rows and cols2 == cols, string.format("cached dimensions differ: rows: %d, cols: %d", rows2, cols2))
+
+local lon_min2, lat_min2, lon_max2, lat_max2 = robj2:bbox()
+runner.check(lon_min2 == lon_min and lat_min2 == lat_min and lon_max2 == lon_max and lat_max2 == lat_max, "cached bbox differs")
+
+tbl, status = robj2:sample(-108, 39, height)
+runner.check(status == true)
+runner.check(tbl ~= nil and #tbl > 0 and tbl[1]["value"] == 1, "cached raster sample differs")
+
+
+-- Inclusion along the edges of bbox
+print('\n------------------\nTest08: includes at edges\n------------------')
+
+-- true when the raster sampled at x, y is a pixel of the geojson
+local function sampled(r, x, y)
+    local t, ok = r:sample(x, y, height)
+    return ok == true and t ~= nil and #t > 0 and t[1]["value"] == 1
+end
+
+local half = cellsize / 2
+local inside_lons, inside_lats = {}, {}
+local outside_lons, outside_lats = {}, {}
+for i = 0, 10 do
+    local x = lon_min + half + (lon_max - lon_min - cellsize) * i / 10
+    local y = lat_min + half + (lat_max - lat_min - cellsize) * i / 10
+    for _, p in ipairs({{x, lat_min + half}, {x, lat_max - half}, {lon_min + half, y}, {lon_max - half, y}}) do
+        table.insert(inside_lons, p[1])
+        table.insert(inside_lats, p[2])
+    end
+    for _, p in ipairs({{x, lat_min - half}, {x, lat_max + half}, {lon_min - half, y}, {lon_max + half, y}}) do
+        table.insert(outside_lons, p[1])
+        table.insert(outside_lats, p[2])
+    end
+end
+
+for _, r in ipairs({robj, robj2}) do
+    local inside, inside_status = r:includes(inside_lons, inside_lats)
+    runner.check(inside_status == true and #inside == #inside_lons)
+    inside = inside or {}
+    for i = 1, #inside do
+        local expected = sampled(r, inside_lons[i], inside_lats[i])
+        if not runner.check(inside[i] == expected, string.format("inclusion at lon: %.3f, lat: %.3f is %s, sampled %s", inside_lons[i], inside_lats[i], tostring(inside[i]), tostring(expected))) then
+            break
+        end
+    end
+
+    local outside, outside_status = r:includes(outside_lons, outside_lats)
+    runner.check(outside_status == true and #outside == #outside_lons)
+    outside = outside or {}
+    for i = 1, #outside do
+        if not runner.check(outside[i] == false, string.format("included outside bbox at lon: %.3f, lat: %.3f", outside_lons[i], outside_lats[i])) then
+            break
+        end
+    end
+end
+
+-- point of Test01
+local single = robj2:includes({-108}, {39})
+runner.check(single ~= nil and single[1] == true)
+
+
 -- Clean Up --
 
+robj:destroy()
+robj2:destroy()
+
 -- Report Results --
 
 runner.report()
@@ -0,0 +1,11 @@
+local runner = require("test_executive")
+
+-- MathLib Unit Test --
+
+runner.command("NEW UT_MATHLIB ut_mathlib")
+runner.command("ut_mathlib::CHECK_INPOLY")
+runner.command("DELETE ut_mathlib")
+
+-- Report Results --
+
+runner.report()
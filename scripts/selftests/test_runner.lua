@@ -37,6 +37,11 @@ if __h5__ then
     runner.script(td .. "hdf5_file.lua")
 end
 
+-- Run Arrow Self Tests --
+if __arrow__ then
+    runner.script(td .. "arrow_reader.lua")
+end
+
 -- Run Pistache Self Tests --
 if __pistache__ then
     runner.script(td .. "pistache_endpoint.lua")
@@ -56,6 +61,7 @@ if __legacy__ then
     runner.script(td .. "dictionary.lua")
     runner.script(td .. "table.lua")
     runner.script(td .. "timelib.lua")
+    runner.script(td .. "mathlib.lua")
     runner.script(td .. "ccsds_packetizer.lua")
     runner.script(td .. "cfs_interface.lua")
     runner.script(td .. "record_dispatcher.lua")
@@ -83,6 +89,7 @@ if __pgc__ then
     runner.script(pgc_td .. "aoi_bbox_test.lua")
     runner.script(pgc_td .. "proj_pipeline_test.lua")
     runner.script(pgc_td .. "remadem_reader.lua")
+    runner.script(pgc_td .. "dataset_cache_test.lua")
 end
 
 -- Run Landsat Plugin Self Tests
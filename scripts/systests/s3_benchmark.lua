@@ -0,0 +1,116 @@
+--
+-- Benchmarks the S3 read path against the local stand-in server
+--
+--  start the stand-in first, serving the scripts directory (bucket = "selftests"):
+--      python s3_standin.py --root <sliderule>/scripts --latency 20 --jitter 10 --tail-rate 0.02 --tail-latency 500
+--
+--  then run:
+--      sliderule s3_benchmark.lua [<endpoint>] [<reads>] [<read size>]
+--
+
+local runner = require("test_executive")
+console = require("console")
+local td = runner.rootdir(arg[0])
+
+-- Setup --
+-- console.monitor:config(core.LOG, core.DEBUG)
+-- sys.setlvl(core.LOG, core.DEBUG)
+
+local endpoint = arg[1] or "http://127.0.0.1:9000"
+local num_reads = tonumber(arg[2]) or 200
+local read_size = tonumber(arg[3]) or 0x10000
+
+local bucket = "selftests"
+local objkey = "english_words.txt"
+local h5key = "h5ex_d_gzip.h5"
+local cache_root = "/tmp/s3_benchmark_cache"
+
+local f = io.open(td.."../selftests/"..objkey, "rb")
+local expected = f:read("*a")
+f:close()
+local objsize = string.len(expected)
+
+runner.check(aws.s3endpoint(endpoint), "failed to set s3 endpoint")
+
+-- Helper Functions --
+
+local function percentile(samples, p)
+    table.sort(samples)
+    return samples[math.max(1, math.ceil(#samples * p / 100))]
+end
+
+local function random_reads(label)
+    local latencies = {}
+    local bytes = 0
+    local errors = 0
+    math.randomseed(1)
+    local starttime = time.latch()
+    for i=1,num_reads do
+        local pos = math.random(0, objsize - read_size)
+        local t0 = time.latch()
+        local response, status = aws.s3read(bucket, objkey, read_size, pos, nil, nil)
+        table.insert(latencies, (time.latch() - t0) * 1000.0)
+        if status and response == string.sub(expected, pos + 1, pos + read_size) then
+            bytes = bytes + string.len(response)
+        else
+            errors = errors + 1
+        end
+    end
+    local dtime = time.latch() - starttime
+    print(string.format("%-12s reads: %d, errors: %d, throughput: %.2f MB/s, p50: %.1f ms, p95: %.1f ms, p99: %.1f ms, max: %.1f ms",
+        label, num_reads, errors, bytes / dtime / 1000000.0,
+        percentile(latencies, 50), percentile(latencies, 95), percentile(latencies, 99), percentile(latencies, 100)))
+    return errors
+end
+
+local function h5_reads(label, asset, iterations)
+    local starttime = time.latch()
+    local failures = 0
+    for i=1,iterations do
+        local dataq = string.format("%sq%d", label, i)
+        local rsps = msg.subscribe(dataq)
+        local h5obj = h5.dataset(core.READER, asset, h5key, "/DS1", 0, true, core.INTEGER, 2, 0, core.ALL_ROWS)
+        local rdr = core.reader(h5obj, dataq)
+        local vals = rsps:recvstring(10000)
+        if vals == nil or string.unpack('i', vals) ~= -2 then
+            failures = failures + 1
+        end
+        rdr:destroy()
+        rsps:destroy()
+    end
+    local dtime = time.latch() - starttime
+    print(string.format("%-12s iterations: %d, failures: %d, duration: %.3f s, per read: %.1f ms", label, iterations, failures, dtime, dtime * 1000.0 / iterations))
+    return failures
+end
+
+-- Direct Reads --
+
+print('\n------------------\nDirect Range Reads\n------------------')
+
+runner.check(random_reads("unhedged") == 0, "failed direct reads")
+runner.check(aws.s3hedge(true), "failed to enable hedging")
+runner.check(random_reads("hedged") == 0, "failed hedged reads")
+aws.s3hedge(false)
+
+-- Asset Reads --
+
+print('\n------------------\nH5 Asset Reads\n------------------')
+
+os.execute("rm -rf "..cache_root)
+runner.check(aws.s3cache(cache_root, 0x10000000, 0x10000), "failed to create s3 cache")
+
+local s3asset = core.asset("standin-s3", "nil", "s3", bucket, "empty.index")
+local cacheasset = core.asset("standin-s3cache", "nil", "s3cache", bucket, "empty.index")
+
+runner.check(h5_reads("s3", s3asset, 20) == 0, "failed s3 asset reads")
+runner.check(h5_reads("s3cache-cold", cacheasset, 1) == 0, "failed cold s3cache asset reads")
+runner.check(h5_reads("s3cache-warm", cacheasset, 20) == 0, "failed warm s3cache asset reads")
+
+-- Clean Up --
+
+aws.s3endpoint()
+os.execute("rm -rf "..cache_root)
+
+-- Report Results --
+
+runner.report()
@@ -0,0 +1,339 @@
+# python
+#
+# Local stand-in for the subset of the S3 protocol used by SlideRule
+#
+#   GET     /<bucket>/<key>                         (optionally with Range header)
+#   HEAD    /<bucket>/<key>
+#   PUT     /<bucket>/<key>
+#   DELETE  /<bucket>/<key>
+#   POST    /<bucket>/<key>?uploads                 initiate multipart upload
+#   PUT     /<bucket>/<key>?partNumber=N&uploadId=U upload part
+#   POST    /<bucket>/<key>?uploadId=U              complete multipart upload
+#   DELETE  /<bucket>/<key>?uploadId=U              abort multipart upload
+#
+# Buckets are subdirectories of the served root directory.  Latency,
+# bandwidth, error, and throttling behavior can be injected per request so
+# that the cloud read path can be benchmarked and fault tested without AWS.
+#
+# Usage:
+#   python s3_standin.py --root <directory> [--port 9000] [--latency 20] ...
+#
+# Point the server at it with:
+#   aws.s3endpoint("http://127.0.0.1:9000")
+
+import os
+import sys
+import time
+import uuid
+import random
+import hashlib
+import argparse
+import threading
+import xml.etree.ElementTree as ET
+from email.utils import formatdate
+from urllib.parse import urlparse, parse_qs, unquote
+from http.server import ThreadingHTTPServer, BaseHTTPRequestHandler
+
+###############################################################################
+# GLOBALS
+###############################################################################
+
+MULTIPART_DIR = ".multipart"
+CHUNK_SIZE = 0x10000
+
+config = None
+stats = {}
+stats_lock = threading.Lock()
+
+###############################################################################
+# UTILITY FUNCTIONS
+###############################################################################
+
+def count(name, value=1):
+    with stats_lock:
+        stats[name] = stats.get(name, 0) + value
+
+def error_xml(code, message, resource):
+    return ("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+            "<Error><Code>{}</Code><Message>{}</Message><Resource>{}</Resource></Error>").format(code, message, resource).encode()
+
+def etag_of(path):
+    md5 = hashlib.md5()
+    with open(path, "rb") as f:
+        for chunk in iter(lambda: f.read(CHUNK_SIZE), b""):
+            md5.update(chunk)
+    return '"{}"'.format(md5.hexdigest())
+
+def parse_range(header, size):
+    # returns (start, end) inclusive, None if no range, or False if unsatisfiable
+    if not header or not header.startswith("bytes="):
+        return None
+    spec = header[len("bytes="):].split(",")[0].strip()
+    first, _, last = spec.partition("-")
+    if first == "":
+        length = int(last)
+        if length <= 0:
+            return False
+        start = max(size - length, 0)
+        end = size - 1
+    else:
+        start = int(first)
+        end = int(last) if last != "" else size - 1
+        end = min(end, size - 1)
+    if start >= size or start > end:
+        return False
+    return (start, end)
+
+###############################################################################
+# REQUEST HANDLER
+###############################################################################
+
+class S3StandinHandler(BaseHTTPRequestHandler):
+
+    protocol_version = "HTTP/1.1"
+
+    def log_message(self, format, *args):
+        if config.verbose:
+            sys.stderr.write("%s - %s\n" % (self.address_string(), format % args))
+
+    #
+    # Request Parsing
+    #
+    def parse(self):
+        url = urlparse(self.path)
+        self.query = parse_qs(url.query, keep_blank_values=True)
+        parts = unquote(url.path).lstrip("/").split("/", 1)
+        self.bucket = parts[0]
+        self.key = parts[1] if len(parts) > 1 else ""
+        root = os.path.realpath(config.root)
+        self.filepath = os.path.realpath(os.path.join(root, self.bucket, self.key))
+        if not self.filepath.startswith(root + os.sep) or MULTIPART_DIR in self.filepath.split(os.sep):
+            self.filepath = None
+
+    def read_body(self):
+        length = int(self.headers.get("Content-Length", 0))
+        body = b""
+        while len(body) < length:
+            chunk = self.rfile.read(min(CHUNK_SIZE, length - len(body)))
+            if not chunk:
+                break
+            body += chunk
+        count("bytes_received", len(body))
+        return body
+
+    #
+    # Responses
+    #
+    def respond(self, code, body=b"", headers={}, send_body=True):
+        self.send_response(code)
+        for name, value in headers.items():
+            self.send_header(name, value)
+        self.send_header("Content-Length", str(len(body)))
+        self.end_headers()
+        if send_body and body:
+            self.send_data(body)
+
+    def respond_error(self, code, s3code, message):
+        count("errors_{}".format(code))
+        self.respond(code, error_xml(s3code, message, self.path), {"Content-Type": "application/xml"}, self.command != "HEAD")
+
+    def send_data(self, data):
+        # writes data, throttled to the configured bandwidth
+        offset = 0
+        start = time.time()
+        while offset < len(data):
+            chunk = data[offset:offset + CHUNK_SIZE]
+            self.wfile.write(chunk)
+            offset += len(chunk)
+            if config.bandwidth > 0:
+                ahead = (offset / config.bandwidth) - (time.time() - start)
+                if ahead > 0:
+                    time.sleep(ahead)
+        count("bytes_sent", offset)
+
+    #
+    # Fault Injection - returns True if request was handled
+    #
+    def inject(self):
+        count("requests")
+        delay = config.latency + random.uniform(0, config.jitter)
+        if random.random() < config.tail_rate:
+            count("tail_responses")
+            delay += config.tail_latency
+        if delay > 0:
+            time.sleep(delay / 1000.0)
+        if self.command != "HEAD" and random.random() < config.throttle_rate:
+            self.respond_error(503, "SlowDown", "Please reduce your request rate.")
+            return True
+        if random.random() < config.error_rate:
+            self.respond_error(500, "InternalError", "We encountered an internal error. Please try again.")
+            return True
+        if self.filepath is None:
+            self.respond_error(403, "AccessDenied", "Access Denied")
+            return True
+        return False
+
+    #
+    # HTTP Methods
+    #
+    def do_HEAD(self):
+        self.do_GET()
+
+    def do_GET(self):
+        self.parse()
+        if self.inject():
+            return
+        if not os.path.isfile(self.filepath):
+            self.respond_error(404, "NoSuchKey", "The specified key does not exist.")
+            return
+        size = os.path.getsize(self.filepath)
+        headers = { "Content-Type": "application/octet-stream",
+                    "Accept-Ranges": "bytes",
+                    "ETag": etag_of(self.filepath) if config.etags else '"{}"'.format(size),
+                    "Last-Modified": formatdate(os.path.getmtime(self.filepath), usegmt=True) }
+        byte_range = parse_range(self.headers.get("Range"), size)
+        if byte_range is False:
+            headers["Content-Range"] = "bytes */{}".format(size)
+            count("errors_416")
+            self.respond(416, error_xml("InvalidRange", "The requested range is not satisfiable", self.path), headers, self.command != "HEAD")
+            return
+        with open(self.filepath, "rb") as f:
+            if byte_range is None:
+                code = 200
+                data = f.read() if self.command == "GET" else b""
+                length = size
+            else:
+                code = 206
+                start, end = byte_range
+                f.seek(start)
+                data = f.read(end - start + 1) if self.command == "GET" else b""
+                length = end - start + 1
+                headers["Content-Range"] = "bytes {}-{}/{}".format(start, end, size)
+        self.send_response(code)
+        for name, value in headers.items():
+            self.send_header(name, value)
+        self.send_header("Content-Length", str(length))
+        self.end_headers()
+        if self.command == "GET":
+            count("gets")
+            self.send_data(data)
+        else:
+            count("heads")
+
+    def do_PUT(self):
+        self.parse()
+        body = self.read_body()
+        if self.inject():
+            return
+        if "uploadId" in self.query and "partNumber" in self.query:
+            # upload part
+            upload_dir = os.path.join(config.root, MULTIPART_DIR, os.path.basename(self.query["uploadId"][0]))
+            if not os.path.isdir(upload_dir):
+                self.respond_error(404, "NoSuchUpload", "The specified upload does not exist.")
+                return
+            part_path = os.path.join(upload_dir, "{:05d}".format(int(self.query["partNumber"][0])))
+            with open(part_path, "wb") as f:
+                f.write(body)
+            count("parts")
+            self.respond(200, headers={"ETag": '"{}"'.format(hashlib.md5(body).hexdigest())})
+        else:
+            # put object
+            os.makedirs(os.path.dirname(self.filepath), exist_ok=True)
+            with open(self.filepath, "wb") as f:
+                f.write(body)
+            count("puts")
+            self.respond(200, headers={"ETag": '"{}"'.format(hashlib.md5(body).hexdigest())})
+
+    def do_POST(self):
+        self.parse()
+        body = self.read_body()
+        if self.inject():
+            return
+        if "uploads" in self.query:
+            # initiate multipart upload
+            upload_id = uuid.uuid4().hex
+            os.makedirs(os.path.join(config.root, MULTIPART_DIR, upload_id))
+            xml = ("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                   "<InitiateMultipartUploadResult><Bucket>{}</Bucket><Key>{}</Key><UploadId>{}</UploadId></InitiateMultipartUploadResult>").format(self.bucket, self.key, upload_id)
+            self.respond(200, xml.encode(), {"Content-Type": "application/xml"})
+        elif "uploadId" in self.query:
+            # complete multipart upload
+            upload_dir = os.path.join(config.root, MULTIPART_DIR, os.path.basename(self.query["uploadId"][0]))
+            if not os.path.isdir(upload_dir):
+                self.respond_error(404, "NoSuchUpload", "The specified upload does not exist.")
+                return
+            part_numbers = []
+            if body:
+                for element in ET.fromstring(body).iter():
+                    if element.tag.endswith("PartNumber"):
+                        part_numbers.append(int(element.text))
+            else:
+                part_numbers = sorted(int(name) for name in os.listdir(upload_dir))
+            os.makedirs(os.path.dirname(self.filepath), exist_ok=True)
+            with open(self.filepath, "wb") as f:
+                for part_number in sorted(part_numbers):
+                    part_path = os.path.join(upload_dir, "{:05d}".format(part_number))
+                    if not os.path.isfile(part_path):
+                        self.respond_error(400, "InvalidPart", "One or more of the specified parts could not be found.")
+                        return
+                    with open(part_path, "rb") as p:
+                        f.write(p.read())
+                    os.remove(part_path)
+            os.rmdir(upload_dir)
+            count("multipart_uploads")
+            xml = ("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                   "<CompleteMultipartUploadResult><Bucket>{}</Bucket><Key>{}</Key><ETag>{}</ETag></CompleteMultipartUploadResult>").format(self.bucket, self.key, etag_of(self.filepath))
+            self.respond(200, xml.encode(), {"Content-Type": "application/xml"})
+        else:
+            self.respond_error(400, "InvalidRequest", "Unsupported POST request.")
+
+    def do_DELETE(self):
+        self.parse()
+        if self.inject():
+            return
+        if "uploadId" in self.query:
+            upload_dir = os.path.join(config.root, MULTIPART_DIR, os.path.basename(self.query["uploadId"][0]))
+            if os.path.isdir(upload_dir):
+                for name in os.listdir(upload_dir):
+                    os.remove(os.path.join(upload_dir, name))
+                os.rmdir(upload_dir)
+        elif os.path.isfile(self.filepath):
+            os.remove(self.filepath)
+        self.respond(204)
+
+###############################################################################
+# MAIN
+###############################################################################
+
+if __name__ == '__main__':
+
+    parser = argparse.ArgumentParser(description="Local stand-in S3 server for benchmarking and fault injection")
+    parser.add_argument("--root",           type=str,   default=".",        help="directory served; each subdirectory is a bucket")
+    parser.add_argument("--address",        type=str,   default="127.0.0.1")
+    parser.add_argument("--port",           type=int,   default=9000)
+    parser.add_argument("--latency",        type=float, default=0.0,        help="milliseconds added to every request")
+    parser.add_argument("--jitter",         type=float, default=0.0,        help="maximum random milliseconds added to every request")
+    parser.add_argument("--tail-rate",      type=float, default=0.0,        help="fraction of requests that receive tail latency")
+    parser.add_argument("--tail-latency",   type=float, default=0.0,        help="milliseconds added to tail requests")
+    parser.add_argument("--bandwidth",      type=float, default=0.0,        help="bytes per second per response, 0 for unlimited")
+    parser.add_argument("--error-rate",     type=float, default=0.0,        help="fraction of requests answered with 500 InternalError")
+    parser.add_argument("--throttle-rate",  type=float, default=0.0,        help="fraction of requests answered with 503 SlowDown")
+    parser.add_argument("--seed",           type=int,   default=None,       help="random seed for repeatable fault injection")
+    parser.add_argument("--etags",          action="store_true",            help="compute md5 etags on reads (slow for large files)")
+    parser.add_argument("--verbose",        action="store_true")
+    config = parser.parse_args()
+
+    random.seed(config.seed)
+    os.makedirs(os.path.join(config.root, MULTIPART_DIR), exist_ok=True)
+
+    server = ThreadingHTTPServer((config.address, config.port), S3StandinHandler)
+    server.daemon_threads = True
+    print("Serving {} as S3 on http://{}:{}".format(os.path.realpath(config.root), config.address, config.port))
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+    finally:
+        server.server_close()
+        for name in sorted(stats):
+            print("{:20s} {}".format(name, stats[name]))
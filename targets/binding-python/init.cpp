@@ -144,7 +144,11 @@ PYBIND11_MODULE(srpybin, m)
     py::class_<pyS3Cache>(m, "s3cache")
 
         .def(py::init<const std::string &,      // _cache_root
-                      const int>());            // _max_files
+                      const long,               // _max_size
+                      const long>(),            // _block_size
+            py::arg("cache_root"),
+            py::arg("max_size") = (long)S3CacheIODriver::DEFAULT_MAX_CACHE_SIZE,
+            py::arg("block_size") = (long)S3CacheIODriver::DEFAULT_CACHE_BLOCK_SIZE);
 
     py::class_<pyCredentialStore>(m, "credentials")
 
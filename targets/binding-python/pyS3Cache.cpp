@@ -50,9 +50,9 @@ namespace py = pybind11;
 /*--------------------------------------------------------------------
  * Constructor
  *--------------------------------------------------------------------*/
-pyS3Cache::pyS3Cache (const std::string &_cache_root, const int _max_files)
+pyS3Cache::pyS3Cache (const std::string &_cache_root, const long _max_size, const long _block_size)
 {
-    S3CacheIODriver::createCache(_cache_root.c_str(), _max_files);
+    S3CacheIODriver::createCache(_cache_root.c_str(), _max_size, _block_size);
 }
 
 /*--------------------------------------------------------------------
@@ -52,7 +52,7 @@ namespace py = pybind11;
 class pyS3Cache
 {
     public:
-        pyS3Cache   (const std::string &_cache_root, const int _max_files);
+        pyS3Cache   (const std::string &_cache_root, const long _max_size, const long _block_size);
         ~pyS3Cache  (void);
 };
 